@@ -27,41 +27,59 @@
 #include "aggregate_supports_heuristic.h"
 
 #include <string.h>    /* for strcmp(), strcpy(), etc. */
+#include <limits.h>    /* for UINT_MAX */
+#include <pthread.h>   /* for pthread_create() and pthread_join() */
 
 #include "output.h"
 #include "utility.h"
+#include "cluster_index.h"
 
-static struct TrieNode *build_prefix_trie(struct Parameters *pParam);
-static void insert_cluster_into_trie(struct TrieNode *pRoot, struct Cluster 
-  *pCluster, struct Parameters *pParam);
-static int insert_cluster_into_trie_wildcard(struct TrieNode *pParent, int min,
-                    int max, struct Parameters *pParam);
-static int insert_cluster_into_trie_word(struct TrieNode *pParent, 
-        struct Elem *pWord, struct Parameters *pParam);
-static struct TrieNode *create_trie_node(struct Elem *pElem, 
-        struct TrieNode *pParent, struct TrieNode *pPrev, 
-        struct Parameters *pParam);
+static void build_prefix_trie(struct Parameters *pParam);
+static struct TriePath *collect_trie_paths(wordnumber_t *pPathNum,
+        struct TrieItem **ppItems, struct Parameters *pParam);
+static int compare_trie_items(struct TrieItem *pItem1, 
+        struct TrieItem *pItem2);
+static int compare_trie_paths(const void *p1, const void *p2);
 static void aggregate_candidates(struct Parameters *pParam);
+static void aggregate_candidates_in_parallel(wordnumber_t *pLookups,
+        wordnumber_t *pHits, struct Parameters *pParam);
+static void *aggregate_task_main(void *pArg);
+static void init_aggregate_memo(struct AggregateMemo *pMemo, 
+        struct Parameters *pParam);
+static char has_wildcard(int *pWildcards, int constants);
 static int get_first_wildcard_location(struct Cluster *pCluster);
 static void aggregate_candidate(struct Cluster *pCluster, 
+        struct AggregateMemo *pMemo, struct Parameters *pParam);
+static struct TrieNode *get_common_parent(struct Cluster *pCluster,
         struct Parameters *pParam);
-static struct TrieNode *get_common_parent(struct Cluster *pCluster);
 static int get_first_wildcard_reverse_depth(struct Cluster *pCluster);
-static int find_more_specific(struct TrieNode *pParent, 
+static tableindex_t hash_suffix(struct Cluster *pCluster, int constant);
+static char is_same_suffix(struct Cluster *pCluster1, int constant1,
+        struct Cluster *pCluster2, int constant2);
+static support_t find_more_specific_cached(struct TrieNode *pParent, 
+        struct Cluster *pCluster, int constant, struct AggregateMemo *pMemo,
+        struct Parameters *pParam);
+static support_t find_more_specific(struct TrieNode *pParent, 
         struct Cluster *pCluster, int constant, int min, int max, 
-        wordnumber_t hash, struct Parameters *pParam);
-static int find_more_specific_tail(struct TrieNode *pParent, 
-        struct Cluster*pCluster, int min, int max);
+        struct AggregateMemo *pMemo, struct Parameters *pParam);
+static support_t find_more_specific_tail(struct TrieNode *pParent, 
+        struct Cluster*pCluster, int min, int max, struct Parameters *pParam);
+
+/* Search the subtree of ptr like find_more_specific(ptr, pCluster, constant,
+ 0, 0), through the cache if the subtree is big enough. A small subtree is
+ searched faster than the cache is looked up. */
+#define FIND_MORE_SPECIFIC_BELOW(ptr, pCluster, constant, pMemo, pParam) \
+  ((ptr)->subtreeSize < AGGREGATE_MEMO_MIN_SUBTREE ? \
+  find_more_specific((ptr), (pCluster), (constant), 0, 0, (pMemo), (pParam)) : \
+  find_more_specific_cached((ptr), (pCluster), (constant), (pMemo), (pParam)))
 
 void step_2_aggregate_supports(struct Parameters *pParam)
 {
-  struct TrieNode *pRoot;
-  
   log_msg("Aggregate cluster candidates...", LOG_NOTICE, pParam);
-  pParam->prefixSketchSize = pParam->freWordNum * 3;
-  pParam->wildcardHash = pParam->freWordNum * 3;
   
-  pRoot = build_prefix_trie(pParam);
+  build_cluster_index(pParam);
+  
+  build_prefix_trie(pParam);
   
   aggregate_candidates(pParam);
   
@@ -72,325 +90,485 @@ void step_2_aggregate_supports(struct Parameters *pParam)
   //sprintf(logStr, "%s cluster were found.", digit);
   //log_msg(logStr, LOG_INFO, &param);
   
-  //2016-04-12 commented out free_trie_nodes(pRoot, pParam);
-  //This function faces "segmentation 11" error when handling 
-  //large trie nodes. 
-  //(Or this is because the characteristic of specific event log
-  //files that generate some weird cluster candidates, therefore
-  //generating some weird trie nodes that are hard to free.)
-  //Commenting out this function is not a problem.
-  //System will take this issue and helps in freeing heap memory, 
-  //when the process is terminated.
-  //(Memory leaking is a affordable problem, as this program is not a long-time
-  //background program that keeps consuming memory. Nevertheless, other heap
-  //memory that won't cause errors when being released shall always be 
-  //released.)
-  
-  //free_trie_nodes(pRoot, pParam);
+  /* The nodes of the prefix tree are one array, which is released by
+   free_and_clean_step_2(). */
 }
 
-/* This function iterates all cluster candiates and build the prefix tree. */
-static struct TrieNode *build_prefix_trie(struct Parameters *pParam)
+/* Build the prefix tree of all the cluster candidates in one go. The paths of
+ the candidates are sorted, so that the paths below a node are neighbours, and
+ the nodes are created level by level: a node is taken from the array in the
+ order of creation (breadth first), the children of the node are the runs of
+ equal items at its depth among its paths, and they are appended to the array
+ together. Thus the children of every node are neighbours, sorted like the
+ items. A path that ends at the depth of a node is the first one of the node,
+ since a prefix sorts before the longer paths; the candidate ends at the node.
+ 
+ pLo[v] and pHi[v] are the range of the sorted paths below node v, and
+ pDepth[v] is its depth. They are only needed until v is taken. */
+static void build_prefix_trie(struct Parameters *pParam)
 {
-  int i = 0;
-  struct Cluster *ptr;
+  struct TriePath *pPaths;
+  struct TrieItem *pItems;
+  struct TrieNode *pNode, *pChild;
+  wordnumber_t pathNum, nodeMax, lo, hi, i;
+  wordnumber_t *pLo, *pHi;
+  int *pDepth;
+  unsigned int v;
+  int depth;
   
-  struct TrieNode *pRoot = (struct TrieNode *) malloc(sizeof(struct TrieNode));
-  if (!pRoot)
+  pPaths = collect_trie_paths(&pathNum, &pItems, pParam);
+  qsort(pPaths, pathNum, sizeof(struct TriePath), compare_trie_paths);
+  
+  /* Every item of a path is at most one node. */
+  nodeMax = 1;
+  for (i = 0; i < pathNum; i++)
+  {
+    nodeMax += pPaths[i].itemNum;
+  }
+  
+  if (nodeMax > UINT_MAX)
   {
-    log_msg(MALLOC_ERR_6003, LOG_ERR, pParam);
+    log_msg("Too many nodes in the prefix tree of '--aggrsup' option", 
+        LOG_ERR, pParam);
     exit(1);
   }
   
-  pParam->trieNodeNum = 1;
-  /* Root has unique id. */
-  pRoot->hashValue = pParam->wildcardHash + 1;
+  pParam->pTrieNodes = (struct TrieNode *) malloc(sizeof(struct TrieNode) * 
+                          nodeMax);
+  pLo = (wordnumber_t *) malloc(sizeof(wordnumber_t) * nodeMax);
+  pHi = (wordnumber_t *) malloc(sizeof(wordnumber_t) * nodeMax);
+  pDepth = (int *) malloc(sizeof(int) * nodeMax);
+  if (!pParam->pTrieNodes || !pLo || !pHi || !pDepth)
+  {
+    log_msg(MALLOC_ERR_6037, LOG_ERR, pParam);
+    exit(1);
+  }
   
-  pRoot->pParent = 0;
-  pRoot->pChild = 0;
-  pRoot->pNext = 0;
-  pRoot->pWord = 0;
-  pRoot->wildcardMin = 0;
-  pRoot->wildcardMax = 0;
-  pRoot->pIsEnd = 0;
+  /* Root. */
+  pNode = &pParam->pTrieNodes[0];
+  pNode->pWord = 0;
+  pNode->pIsEnd = 0;
+  pNode->parent = 0;
+  pNode->subtreeSize = 0;
+  pNode->wildcardMin = 0;
+  pNode->wildcardMax = 0;
+  pLo[0] = 0;
+  pHi[0] = pathNum;
+  pDepth[0] = 0;
+  pParam->trieNodeNum = 1;
   
-  for (i = 1; i <= pParam->biggestConstants; i++)
+  for (v = 0; v < pParam->trieNodeNum; v++)
   {
-    ptr = pParam->pClusterFamily[i];
-    while (ptr)
+    pNode = &pParam->pTrieNodes[v];
+    lo = pLo[v];
+    hi = pHi[v];
+    depth = pDepth[v];
+    
+    pNode->firstChild = (unsigned int) pParam->trieNodeNum;
+    pNode->childNum = 0;
+    
+    if (lo < hi && pPaths[lo].itemNum == depth)
+    {
+      pNode->pIsEnd = pPaths[lo].pCluster;
+      pPaths[lo].pCluster->lastNode = v;
+      lo++;
+    }
+    
+    while (lo < hi)
     {
-      //build cluster into trie..
-      insert_cluster_into_trie(pRoot, ptr, pParam);
-      ptr = ptr->pNext;
+      /* The paths from lo to i have the same item at this depth. */
+      for (i = lo + 1; i < hi; i++)
+      {
+        if (compare_trie_items(&pPaths[i].pItems[depth], 
+                     &pPaths[lo].pItems[depth]))
+        {
+          break;
+        }
+      }
+      
+      pChild = &pParam->pTrieNodes[pParam->trieNodeNum];
+      pChild->pWord = pPaths[lo].pItems[depth].pWord;
+      pChild->pIsEnd = 0;
+      pChild->parent = v;
+      pChild->subtreeSize = 0;
+      pChild->wildcardMin = pPaths[lo].pItems[depth].wildcardMin;
+      pChild->wildcardMax = pPaths[lo].pItems[depth].wildcardMax;
+      
+      pLo[pParam->trieNodeNum] = lo;
+      pHi[pParam->trieNodeNum] = i;
+      pDepth[pParam->trieNodeNum] = depth + 1;
+      
+      pParam->trieNodeNum++;
+      pNode->childNum++;
+      lo = i;
     }
   }
   
-  pParam->pPrefixRoot = pRoot;
+  /* A child comes after its parent in the array. */
+  for (v = pParam->trieNodeNum - 1; v > 0; v--)
+  {
+    pNode = &pParam->pTrieNodes[v];
+    pParam->pTrieNodes[pNode->parent].subtreeSize += pNode->subtreeSize + 1;
+  }
   
-  //Returning a local variable shall cause warning. Anyway, it has been stored 
-  //in pParam->pPrefixRoot. 
-  //PS: pRoot is not a local variable. It is in heap. 
-  return pRoot;
+  free((void *) pLo);
+  free((void *) pHi);
+  free((void *) pDepth);
+  free((void *) pPaths);
+  free((void *) pItems);
 }
 
-static void insert_cluster_into_trie(struct TrieNode *pRoot, struct Cluster 
-  *pCluster, struct Parameters *pParam)
+/* Return the paths of all the cluster candidates through the prefix tree, in
+ the order of the column store. For every constant, the path has the wildcard
+ before the constant (if any) and the constant itself, and at last the 
+ wildcard after the last constant (if any). The items of all the paths are in
+ one array, which is returned in *ppItems. */
+static struct TriePath *collect_trie_paths(wordnumber_t *pPathNum,
+        struct TrieItem **ppItems, struct Parameters *pParam)
 {
-  int i;
-  int wildcardMin, wildcardMax;
-  struct TrieNode *ptr;
-  ptr = pRoot;
+  struct CandidateGroup *pGroup;
+  struct TriePath *pPaths, *pPath;
+  struct TrieItem *pItem;
+  struct Cluster *pCluster;
+  wordnumber_t pathNum, itemNum, j;
+  int i, k;
   
-  for (i = 1; i <= pCluster->constants; i++)
+  pathNum = 0;
+  itemNum = 0;
+  for (i = 1; i <= pParam->biggestConstants; i++)
   {
-    if (pCluster->fullWildcard[i * 2 + 1] != 0)
+    pathNum += pParam->pCandidateGroups[i].num;
+    itemNum += pParam->pCandidateGroups[i].num * (2 * i + 1);
+  }
+  
+  pPaths = (struct TriePath *) malloc(sizeof(struct TriePath) * 
+                     (pathNum + 1));
+  *ppItems = (struct TrieItem *) malloc(sizeof(struct TrieItem) * 
+                      (itemNum + 1));
+  if (!pPaths || !*ppItems)
+  {
+    log_msg(MALLOC_ERR_6037, LOG_ERR, pParam);
+    exit(1);
+  }
+  
+  pPath = pPaths;
+  pItem = *ppItems;
+  
+  for (i = 1; i <= pParam->biggestConstants; i++)
+  {
+    pGroup = &pParam->pCandidateGroups[i];
+    for (j = 0; j < pGroup->num; j++)
     {
-      //insert_wild_card
-      wildcardMin = pCluster->fullWildcard[i * 2];
-      wildcardMax = pCluster->fullWildcard[i * 2 + 1];
-      if (insert_cluster_into_trie_wildcard(ptr, wildcardMin, wildcardMax,
-                          pParam))
-      {
-        //Found
-        ptr = pParam->pPrefixRet;
-      }
-      else
+      pCluster = pGroup->ppClusters[j];
+      pPath->pItems = pItem;
+      pPath->pCluster = pCluster;
+      
+      for (k = 1; k <= i; k++)
       {
-        //Not found
-        pParam->prefixWildcardMin = wildcardMin;
-        pParam->prefixWildcardMax = wildcardMax;
+        if (pCluster->fullWildcard[k * 2 + 1] != 0)
+        {
+          pItem->pWord = 0;
+          pItem->wildcardMin = pCluster->fullWildcard[k * 2];
+          pItem->wildcardMax = pCluster->fullWildcard[k * 2 + 1];
+          pItem++;
+        }
         
-        ptr = create_trie_node(0, ptr, pParam->pPrefixRet, pParam);
+        pItem->pWord = pCluster->ppWord[k];
+        pItem->wildcardMin = 0;
+        pItem->wildcardMax = 0;
+        pItem++;
       }
       
-      //insert_word
-      if (insert_cluster_into_trie_word(ptr, pCluster->ppWord[i], pParam))
+      // Deal with the tail.
+      if (pCluster->fullWildcard[1] != 0)
       {
-        //Found
-        ptr = pParam->pPrefixRet;
-      }
-      else
-      {   //Not found
-        ptr = create_trie_node(pCluster->ppWord[i], ptr,
-                     pParam->pPrefixRet, pParam);
+        pItem->pWord = 0;
+        pItem->wildcardMin = pCluster->fullWildcard[0];
+        pItem->wildcardMax = pCluster->fullWildcard[1];
+        pItem++;
       }
       
-    }
-    else
-    {
-      //insert_word
-      if (insert_cluster_into_trie_word(ptr, pCluster->ppWord[i], pParam))
-      {
-        //Found
-        ptr = pParam->pPrefixRet;
-      }
-      else
-      {   //Not found
-        ptr = create_trie_node(pCluster->ppWord[i], ptr,
-                     pParam->pPrefixRet, pParam);
-      }
+      pPath->itemNum = (int) (pItem - pPath->pItems);
+      pPath++;
     }
   }
   
-  // Deal with the tail.
-  if (pCluster->fullWildcard[1] != 0)
+  *pPathNum = pathNum;
+  return pPaths;
+}
+
+/* The order of the children of a node: the wildcards first, by their minimum
+ and maximum, then the constants by their word numbers. */
+static int compare_trie_items(struct TrieItem *pItem1, 
+        struct TrieItem *pItem2)
+{
+  if (!pItem1->pWord || !pItem2->pWord)
   {
-    //insert_wild_card
-    wildcardMin = pCluster->fullWildcard[0];
-    wildcardMax = pCluster->fullWildcard[1];
-    if (insert_cluster_into_trie_wildcard(ptr, wildcardMin, wildcardMax,
-                        pParam))
+    if (pItem1->pWord)
     {
-      //Found
-      ptr = pParam->pPrefixRet;
+      return 1;
     }
-    else
+    
+    if (pItem2->pWord)
     {
-      //Not found
-      pParam->prefixWildcardMin = wildcardMin;
-      pParam->prefixWildcardMax = wildcardMax;
-      
-      ptr = create_trie_node(0, ptr, pParam->pPrefixRet, pParam);
+      return -1;
     }
+    
+    if (pItem1->wildcardMin != pItem2->wildcardMin)
+    {
+      return pItem1->wildcardMin < pItem2->wildcardMin ? -1 : 1;
+    }
+    
+    if (pItem1->wildcardMax != pItem2->wildcardMax)
+    {
+      return pItem1->wildcardMax < pItem2->wildcardMax ? -1 : 1;
+    }
+    
+    return 0;
   }
   
-  ptr->pIsEnd = pCluster;
-  pCluster->pLastNode = ptr;
+  if (pItem1->pWord->number != pItem2->pWord->number)
+  {
+    return pItem1->pWord->number < pItem2->pWord->number ? -1 : 1;
+  }
+  
+  return 0;
 }
 
-/* Insert wildcard into trie. */
-static int insert_cluster_into_trie_wildcard(struct TrieNode *pParent, int min,
-                    int max, struct Parameters *pParam)
+/* The paths are compared item by item, and a path sorts before the paths it
+ is a prefix of. */
+static int compare_trie_paths(const void *p1, const void *p2)
 {
-  struct TrieNode *ptr;
-  ptr = pParent->pChild;
+  const struct TriePath *pPath1, *pPath2;
+  int i, ret;
+  
+  pPath1 = (const struct TriePath *) p1;
+  pPath2 = (const struct TriePath *) p2;
   
-  while (ptr)
+  for (i = 0; i < pPath1->itemNum && i < pPath2->itemNum; i++)
   {
-    if (ptr->hashValue == pParam->wildcardHash)
-    {
-      if (ptr->wildcardMin == min && ptr->wildcardMax == max)
-      {
-        pParam->pPrefixRet = ptr;
-        return 1;
-      }
-      else
-      {
-        ptr = ptr->pNext;
-      }
-      
-    }
-    else
+    ret = compare_trie_items(&pPath1->pItems[i], &pPath2->pItems[i]);
+    if (ret)
     {
-      pParam->pPrefixRet = 0;
-      return 0;
+      return ret;
     }
   }
   
-  pParam->pPrefixRet = 0;
-  return 0;
+  return pPath1->itemNum - pPath2->itemNum;
 }
 
-/* Insert constant into trie. */
-static int insert_cluster_into_trie_word(struct TrieNode *pParent, 
-        struct Elem *pWord, struct Parameters *pParam)
+/* There is a potential support value overlapping problem. Though rare, because
+ the order I select cluster candidates to aggregate is from small constants to
+ big constants, it could still happen.
+ 
+ I am thinking of using the count in {struct Elem} as a mid-way storage,
+ therefore the count in {struct Cluster} remains the unchanged during the
+ aggregate process. After the aggregate process is done for every cluster
+ candidates, transfer the count in {struct Elem} to {struct Cluster}. 
+ 
+ This solution has been implemented. 
+ 
+ The candidates are taken from the column store, whose wildcard rows tell
+ which candidates have a wildcard at all. */
+static void aggregate_candidates(struct Parameters *pParam)
 {
-  wordnumber_t hash;
-  struct TrieNode *ptr, *pPrev;
-  
-  hash = str2hash(pWord->pKey, pParam->prefixSketchSize,
-          pParam->prefixSketchSeed);
-  
-  ptr = pParent->pChild;
-  pPrev = 0;
+  struct CandidateGroup *pGroup;
+  struct AggregateMemo memo;
+  struct Cluster *ptr;
+  wordnumber_t lookups, hits, j;
+  char logStr[MAXLOGMSGLEN];
+  char digit[MAXDIGITBIT];
+  char digit2[MAXDIGITBIT];
+  int i;
   
-  while (ptr)
+  if (pParam->threadNum > 1)
   {
-    if (ptr->hashValue > hash)
-    {
-      pPrev = ptr;
-      ptr = ptr->pNext;
-      continue;
-    }
+    aggregate_candidates_in_parallel(&lookups, &hits, pParam);
+  }
+  else
+  {
+    init_aggregate_memo(&memo, pParam);
     
-    if (ptr->hashValue == hash)
+    for (i = 1; i <= pParam->biggestConstants; i++)
     {
-      if (!strcmp(ptr->pWord->pKey, pWord->pKey))
+      pGroup = &pParam->pCandidateGroups[i];
+      for (j = 0; j < pGroup->num; j++)
       {
-        pParam->pPrefixRet = ptr;
-        return 1;
-      }
-      else
-      {
-        pPrev = ptr;
-        ptr = ptr->pNext;
-        continue;
+        if (has_wildcard(CANDIDATE_WILDCARDS(pGroup, j), i))
+        {
+          aggregate_candidate(pGroup->ppClusters[j], &memo, pParam);
+        }
       }
-      
     }
     
-    if (ptr->hashValue < hash)
+    lookups = memo.lookups;
+    hits = memo.hits;
+    free((void *) memo.pEntries);
+  }
+  
+  str_format_int_grouped(digit, hits);
+  str_format_int_grouped(digit2, lookups);
+  sprintf(logStr, "%s of %s searches of the prefix tree were cached.", digit,
+      digit2);
+  log_msg(logStr, LOG_INFO, pParam);
+  
+  /* After aggregation is done, assign each cluster candidates with the
+   post-processed support value. ptr->pElem->count acts as a mid transfer. */
+  for (i = 1; i <= pParam->biggestConstants; i++)
+  {
+    pGroup = &pParam->pCandidateGroups[i];
+    for (j = 0; j < pGroup->num; j++)
     {
-      pParam->pPrefixRet = pPrev;
-      return 0;
+      ptr = pGroup->ppClusters[j];
+      ptr->count = ptr->pElem->count;
     }
   }
-  
-  pParam->pPrefixRet = pPrev;
-  return 0;
 }
 
-/* The first parameter indicates whether the node is constant or wildcard. If
- node is constant, it will be the pointer of {struct Elem}. If node is
- wildcard, it will be null(0). */
-static struct TrieNode *create_trie_node(struct Elem *pElem, 
-        struct TrieNode *pParent, struct TrieNode *pPrev, 
-        struct Parameters *pParam)
+/* Aggregate the candidates with pParam->threadNum threads. The prefix tree
+ and the counts of the candidates in {struct Cluster} are only read, and the
+ aggregated support of a candidate is only written to its own pElem->count,
+ by the thread that has taken the candidate. Thus the threads need neither
+ locks nor atomic counts, and the result does not depend on their number.
+ 
+ The costs of the candidates differ a lot, depending on how high in the tree
+ their first wildcard is, so the candidates are not split evenly in advance.
+ Instead, every thread takes the next AGGREGATE_CHUNK_SIZE candidates from a
+ shared cursor whenever it is done with its chunk, until none are left. */
+static void aggregate_candidates_in_parallel(wordnumber_t *pLookups,
+        wordnumber_t *pHits, struct Parameters *pParam)
 {
-  struct TrieNode *pNode = (struct TrieNode *) malloc(sizeof(struct TrieNode));
-  if (!pNode)
+  struct AggregateTask tasks[MAXTHREADS];
+  pthread_t threads[MAXTHREADS];
+  pthread_attr_t attr;
+  struct CandidateGroup *pGroup;
+  struct Cluster **ppCandidates;
+  wordnumber_t candidateNum, cursor, j;
+  char logStr[MAXLOGMSGLEN];
+  int i;
+  
+  candidateNum = 0;
+  for (i = 1; i <= pParam->biggestConstants; i++)
   {
-    log_msg(MALLOC_ERR_6002, LOG_ERR, pParam);
-    exit(1);
+    candidateNum += pParam->pCandidateGroups[i].num;
   }
   
-  pParam->trieNodeNum++;
-  
-  if (pElem == 0)
+  ppCandidates = (struct Cluster **) malloc(sizeof(struct Cluster *) * 
+                        (candidateNum + 1));
+  if (!ppCandidates)
   {
-    pNode->hashValue = pParam->wildcardHash;
-    pNode->wildcardMin = pParam->prefixWildcardMin;
-    pNode->wildcardMax = pParam->prefixWildcardMax;
+    log_msg(MALLOC_ERR_6038, LOG_ERR, pParam);
+    exit(1);
   }
-  else
+  
+  candidateNum = 0;
+  for (i = 1; i <= pParam->biggestConstants; i++)
   {
-    pNode->hashValue = str2hash(pElem->pKey, pParam->prefixSketchSize,
-                  pParam->prefixSketchSeed);
-    pNode->wildcardMin = 0;
-    pNode->wildcardMax = 0;
+    pGroup = &pParam->pCandidateGroups[i];
+    for (j = 0; j < pGroup->num; j++)
+    {
+      if (has_wildcard(CANDIDATE_WILDCARDS(pGroup, j), i))
+      {
+        ppCandidates[candidateNum++] = pGroup->ppClusters[j];
+      }
+    }
   }
   
-  pNode->pWord = pElem;
-  
-  pNode->pParent = pParent;
-  pNode->pChild = 0;
+  cursor = 0;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, WORKER_STACK_SIZE);
   
-  if (pPrev != 0)
+  for (i = 0; i < pParam->threadNum; i++)
   {
-    pNode->pNext = pPrev->pNext;
-    pPrev->pNext = pNode;
+    tasks[i].ppCandidates = ppCandidates;
+    tasks[i].candidateNum = candidateNum;
+    tasks[i].pCursor = &cursor;
+    tasks[i].pParam = pParam;
+    init_aggregate_memo(&tasks[i].memo, pParam);
+    if (pthread_create(&threads[i], &attr, aggregate_task_main, &tasks[i]))
+    {
+      sprintf(logStr, "Can't create aggregation thread %d", i);
+      log_msg(logStr, LOG_ERR, pParam);
+      exit(1);
+    }
   }
-  else
+  
+  *pLookups = 0;
+  *pHits = 0;
+  
+  for (i = 0; i < pParam->threadNum; i++)
   {
-    pNode->pNext = pParent->pChild;
-    pParent->pChild = pNode;
+    pthread_join(threads[i], 0);
+    *pLookups += tasks[i].memo.lookups;
+    *pHits += tasks[i].memo.hits;
+    free((void *) tasks[i].memo.pEntries);
   }
   
-  pNode->pIsEnd = 0;
-  
-  return pNode;
+  pthread_attr_destroy(&attr);
+  free((void *) ppCandidates);
 }
 
-/* There is a potential support value overlapping problem. Though rare, because
- the order I select cluster candidates to aggregate is from small constants to
- big constants, it could still happen.
- 
- I am thinking of using the count in {struct Elem} as a mid-way storage,
- therefore the count in {struct Cluster} remains the unchanged during the
- aggregate process. After the aggregate process is done for every cluster
- candidates, transfer the count in {struct Elem} to {struct Cluster}. 
- 
- This solution has been implemented. */
-static void aggregate_candidates(struct Parameters *pParam)
+static void *aggregate_task_main(void *pArg)
 {
-  int i;
-  struct Cluster *ptr;
+  struct AggregateTask *pTask;
+  wordnumber_t start, end, j;
   
-  for (i = 1; i <= pParam->biggestConstants; i++)
+  pTask = (struct AggregateTask *) pArg;
+  
+  for (;;)
   {
-    ptr = pParam->pClusterFamily[i];
-    while (ptr)
+    start = __sync_fetch_and_add(pTask->pCursor, AGGREGATE_CHUNK_SIZE);
+    if (start >= pTask->candidateNum)
     {
-      if (get_first_wildcard_location(ptr) >= 0)
-      {
-        aggregate_candidate(ptr, pParam);
-      }
-      ptr = ptr->pNext;
+      break;
+    }
+    
+    end = start + AGGREGATE_CHUNK_SIZE;
+    if (end > pTask->candidateNum)
+    {
+      end = pTask->candidateNum;
+    }
+    
+    for (j = start; j < end; j++)
+    {
+      aggregate_candidate(pTask->ppCandidates[j], &pTask->memo, 
+                pTask->pParam);
     }
   }
   
-  /* After aggregation is done, assign each cluster candidates with the
-   post-processed support value. ptr->pElem->count acts as a mid transfer. */
-  for (i = 1; i <= pParam->biggestConstants; i++)
+  return 0;
+}
+
+static void init_aggregate_memo(struct AggregateMemo *pMemo, 
+        struct Parameters *pParam)
+{
+  pMemo->pEntries = (struct AggregateMemoEntry *) 
+            calloc(AGGREGATE_MEMO_SIZE, sizeof(struct AggregateMemoEntry));
+  if (!pMemo->pEntries)
+  {
+    log_msg(MALLOC_ERR_6039, LOG_ERR, pParam);
+    exit(1);
+  }
+  
+  pMemo->lookups = 0;
+  pMemo->hits = 0;
+}
+
+/* Whether a candidate with the given wildcard ranges (in the layout of
+ fullWildcard) has any wildcard, i.e. get_first_wildcard_location() >= 0. */
+static char has_wildcard(int *pWildcards, int constants)
+{
+  int i;
+  
+  for (i = 0; i <= constants; i++)
   {
-    ptr = pParam->pClusterFamily[i];
-    while (ptr)
+    if (pWildcards[i * 2 + 1])
     {
-      ptr->count = ptr->pElem->count;
-      
-      ptr = ptr->pNext;
+      return 1;
     }
   }
+  
+  return 0;
 }
 
 /* Find the first wildcard of a cluster candidates, counting from left to
@@ -415,26 +593,30 @@ static int get_first_wildcard_location(struct Cluster *pCluster)
   return -1;
 }
 
-/* This function is called by function aggregate_candidates(). */
+/* This function is called by function aggregate_candidates(). The search
+ finds the candidate itself as well, whose count is not aggregated.
+ A more specific candidate has all the constants of the candidate, so if the
+ inverted index has no other candidate with them, there is nothing to
+ search for. */
 static void aggregate_candidate(struct Cluster *pCluster, 
-        struct Parameters *pParam)
+        struct AggregateMemo *pMemo, struct Parameters *pParam)
 {
   struct TrieNode *pParent;
   int firstWildcardLoc;
-  wordnumber_t hash;
   
-  firstWildcardLoc = get_first_wildcard_location(pCluster);
-  hash = 0;
-  
-  if (firstWildcardLoc)
+  if (!has_other_candidate_with_words(pCluster, &pParam->clusterIndex))
   {
-    hash = str2hash(pCluster->ppWord[firstWildcardLoc]->pKey,
-            pParam->prefixSketchSize, pParam->prefixSketchSeed);
+    return;
   }
   
-  pParent = get_common_parent(pCluster);
-  find_more_specific(pParent, pCluster, firstWildcardLoc, 0, 0, hash, pParam);
+  firstWildcardLoc = get_first_wildcard_location(pCluster);
   
+  /* No other candidate has the same common parent and the same rest, so this
+   search is not cached. */
+  pParent = get_common_parent(pCluster, pParam);
+  pCluster->pElem->count += find_more_specific(pParent, pCluster, 
+                   firstWildcardLoc, 0, 0, pMemo, pParam) - 
+                   pCluster->count;
 }
 
 /* Find the common parent of a cluster candidate. From this node on, who is
@@ -442,18 +624,19 @@ static void aggregate_candidate(struct Cluster *pCluster,
  branches have potential of being specified expressions of our cluster
  candidate, thus their support values can be aggregated to our cluster
  candidate's support value. */
-static struct TrieNode *get_common_parent(struct Cluster *pCluster)
+static struct TrieNode *get_common_parent(struct Cluster *pCluster,
+        struct Parameters *pParam)
 {
   struct TrieNode *ptr;
   int reverseDepth;
   int i;
   
   reverseDepth = get_first_wildcard_reverse_depth(pCluster);
-  ptr = pCluster->pLastNode;
+  ptr = &pParam->pTrieNodes[pCluster->lastNode];
   
   for (i = 1; i <= reverseDepth; i++)
   {
-    ptr = ptr->pParent;
+    ptr = &pParam->pTrieNodes[ptr->parent];
   }
   
   /* ptr is the parent of the first wildcard node. */
@@ -499,25 +682,128 @@ static int get_first_wildcard_reverse_depth(struct Cluster *pCluster)
   return reverseDepth;  
 }
 
+/* The hash value of the part of a cluster candidate that is searched by
+ find_more_specific(pParent, pCluster, constant, 0, 0): the constants from
+ constant on with the wildcards before them, and the tail. */
+static tableindex_t hash_suffix(struct Cluster *pCluster, int constant)
+{
+  tableindex_t hash;
+  int i;
+  
+  hash = (tableindex_t) pCluster->fullWildcard[0] << 16 ^ 
+       (tableindex_t) pCluster->fullWildcard[1];
+  
+  for (i = constant ? constant : pCluster->constants + 1; 
+     i <= pCluster->constants; i++)
+  {
+    hash = (hash ^ pCluster->ppWord[i]->number) * 0x9E3779B97F4A7C15UL;
+    hash = (hash ^ (tableindex_t) pCluster->fullWildcard[i * 2] << 16 ^
+        (tableindex_t) pCluster->fullWildcard[i * 2 + 1]) * 
+        0x9E3779B97F4A7C15UL;
+  }
+  
+  return hash ^ hash >> 32;
+}
+
+/* Whether the parts of two cluster candidates that hash_suffix() hashes are
+ the same. */
+static char is_same_suffix(struct Cluster *pCluster1, int constant1,
+        struct Cluster *pCluster2, int constant2)
+{
+  int i, num;
+  
+  num = constant1 ? pCluster1->constants - constant1 + 1 : 0;
+  if (num != (constant2 ? pCluster2->constants - constant2 + 1 : 0) ||
+    pCluster1->fullWildcard[0] != pCluster2->fullWildcard[0] ||
+    pCluster1->fullWildcard[1] != pCluster2->fullWildcard[1])
+  {
+    return 0;
+  }
+  
+  for (i = 0; i < num; i++)
+  {
+    if (pCluster1->ppWord[constant1 + i] != pCluster2->ppWord[constant2 + i] ||
+      pCluster1->fullWildcard[(constant1 + i) * 2] != 
+      pCluster2->fullWildcard[(constant2 + i) * 2] ||
+      pCluster1->fullWildcard[(constant1 + i) * 2 + 1] != 
+      pCluster2->fullWildcard[(constant2 + i) * 2 + 1])
+    {
+      return 0;
+    }
+  }
+  
+  return 1;
+}
+
+/* Works like find_more_specific(pParent, pCluster, constant, 0, 0), i.e. a 
+ search that begins below a node that matches the constant before constant
+ (or the last one, if constant is 0).
+ Many general candidates that share their common parent and the following
+ constant search the same subtrees with the same rest of the candidate, e.g.
+ after their first wildcards. The answers are cached in pMemo, keyed on the
+ node and the rest of the candidate, so that such a search is only done once
+ as long as its answer stays in the cache. */
+static support_t find_more_specific_cached(struct TrieNode *pParent, 
+        struct Cluster *pCluster, int constant, struct AggregateMemo *pMemo,
+        struct Parameters *pParam)
+{
+  struct AggregateMemoEntry *pEntry;
+  tableindex_t hash;
+  unsigned int node;
+  
+  node = (unsigned int) (pParent - pParam->pTrieNodes);
+  hash = hash_suffix(pCluster, constant);
+  pEntry = &pMemo->pEntries[(hash ^ node * 0x9E3779B97F4A7C15UL) >> 48 & 
+                (AGGREGATE_MEMO_SIZE - 1)];
+  pMemo->lookups++;
+  
+  if (pEntry->pCluster && pEntry->node == node && pEntry->hash == hash &&
+    is_same_suffix(pEntry->pCluster, pEntry->constant, pCluster, constant))
+  {
+    pMemo->hits++;
+    return pEntry->sum;
+  }
+  
+  pEntry->sum = find_more_specific(pParent, pCluster, constant, 0, 0, pMemo,
+                     pParam);
+  pEntry->pCluster = pCluster;
+  pEntry->hash = hash;
+  pEntry->node = node;
+  pEntry->constant = constant;
+  
+  return pEntry->sum;
+}
+
 /* The function to find the more specific cluster candidates for a certain
- cluster candidate. */
-static int find_more_specific(struct TrieNode *pParent, 
+ cluster candidate. Returns the total count of the candidates that were
+ found. */
+static support_t find_more_specific(struct TrieNode *pParent, 
         struct Cluster *pCluster, int constant, int min, int max, 
-        wordnumber_t hash, struct Parameters *pParam)
+        struct AggregateMemo *pMemo, struct Parameters *pParam)
 {
-  struct TrieNode *ptr;
-  wordnumber_t hashTmp;
+  struct TrieNode *ptr, *pChildren;
+  struct Elem *pWord;
+  support_t sum;
+  unsigned int k;
+  int wildcardMin, wildcardMax;
   
   /* To find the 0st constant, means to deal with the tail of the cluster
    candidates. */
   if (constant == 0)
   {
-    find_more_specific_tail(pParent, pCluster, min, max);
-    return 0;
+    return find_more_specific_tail(pParent, pCluster, min, max, pParam);
   }
   
-  for (ptr = pParent->pChild; ptr; ptr = ptr->pNext)
+  sum = 0;
+  wildcardMin = pCluster->fullWildcard[constant * 2];
+  wildcardMax = pCluster->fullWildcard[constant * 2 + 1];
+  pWord = pCluster->ppWord[constant];
+  
+  pChildren = &pParam->pTrieNodes[pParent->firstChild];
+  for (k = 0; k < pParent->childNum; k++)
   {
+    ptr = &pChildren[k];
+    
     if (ptr->wildcardMax == 0)
     {
       min += 1;
@@ -531,9 +817,10 @@ static int find_more_specific(struct TrieNode *pParent,
     
     /* If the jump time is not enough to statisfy the minimum wildcard, jump
      down the tree once more, still looking for this constant. */
-    if (min - 1 < pCluster->fullWildcard[constant * 2])
+    if (min - 1 < wildcardMin)
     {
-      find_more_specific(ptr, pCluster, constant, min, max, hash, pParam);
+      sum += find_more_specific(ptr, pCluster, constant, min, max, pMemo,
+                    pParam);
       
       /* This node is done. Deal with its brothers. */
       if (ptr->wildcardMax == 0)
@@ -549,7 +836,7 @@ static int find_more_specific(struct TrieNode *pParent,
       continue;
     }
     
-    if (max - 1 > pCluster->fullWildcard[(constant * 2) + 1])
+    if (max - 1 > wildcardMax)
     {
       /* Jumped over the maximum limit. Not possible to be more specific
        cluster candidate anymore. */
@@ -568,18 +855,14 @@ static int find_more_specific(struct TrieNode *pParent,
       continue;
     }
     
-    if (ptr->hashValue == hash &&
-      (!strcmp(ptr->pWord->pKey, pCluster->ppWord[constant]->pKey)))
+    if (ptr->pWord == pWord)
     {   //Found
       /* The constants are not all found, continue to look up next
        constant. */
       if (constant < pCluster->constants)
       {
-        hashTmp = str2hash(pCluster->ppWord[constant + 1]->pKey,
-                   pParam->prefixSketchSize,
-                   pParam->prefixSketchSeed);
-        find_more_specific(ptr, pCluster, constant + 1, 0, 0, hashTmp,
-                   pParam);
+        sum += FIND_MORE_SPECIFIC_BELOW(ptr, pCluster, constant + 1, pMemo,
+                        pParam);
         
         /* After coming back, continue to deal with brothers. */
         if (ptr->wildcardMax == 0)
@@ -606,11 +889,11 @@ static int find_more_specific(struct TrieNode *pParent,
          aggregate the support value. */
         if (pCluster->fullWildcard[1] == 0)
         {
-          if (ptr->pIsEnd && (ptr->pIsEnd != pCluster))
+          if (ptr->pIsEnd)
           {
             //aggregate support
             //pCluster->count += ptr->pIsEnd->count;
-            pCluster->pElem->count += ptr->pIsEnd->count;
+            sum += ptr->pIsEnd->count;
           }
           
           /* Continue to deal with its brothers. */
@@ -632,15 +915,14 @@ static int find_more_specific(struct TrieNode *pParent,
            parameter is set to 0, which is different from normal
            cases, and will trigger function find_more_specific_tail().
            */
-          if (pCluster->fullWildcard[0] == 0 && ptr->pIsEnd &&
-            (ptr->pIsEnd != pCluster))
+          if (pCluster->fullWildcard[0] == 0 && ptr->pIsEnd)
           {
             //aggregate support
             //pCluster->count += ptr->pIsEnd->count;
-            pCluster->pElem->count += ptr->pIsEnd->count;
+            sum += ptr->pIsEnd->count;
           }
           
-          find_more_specific(ptr, pCluster, 0, 0, 0, hash, pParam);
+          sum += FIND_MORE_SPECIFIC_BELOW(ptr, pCluster, 0, pMemo, pParam);
           
           if (ptr->wildcardMax == 0)
           {
@@ -659,7 +941,8 @@ static int find_more_specific(struct TrieNode *pParent,
     }
     else
     {
-      find_more_specific(ptr, pCluster, constant, min, max, hash, pParam);
+      sum += find_more_specific(ptr, pCluster, constant, min, max, pMemo,
+                    pParam);
       
       if (ptr->wildcardMax == 0)
       {
@@ -675,16 +958,23 @@ static int find_more_specific(struct TrieNode *pParent,
     }
   }
   
-  return 0;
+  return sum;
 }
 
-static int find_more_specific_tail(struct TrieNode *pParent, 
-        struct Cluster*pCluster, int min, int max)
+static support_t find_more_specific_tail(struct TrieNode *pParent, 
+        struct Cluster*pCluster, int min, int max, struct Parameters *pParam)
 {
-  struct TrieNode *ptr;
+  struct TrieNode *ptr, *pChildren;
+  support_t sum;
+  unsigned int k;
   
-  for (ptr = pParent->pChild; ptr; ptr = ptr->pNext)
+  sum = 0;
+  
+  pChildren = &pParam->pTrieNodes[pParent->firstChild];
+  for (k = 0; k < pParent->childNum; k++)
   {
+    ptr = &pChildren[k];
+    
     if (ptr->wildcardMax == 0)
     {
       min += 1;
@@ -698,7 +988,7 @@ static int find_more_specific_tail(struct TrieNode *pParent,
     
     if (min < pCluster->fullWildcard[0])
     {
-      find_more_specific_tail(ptr, pCluster, min, max);
+      sum += find_more_specific_tail(ptr, pCluster, min, max, pParam);
       if (ptr->wildcardMax == 0)
       {
         min -= 1;
@@ -731,14 +1021,14 @@ static int find_more_specific_tail(struct TrieNode *pParent,
       continue;
     }
     
-    if (ptr->pIsEnd && (ptr->pIsEnd != pCluster))
+    if (ptr->pIsEnd)
     {
       //aggregate support
       //pCluster->count += ptr->pIsEnd->count;
-      pCluster->pElem->count += ptr->pIsEnd->count;
+      sum += ptr->pIsEnd->count;
     }
     
-    find_more_specific_tail(ptr, pCluster, min, max);
+    sum += find_more_specific_tail(ptr, pCluster, min, max, pParam);
     if (ptr->wildcardMax == 0)
     {
       min -= 1;
@@ -752,5 +1042,5 @@ static int find_more_specific_tail(struct TrieNode *pParent,
     //continue;
   }
   
-  return 0;
+  return sum;
 }
\ No newline at end of file
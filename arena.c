@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2016 Zhuge Chen, Risto Vaarandi and Mauno Pihelgas
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/* 
+ * File:   arena.c
+ * 
+ * Content: Functions related to the bump-pointer arenas, from which the hash
+ * table elements, cluster instances and prefix tree nodes are allocated.
+ *
+ * Every phase of the program has its own arena in struct Parameters. An object
+ * is allocated by moving a pointer forward in the current block, and is never
+ * freed alone. free_and_clean_step_N() releases the whole arena of a phase at
+ * once, with one munmap() per block.
+ *
+ * Created on October 16, 2026, 5:05 PM
+ */
+
+/* For MAP_ANONYMOUS. */
+#define _DEFAULT_SOURCE
+
+#include "common_header.h"
+#include "arena.h"
+
+#include <string.h>    /* for memcpy() */
+#include <sys/mman.h>  /* for mmap() and munmap() */
+
+#include "output.h"
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+static struct ArenaBlock *create_arena_block(size_t size, 
+        struct Parameters *pParam);
+
+void init_arena(struct Arena *pArena, size_t blockSize)
+{
+  pArena->pBlocks = 0;
+  pArena->blockSize = blockSize;
+}
+
+/* Allocate size bytes from the arena, aligned to ARENA_ALIGN. A new block is
+ started when the current one is full, the rest of the old block is left
+ unused. */
+void *arena_alloc(struct Arena *pArena, size_t size, 
+        struct Parameters *pParam)
+{
+  struct ArenaBlock *pBlock;
+  size_t blockSize;
+  void *ptr;
+  
+  size = (size + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+  pBlock = pArena->pBlocks;
+  
+  if (!pBlock || pBlock->used + size > pBlock->size)
+  {
+    blockSize = pArena->blockSize;
+    if (size + sizeof(struct ArenaBlock) > blockSize)
+    {
+      blockSize = size + sizeof(struct ArenaBlock);
+    }
+    
+    pBlock = create_arena_block(blockSize, pParam);
+    pBlock->pNext = pArena->pBlocks;
+    pArena->pBlocks = pBlock;
+  }
+  
+  ptr = (char *) pBlock + pBlock->used;
+  pBlock->used += size;
+  
+  return ptr;
+}
+
+/* Copy the len bytes of pStr into the arena, and terminate the copy with 0. */
+char *arena_strndup(struct Arena *pArena, char *pStr, int len, 
+        struct Parameters *pParam)
+{
+  char *pCopy;
+  
+  pCopy = (char *) arena_alloc(pArena, len + 1, pParam);
+  memcpy(pCopy, pStr, len);
+  pCopy[len] = 0;
+  
+  return pCopy;
+}
+
+/* Move all the blocks of pSrc into pDst, e.g. when the elements of the private
+ table of a worker thread are merged into the global table. pSrc is empty
+ afterwards. The current block of pDst stays in front, so that it is filled
+ further. */
+void adopt_arena(struct Arena *pDst, struct Arena *pSrc)
+{
+  struct ArenaBlock *pLast;
+  
+  if (!pSrc->pBlocks)
+  {
+    return;
+  }
+  
+  if (!pDst->pBlocks)
+  {
+    pDst->pBlocks = pSrc->pBlocks;
+  }
+  else
+  {
+    for (pLast = pSrc->pBlocks; pLast->pNext; pLast = pLast->pNext);
+    pLast->pNext = pDst->pBlocks->pNext;
+    pDst->pBlocks->pNext = pSrc->pBlocks;
+  }
+  
+  pSrc->pBlocks = 0;
+}
+
+void free_arena(struct Arena *pArena)
+{
+  struct ArenaBlock *pBlock, *pNext;
+  
+  pBlock = pArena->pBlocks;
+  
+  while (pBlock)
+  {
+    pNext = pBlock->pNext;
+    munmap((void *) pBlock, pBlock->size);
+    pBlock = pNext;
+  }
+  
+  pArena->pBlocks = 0;
+}
+
+static struct ArenaBlock *create_arena_block(size_t size, 
+        struct Parameters *pParam)
+{
+  struct ArenaBlock *pBlock;
+  
+  pBlock = (struct ArenaBlock *) mmap(0, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (pBlock == MAP_FAILED)
+  {
+    log_msg(MALLOC_ERR_6028, LOG_ERR, pParam);
+    exit(1);
+  }
+  
+  pBlock->pNext = 0;
+  pBlock->size = size;
+  pBlock->used = (sizeof(struct ArenaBlock) + ARENA_ALIGN - 1) &
+                 ~((size_t) ARENA_ALIGN - 1);
+  
+  return pBlock;
+}
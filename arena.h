@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2016 Zhuge Chen, Risto Vaarandi and Mauno Pihelgas
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/* 
+ * File:   arena.h
+ * 
+ * Content: Declarations of global functions in arena.c .
+ *
+ * Created on October 16, 2026, 5:05 PM
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void init_arena(struct Arena *pArena, size_t blockSize);
+void *arena_alloc(struct Arena *pArena, size_t size, 
+        struct Parameters *pParam);
+char *arena_strndup(struct Arena *pArena, char *pStr, int len, 
+        struct Parameters *pParam);
+void adopt_arena(struct Arena *pDst, struct Arena *pSrc);
+void free_arena(struct Arena *pArena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARENA_H */
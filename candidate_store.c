@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2016 Zhuge Chen, Risto Vaarandi and Mauno Pihelgas
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/* 
+ * File:   candidate_store.c
+ * 
+ * Content: Functions related to the column store of the cluster candidates.
+ *
+ * After Step2.B, the candidates of every pClusterFamily[] list are moved into
+ * a struct CandidateGroup, in the order of the list. The elements of their
+ * constants and their wildcard ranges are kept in two contiguous arrays, one
+ * row per candidate, and ppWord and fullWildcard of every candidate point to
+ * its rows. The arrays that the candidates had while they were found are
+ * released with pParam->candidateArena, so every candidate is stored once.
+ * The scans over all the candidates (the support filter of Step3, the
+ * wildcard test of aggregation, the inverted index of cluster_index.c)
+ * go through ppClusters[] and the rows from start to end, instead of
+ * following pNext. The support of a candidate stays in its struct Cluster.
+ *
+ * Created on October 17, 2026, 12:30 AM
+ */
+
+#include "common_header.h"
+#include "candidate_store.h"
+
+#include <string.h>    /* for memcpy() */
+
+#include "output.h"
+#include "arena.h"
+
+static void alloc_candidate_group(struct CandidateGroup *pGroup, 
+        int constants, wordnumber_t num, struct Parameters *pParam);
+
+static void alloc_candidate_group(struct CandidateGroup *pGroup, 
+        int constants, wordnumber_t num, struct Parameters *pParam)
+{
+  pGroup->constants = constants;
+  pGroup->num = num;
+  
+  if (!num)
+  {
+    pGroup->ppClusters = 0;
+    pGroup->ppWords = 0;
+    pGroup->pWildcards = 0;
+    return;
+  }
+  
+  pGroup->ppClusters = (struct Cluster **) malloc(sizeof(struct Cluster *) * 
+                          num);
+  pGroup->ppWords = (struct Elem **) malloc(sizeof(struct Elem *) * num *
+                        (constants + 1));
+  pGroup->pWildcards = (int *) malloc(sizeof(int) * num * 2 * 
+                     (constants + 1));
+  
+  if (!pGroup->ppClusters || !pGroup->ppWords || !pGroup->pWildcards)
+  {
+    log_msg(MALLOC_ERR_6036, LOG_ERR, pParam);
+    exit(1);
+  }
+}
+
+/* Move the cluster candidates of pClusterFamily[] into
+ pParam->pCandidateGroups[], after the last candidate was found and its
+ wildcard ranges are final. */
+void build_candidate_store(struct Parameters *pParam)
+{
+  struct CandidateGroup *pGroup;
+  struct Cluster *pCluster;
+  wordnumber_t num, j;
+  int i;
+  
+  pParam->pCandidateGroups = (struct CandidateGroup *) 
+               malloc(sizeof(struct CandidateGroup) * 
+                   (pParam->biggestConstants + 1));
+  if (!pParam->pCandidateGroups)
+  {
+    log_msg(MALLOC_ERR_6036, LOG_ERR, pParam);
+    exit(1);
+  }
+  
+  /* Group 0 is not used, like pClusterFamily[0]. */
+  alloc_candidate_group(&pParam->pCandidateGroups[0], 0, 0, pParam);
+  
+  for (i = 1; i <= pParam->biggestConstants; i++)
+  {
+    num = 0;
+    for (pCluster = pParam->pClusterFamily[i]; pCluster; 
+       pCluster = pCluster->pNext)
+    {
+      num++;
+    }
+    
+    pGroup = &pParam->pCandidateGroups[i];
+    alloc_candidate_group(pGroup, i, num, pParam);
+    
+    j = 0;
+    for (pCluster = pParam->pClusterFamily[i]; pCluster; 
+       pCluster = pCluster->pNext)
+    {
+      pGroup->ppClusters[j] = pCluster;
+      
+      memcpy(CANDIDATE_WORDS(pGroup, j), pCluster->ppWord,
+           sizeof(struct Elem *) * (i + 1));
+      memcpy(CANDIDATE_WILDCARDS(pGroup, j), pCluster->fullWildcard,
+           sizeof(int) * 2 * (i + 1));
+      
+      pCluster->ppWord = CANDIDATE_WORDS(pGroup, j);
+      pCluster->fullWildcard = CANDIDATE_WILDCARDS(pGroup, j);
+      
+      j++;
+    }
+  }
+  
+  /* No candidate points to its old arrays any more. */
+  free_arena(&pParam->candidateArena);
+}
+
+/* Keep only the rows of pGroup whose support reaches the threshold, in their
+ order, and link the candidates of these rows into pClusterFamily[] again.
+ A moved row is pointed to by its candidate again. A deleted candidate stays
+ in the cluster table, without words and wildcards. Return the number of the
+ remaining rows. */
+wordnumber_t keep_supported_candidates(struct CandidateGroup *pGroup, 
+        support_t support, struct Parameters *pParam)
+{
+  struct Cluster *pCluster;
+  wordnumber_t i, j;
+  int wordNum, wildcardNum;
+  
+  wordNum = pGroup->constants + 1;
+  wildcardNum = 2 * (pGroup->constants + 1);
+  
+  j = 0;
+  for (i = 0; i < pGroup->num; i++)
+  {
+    pCluster = pGroup->ppClusters[i];
+    
+    if (pCluster->count < support)
+    {
+      pCluster->ppWord = 0;
+      pCluster->fullWildcard = 0;
+      continue;
+    }
+    
+    if (i != j)
+    {
+      pGroup->ppClusters[j] = pCluster;
+      memcpy(CANDIDATE_WORDS(pGroup, j), CANDIDATE_WORDS(pGroup, i),
+           sizeof(struct Elem *) * wordNum);
+      memcpy(CANDIDATE_WILDCARDS(pGroup, j), CANDIDATE_WILDCARDS(pGroup, i),
+           sizeof(int) * wildcardNum);
+      pCluster->ppWord = CANDIDATE_WORDS(pGroup, j);
+      pCluster->fullWildcard = CANDIDATE_WILDCARDS(pGroup, j);
+    }
+    j++;
+  }
+  pGroup->num = j;
+  
+  pParam->pClusterFamily[pGroup->constants] = 0;
+  for (i = j; i > 0; i--)
+  {
+    pGroup->ppClusters[i - 1]->pNext = 
+      pParam->pClusterFamily[pGroup->constants];
+    pParam->pClusterFamily[pGroup->constants] = pGroup->ppClusters[i - 1];
+  }
+  
+  return j;
+}
+
+void free_candidate_store(struct Parameters *pParam)
+{
+  int i;
+  
+  if (!pParam->pCandidateGroups)
+  {
+    return;
+  }
+  
+  for (i = 0; i <= pParam->biggestConstants; i++)
+  {
+    free((void *) pParam->pCandidateGroups[i].ppClusters);
+    free((void *) pParam->pCandidateGroups[i].ppWords);
+    free((void *) pParam->pCandidateGroups[i].pWildcards);
+  }
+  
+  free((void *) pParam->pCandidateGroups);
+  pParam->pCandidateGroups = 0;
+}
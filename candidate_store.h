@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2016 Zhuge Chen, Risto Vaarandi and Mauno Pihelgas
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/* 
+ * File:   candidate_store.h
+ * 
+ * Content: Declarations of global functions in candidate_store.c .
+ *
+ * Created on October 17, 2026, 12:30 AM
+ */
+
+#ifndef CANDIDATE_STORE_H
+#define CANDIDATE_STORE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void build_candidate_store(struct Parameters *pParam);
+wordnumber_t keep_supported_candidates(struct CandidateGroup *pGroup, 
+        support_t support, struct Parameters *pParam);
+void free_candidate_store(struct Parameters *pParam);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CANDIDATE_STORE_H */
@@ -34,17 +34,34 @@
 #include "utility.h"
 #include "word_filter_search_replace.h"
 #include "join_clusters_heuristic.h"
+#include "parallel_processing.h"
+#include "input_reader.h"
+#include "token_cache.h"
+#include "arena.h"
+#include "sketch.h"
+#include "sorting.h"
 
-static tableindex_t create_cluster_candidate_sketch(struct Parameters *pParam);
-static tableindex_t create_cluster_candidate_sketch_with_wfilter(
+static void create_cluster_candidate_sketch(struct Parameters *pParam);
+static void create_cluster_candidate_sketch_with_wfilter(
   struct Parameters *pParam);
-static wordnumber_t create_cluster_candidates_word_dep(struct Parameters 
-  *pParam);
+static void create_cluster_candidate_sketch_from_cache(
+  struct Parameters *pParam);
+static wordnumber_t create_cluster_candidates_word_dep(
+  struct InputChunk *pRegion, struct Parameters *pParam);
 static wordnumber_t create_cluster_candidates_word_dep_with_filter(
+  struct InputChunk *pRegion, struct Parameters *pParam);
+static wordnumber_t create_cluster_candidates(struct InputChunk *pRegion,
+  struct Parameters *pParam);
+static wordnumber_t create_cluster_candidates_with_wfilter(
+  struct InputChunk *pRegion, struct Parameters *pParam);
+static wordnumber_t create_cluster_candidates_from_cache(long start, long end,
   struct Parameters *pParam);
-static wordnumber_t create_cluster_candidates(struct Parameters *pParam);
-static wordnumber_t create_cluster_candidates_with_wfilter(struct Parameters 
-  *pParam);
+static wordnumber_t find_cluster_candidates_in_region(
+  struct InputChunk *pRegion, struct Parameters *pParam);
+static wordnumber_t find_cluster_candidates_in_parallel(
+  struct Parameters *pParam);
+static void find_cluster_candidates_worker(struct WorkerContext *pWorker);
+static int is_word_dep_counted(struct Parameters *pParam);
 
 
 static struct Cluster *create_cluster_instance(struct Elem* pClusterElem,
@@ -53,112 +70,257 @@ static struct Cluster *create_cluster_instance(struct Elem* pClusterElem,
                     struct Parameters *pParam);
 static void adjust_cluster_instance(struct Elem* pClusterElem, int constants,
                int wildcard[], struct Parameters *pParam);
+static void merge_cluster_instance(struct Cluster *pDst, struct Cluster *pSrc);
 
 void step_2_create_cluster_candidate_sketch(struct Parameters *pParam)
 {
   tableindex_t effect;
+  double falsePositive;
   char logStr[MAXLOGMSGLEN];
   char digit[MAXDIGITBIT];
   
   log_msg("Creating the cluster sketch...", LOG_NOTICE, pParam);
-  pParam->pClusterSketch = (unsigned long *)
-  malloc(sizeof(unsigned long) * pParam->clusterSketchSize);
-  if (!pParam->pClusterSketch)
+  init_sketch(&pParam->clusterSketch, pParam->clusterSketchSize,
+        pParam->sketchDepth, pParam->clusterSketchSeed, 1, pParam->support,
+        pParam);
+  
+  if (pParam->bTokenCacheReady)
   {
-    log_msg(MALLOC_ERR_6016, LOG_ERR, pParam);
-    exit(1);
+    create_cluster_candidate_sketch_from_cache(pParam);
   }
-  
-  if (!pParam->pWordFilter)
+  else if (!pParam->pWordFilter)
   {
-    effect = create_cluster_candidate_sketch(pParam);
+    create_cluster_candidate_sketch(pParam);
   }
   else
   {
-    effect = create_cluster_candidate_sketch_with_wfilter(pParam);
+    create_cluster_candidate_sketch_with_wfilter(pParam);
   }
   
+  effect = sketch_oversupport(&pParam->clusterSketch, pParam->support,
+                &falsePositive);
+  
   str_format_int_grouped(digit, effect);
   sprintf(logStr, "%s slots in the cluster sketch >= support threshold.",
       digit);
   log_msg(logStr, LOG_INFO, pParam);
+  
+  sprintf(logStr, "Estimated false positive rate of the cluster sketch: "
+      "%.4f%%", falsePositive * 100);
+  log_msg(logStr, LOG_INFO, pParam);
 }
 
-/* For the sake of computing speed, four brother functions (
- create_cluster_candidates(), create_cluster_candidates_with_wfilter(),
- create_cluster_candidates_word_dep(), and 
- create_cluster_candidates_word_dep_with_filter()) which have similar 
- function but with a few differences to each other are contained in this 
- function in parallel. This design of course brings inconvenience for future
- maintenance, and it will be fixed with better solution in following updates. */
 void step_2_find_cluster_candidates(struct Parameters *pParam)
 {
   char logStr[MAXLOGMSGLEN];
   char digit[MAXDIGITBIT];
-  int i;
+  struct InputChunk *pRegion;
   
   log_msg("Finding cluster candidates...", LOG_NOTICE, pParam);
-  if (!pParam->clusterTableSize)
+  init_hash_table(&pParam->clusterTable, DEF_CLUSTER_TABLE_SIZE,
+          pParam->clusterTableSeed, pParam);
+  
+  /* For option '--wweight'. For the sake of computing speed, the table 
+   building process is integrated into this step (find_cluster_candidates). */
+  if (is_word_dep_counted(pParam))
   {
-    pParam->clusterTableSize = 100 * pParam->freWordNum;
+    init_word_dep_table(&pParam->wordDepTable, DEF_WORD_DEP_TABLE_SIZE, 
+              pParam);
   }
-  pParam->ppClusterTable = (struct Elem **) malloc(sizeof(struct Elem *) *
-                           pParam->clusterTableSize);
-  if (!pParam->ppClusterTable)
+  
+  if (pParam->threadNum > 1)
   {
-    log_msg(MALLOC_ERR_6017, LOG_ERR, pParam);
-    exit(1);
+    pParam->clusterCandiNum = find_cluster_candidates_in_parallel(pParam);
   }
-  
-  /* For option '--wweight'. For the sake of computing speed, the matrix 
-   building process is integrated into this step (find_cluster_candidates). */
-  if (pParam->wordWeightThreshold)
+  else if (pParam->bTokenCacheReady)
   {
-    pParam->wordDepMatrixBreadth = pParam->freWordNum + 1;
-    
-    pParam->wordDepMatrix = (unsigned long *)
-    malloc(sizeof(unsigned long) * pParam->wordDepMatrixBreadth *
-         pParam->wordDepMatrixBreadth);
-    if (!pParam->wordDepMatrix)
-    {
-      log_msg(MALLOC_ERR_6017, LOG_ERR, pParam);
-      exit(1);
-    }
-    
-    for (i = 0; i < pParam->wordDepMatrixBreadth *
-       pParam->wordDepMatrixBreadth; i++)
-    {
-      pParam->wordDepMatrix[i] = 0;
-    }
+    pParam->clusterCandiNum = create_cluster_candidates_from_cache(0,
+                                 pParam->cacheSize, pParam);
+  }
+  else
+  {
+    pRegion = create_whole_input_region(pParam);
+    pParam->clusterCandiNum = find_cluster_candidates_in_region(pRegion,
+                                  pParam);
+    free_region(pRegion);
+  }
     
+  str_format_int_grouped(digit, pParam->clusterCandiNum);
+  sprintf(logStr, "%s cluster candidates were found.", digit);
+  log_msg(logStr, LOG_INFO, pParam);
+}
+
+/* Return 1 if the word dependencies of '--wweight' option are counted in the
+ pass that finds the cluster candidates. With '--wdeppass' option, they are
+ counted in a pass of their own after the clusters are found, see
+ step_3_find_word_deps(). */
+static int is_word_dep_counted(struct Parameters *pParam)
+{
+  return pParam->wordWeightThreshold && !pParam->bWordDepPassFlag;
+}
+
+/* For the sake of computing speed, four brother functions (
+ create_cluster_candidates(), create_cluster_candidates_with_wfilter(),
+ create_cluster_candidates_word_dep(), and 
+ create_cluster_candidates_word_dep_with_filter()) which have similar 
+ function but with a few differences to each other are contained in this 
+ function in parallel. This design of course brings inconvenience for future
+ maintenance, and it will be fixed with better solution in following updates. */
+static wordnumber_t find_cluster_candidates_in_region(
+  struct InputChunk *pRegion, struct Parameters *pParam)
+{
+  if (is_word_dep_counted(pParam))
+  {
     if (!pParam->pWordFilter)
     {
-      pParam->clusterCandiNum =
-      create_cluster_candidates_word_dep(pParam);
+      return create_cluster_candidates_word_dep(pRegion, pParam);
     }
     else
     {
-      pParam->clusterCandiNum =
-      create_cluster_candidates_word_dep_with_filter(pParam);
+      return create_cluster_candidates_word_dep_with_filter(pRegion, pParam);
     }
   }
   else
   {
     if (!pParam->pWordFilter)
     {
-      pParam->clusterCandiNum = create_cluster_candidates(pParam);
+      return create_cluster_candidates(pRegion, pParam);
     }
     else
     {
-      pParam->clusterCandiNum =
-      create_cluster_candidates_with_wfilter(pParam);
+      return create_cluster_candidates_with_wfilter(pRegion, pParam);
     }
-    
   }
+}
+
+/* Find the cluster candidates with pParam->threadNum worker threads. Every
+ worker puts the candidates of its own region into a local cluster table, with
+ its own cluster instances, see function find_cluster_candidates_worker().
+ Afterwards, the local tables are merged into pParam->clusterTable. If a
+ candidate was found by several workers, their supports are summed up and their
+ wildcard ranges are united by merge_cluster_instance(). 
+ 
+ The workers are merged in the order of their regions, and the candidates of
+ a worker in the order in which it found them, so that pClusterFamily[] gets
+ the same order as without threads (e.g. for the tokens of '--wweight'
+ option).
+ 
+ The word table is only read by the workers. Like the cluster table, the word
+ dependency table of '--wweight' option is counted by every worker on its own,
+ and merged afterwards, see update_word_dep_table(). */
+static wordnumber_t find_cluster_candidates_in_parallel(
+  struct Parameters *pParam)
+{
+  struct WorkerContext *pWorkers;
+  struct Elem *pElem;
+  struct Parameters *pLocal;
+  struct Cluster *pCluster, *pFound, *pNext;
+  wordnumber_t clusterCount = 0;
+  int i, k;
+  
+  pWorkers = create_workers(pParam);
+  if (pParam->bTokenCacheReady)
+  {
+    split_token_cache(pWorkers, pParam);
+  }
+  run_workers(pWorkers, find_cluster_candidates_worker, pParam);
+  
+  for (i = 0; i < pParam->threadNum; i++)
+  {
+    pLocal = &pWorkers[i].param;
     
-  str_format_int_grouped(digit, pParam->clusterCandiNum);
-  sprintf(logStr, "%s cluster candidates were found.", digit);
-  log_msg(logStr, LOG_INFO, pParam);
+    for (k = 1; k <= pLocal->biggestConstants; k++)
+    {
+      /* A new candidate is put at the head of its list, so the list is
+       reversed to get the order in which the worker found them. */
+      pFound = 0;
+      for (pCluster = pLocal->pClusterFamily[k]; pCluster; pCluster = pNext)
+      {
+        pNext = pCluster->pNext;
+        pCluster->pNext = pFound;
+        pFound = pCluster;
+      }
+      pLocal->pClusterFamily[k] = 0;
+      
+      for (pCluster = pFound; pCluster; pCluster = pNext)
+      {
+        pNext = pCluster->pNext;
+        pElem = merge_cluster_elem(pCluster->pElem, &pParam->clusterTable, 
+                       pParam);
+        
+        if (pElem == pCluster->pElem)
+        {
+          clusterCount++;
+          
+          pCluster->pNext = pParam->pClusterFamily[k];
+          pParam->pClusterFamily[k] = pCluster;
+          
+          if (k > pParam->biggestConstants)
+          {
+            pParam->biggestConstants = k;
+          }
+        }
+        else
+        {
+          merge_cluster_instance(pElem->pCluster, pCluster);
+        }
+      }
+    }
+    
+    free_hash_table(&pLocal->clusterTable);
+    adopt_arena(&pParam->clusterArena, &pWorkers[i].param.clusterArena);
+    adopt_arena(&pParam->candidateArena, &pWorkers[i].param.candidateArena);
+    
+    if (is_word_dep_counted(pParam))
+    {
+      merge_word_dep_table(&pWorkers[i].param.wordDepTable, 
+                 &pParam->wordDepTable, pParam);
+      free_word_dep_table(&pWorkers[i].param.wordDepTable);
+    }
+  }
+  
+  destroy_workers(pWorkers, pParam);
+  
+  return clusterCount;
+}
+
+/* The function run by every worker thread of 
+ find_cluster_candidates_in_parallel(). The cluster instances of the worker
+ are kept in the pClusterFamily[] of its private parameters until they are
+ merged. */
+static void find_cluster_candidates_worker(struct WorkerContext *pWorker)
+{
+  struct Parameters *pParam;
+  int i;
+  
+  pParam = &pWorker->param;
+  
+  init_hash_table(&pParam->clusterTable, DEF_CLUSTER_TABLE_SIZE,
+          pParam->clusterTableSeed, pParam);
+  
+  if (is_word_dep_counted(pParam))
+  {
+    init_word_dep_table(&pParam->wordDepTable, DEF_WORD_DEP_TABLE_SIZE, 
+              pParam);
+  }
+  
+  for (i = 0; i <= MAXWORDS; i++)
+  {
+    pParam->pClusterFamily[i] = 0;
+  }
+  pParam->biggestConstants = 0;
+  
+  if (pParam->bTokenCacheReady)
+  {
+    pWorker->elemNum = create_cluster_candidates_from_cache(pWorker->cacheStart,
+                                pWorker->cacheEnd,
+                                pParam);
+  }
+  else
+  {
+    pWorker->elemNum = find_cluster_candidates_in_region(pWorker->pRegion, 
+                               pParam);
+  }
 }
 
 /* The debug result is sorted, according to support in a descending order. */
@@ -166,6 +328,7 @@ void debug_1_print_cluster_candidates(struct Parameters *pParam)
 {
   struct Elem **ppSortedArray;
   int i, j;
+  tableindex_t k;
   struct Elem *ptr;
   char logStr[MAXLOGMSGLEN];
   char digit[MAXDIGITBIT];
@@ -180,24 +343,18 @@ void debug_1_print_cluster_candidates(struct Parameters *pParam)
   
   j = 0;
   
-  for (i = 0; i < pParam->clusterTableSize; i++)
+  for (k = 0; k < pParam->clusterTable.size; k++)
   {
-    if (!pParam->ppClusterTable[i])
-    {
-      continue;
-    }
-    
-    ptr = pParam->ppClusterTable[i];
-    
-    while (ptr)
+    ptr = pParam->clusterTable.pSlots[k].pElem;
+    if (ptr)
     {
       ppSortedArray[j] = ptr;
       j++;
-      ptr = ptr->pNext;
     }
   }
   
-  sort_elements(ppSortedArray, pParam->clusterCandiNum, pParam);
+  sort_elements(ppSortedArray, pParam->clusterCandiNum, compare_clusters,
+          pParam);
   
   for (i = 0; i < pParam->clusterCandiNum; i++)
   {
@@ -215,84 +372,99 @@ void debug_1_print_cluster_candidates(struct Parameters *pParam)
  brother function create_cluster_candidate_sketch_with_wfilter(). 
  For the sake of computing performance, sorry for this inconvenience. It will
  be fixed with better solution in the following updates. */
-static tableindex_t create_cluster_candidate_sketch(struct Parameters *pParam)
+static void create_cluster_candidate_sketch(struct Parameters *pParam)
 {
-  FILE *pFile;
-  struct InputFile *pFilePtr;
-  tableindex_t j, hash, oversupport;
-  char logStr[MAXLOGMSGLEN];
-  char line[MAXLINELEN];
-  char words[MAXWORDS][MAXWORDLEN];
-  char key[MAXKEYLEN];
-  int len, wordcount, last, i;
+  struct InputChunk *pRegion;
+  struct RegionReader reader;
+char *line;
+  int linelen;
+  struct LineTokens tokens;
+  wordnumber_t key[MAXWORDS + 1];
+  int keyLen, wordLen, wordcount, last, i;
   struct Elem *pWord;
+  char *pWordStr;
   
-  for (j = 0; j < pParam->clusterSketchSize; j++)
-  {
-    pParam->pClusterSketch[j] = 0;
-  }
+pRegion = create_whole_input_region(pParam);
+  init_line_tokens(&tokens);
+  open_region(&reader, pRegion);
   
-  for (pFilePtr = pParam->pInputFiles; pFilePtr; pFilePtr = pFilePtr->pNext)
+  while (read_region_line(&reader, &line, &linelen, pParam))
   {
-    if (!(pFile = fopen(pFilePtr->pName, "r")))
-    {
-      sprintf(logStr, "Can't open input file %s", pFilePtr->pName);
-      log_msg(logStr, LOG_ERR, pParam);
-      continue;
-    }
+    wordcount = find_word_spans(line, linelen, &tokens, pParam);
+    
+    last = 0;
+    keyLen = 0;
     
-    while (fgets(line, MAXLINELEN, pFile))
+    for (i = 0; i < wordcount; i++)
     {
-      len = (int) strlen(line);
-      if (line[len - 1] == '\n')
-      {
-        line[len - 1] = 0;
-      }
-      
-      wordcount = find_words(line, words, pParam);
+      pWordStr = tokens.pText + tokens.words[i].offset;
+      wordLen = tokens.words[i].len;
       
-      last = 0;
-      *key = 0;
-      
-      for (i = 0; i < wordcount; i++)
-      {
-        pWord = find_elem(words[i], pParam->ppWordTable,
-                  pParam->wordTableSize, pParam->wordTableSeed);
-        if (words[i][0] != 0 && pWord)
-        {
-          strcat(key, words[i]);
-          len = (int) strlen(key);
-          key[len] = CLUSTERSEP;
-          key[len + 1] = 0;
-          //last records the location of the last constant. */
-          last = i + 1;
-        }
-      }
-      
-      if (!last)
+      pWord = find_elem_with_hash(pWordStr, wordLen, tokens.words[i].hash,
+                                  &pParam->wordTable);
+      if (wordLen != 0 && pWord)
       {
-        /* !last means there is no frequent word in this line. */
-        continue;
+        key[++keyLen] = pWord->number;
+        //last records the location of the last constant. */
+        last = i + 1;
       }
-      
-      hash = str2hash(key, pParam->clusterSketchSize,
-              pParam->clusterSketchSeed);
-      pParam->pClusterSketch[hash]++;
     }
     
-    fclose(pFile);
+    if (!last)
+    {
+      /* !last means there is no frequent word in this line. */
+      continue;
+    }
+    
+    key[0] = keyLen;
+    sketch_add(&pParam->clusterSketch,
+           clusterkey2hash(key, pParam->clusterTableSeed));
   }
   
-  oversupport = 0;
-  for (j = 0; j < pParam->clusterSketchSize; j++)
+  free_line_tokens(&tokens);
+  free_region(pRegion);
+}
+
+/* This function works like create_cluster_candidate_sketch() and
+ create_cluster_candidate_sketch_with_wfilter(), but reads the lines from the
+ token cache of '--tokencache' option. The frequent words of a line are known
+ from the cache, so the line is neither split into words, nor are the words
+ looked up in the word table. */
+static void create_cluster_candidate_sketch_from_cache(
+  struct Parameters *pParam)
+{
+  struct TokenCacheReader reader;
+  struct CachedLine cachedLine;
+wordnumber_t key[MAXWORDS + 1];
+  int keyLen, last, i;
+  struct Elem *pWord;
+  
+open_token_cache_reader(&reader, 0, pParam->cacheSize, pParam);
+  
+  while (read_token_cache_line(&reader, &cachedLine, pParam))
   {
-    if (pParam->pClusterSketch[j] >= pParam->support)
+    last = 0;
+    keyLen = 0;
+    
+    for (i = 0; i < cachedLine.wordcount; i++)
     {
-      oversupport++;
+      pWord = cachedLine.ppWords[i];
+      if (pWord)
+      {
+        key[++keyLen] = pWord->number;
+        last = i + 1;
+      }
     }
+    
+    if (!last)
+    {
+      continue;
+    }
+    
+    key[0] = keyLen;
+    sketch_add(&pParam->clusterSketch,
+           clusterkey2hash(key, pParam->clusterTableSeed));
   }
-  
-  return oversupport;
 }
 
 /* This is a redundant function, which works similarly as function
@@ -312,103 +484,72 @@ static tableindex_t create_cluster_candidate_sketch(struct Parameters *pParam)
  brother function create_cluster_candidate_sketch(). 
  For the sake of computing performance, sorry for this inconvenience. It will
  be fixed with better solution in the following updates. */
-static tableindex_t create_cluster_candidate_sketch_with_wfilter(
+static void create_cluster_candidate_sketch_with_wfilter(
   struct Parameters *pParam)
 {
-  FILE *pFile;
-  struct InputFile *pFilePtr;
-  tableindex_t j, hash, oversupport;
-  char logStr[MAXLOGMSGLEN];
-  char line[MAXLINELEN];
-  char words[MAXWORDS][MAXWORDLEN];
-  char key[MAXKEYLEN];
-  int len, wordcount, last, i;
+  struct InputChunk *pRegion;
+  struct RegionReader reader;
+char *line;
+  int linelen;
+  struct LineTokens tokens;
+  wordnumber_t key[MAXWORDS + 1];
+  int keyLen, wordLen, wordcount, last, i;
   struct Elem *pWord;
+  char *pWordStr;
   char newWord[MAXWORDLEN];
   
   *newWord = 0;
   
-  for (j = 0; j < pParam->clusterSketchSize; j++)
-  {
-    pParam->pClusterSketch[j] = 0;
-  }
+pRegion = create_whole_input_region(pParam);
+  init_line_tokens(&tokens);
+  open_region(&reader, pRegion);
   
-  for (pFilePtr = pParam->pInputFiles; pFilePtr; pFilePtr = pFilePtr->pNext)
+  while (read_region_line(&reader, &line, &linelen, pParam))
   {
-    if (!(pFile = fopen(pFilePtr->pName, "r")))
-    {
-      sprintf(logStr, "Can't open input file %s", pFilePtr->pName);
-      log_msg(logStr, LOG_ERR, pParam);
-      continue;
-    }
+    wordcount = find_word_spans(line, linelen, &tokens, pParam);
+    
+    last = 0;
+    keyLen = 0;
     
-    while (fgets(line, MAXLINELEN, pFile))
+    for (i = 0; i < wordcount; i++)
     {
-      len = (int) strlen(line);
-      if (line[len - 1] == '\n')
+      pWordStr = tokens.pText + tokens.words[i].offset;
+      wordLen = tokens.words[i].len;
+      
+      pWord = find_elem_with_hash(pWordStr, wordLen, tokens.words[i].hash,
+                                  &pParam->wordTable);
+      if (wordLen != 0 && pWord)
       {
-        line[len - 1] = 0;
+        key[++keyLen] = pWord->number;
+        /* last records the location of the last constant. */
+        last = i + 1;
       }
-      
-      wordcount = find_words(line, words, pParam);
-      
-      last = 0;
-      *key = 0;
-      
-      for (i = 0; i < wordcount; i++)
+      else if(is_word_filtered_with_len(pWordStr, wordLen, pParam))
       {
-        pWord = find_elem(words[i], pParam->ppWordTable,
-                  pParam->wordTableSize, pParam->wordTableSeed);
-        if (words[i][0] != 0 && pWord)
+        strcpy(newWord, word_search_replace_with_len(pWordStr, wordLen,
+                               pParam));
+        pWord = find_elem(newWord, &pParam->wordTable);
+        if (wordLen != 0 && pWord)
         {
-          strcat(key, words[i]);
-          len = (int) strlen(key);
-          key[len] = CLUSTERSEP;
-          key[len + 1] = 0;
-          /* last records the location of the last constant. */
+          key[++keyLen] = pWord->number;
           last = i + 1;
         }
-        else if(is_word_filtered(words[i], pParam))
-        {
-          strcpy(newWord, word_search_replace(words[i], pParam));
-          pWord = find_elem(newWord, pParam->ppWordTable,
-                    pParam->wordTableSize,
-                    pParam->wordTableSeed);
-          if (words[i][0] != 0 && pWord)
-          {
-            strcat(key, newWord);
-            len = (int) strlen(key);
-            key[len] = CLUSTERSEP;
-            key[len + 1] = 0;
-            last = i + 1;
-          }
-        }
-      }
-      
-      if (!last)
-      {
-        /* !last means there is no frequent word in this line. */
-        continue;
       }
-      
-      hash = str2hash(key, pParam->clusterSketchSize,
-              pParam->clusterSketchSeed);
-      pParam->pClusterSketch[hash]++;
     }
     
-    fclose(pFile);
-  }
-  
-  oversupport = 0;
-  for (j = 0; j < pParam->clusterSketchSize; j++)
-  {
-    if (pParam->pClusterSketch[j] >= pParam->support)
+    if (!last)
     {
-      oversupport++;
+      /* !last means there is no frequent word in this line. */
+      continue;
     }
+    
+    key[0] = keyLen;
+    sketch_add(&pParam->clusterSketch,
+           clusterkey2hash(key, pParam->clusterTableSeed));
   }
   
-  return oversupport;
+  free_line_tokens(&tokens);
+  free_region(pRegion);
 }
 
 /* When making changes to this function, don't forget to also change all four
@@ -418,147 +559,118 @@ static tableindex_t create_cluster_candidate_sketch_with_wfilter(
  create_cluster_candidates_word_dep_with_filter().
  For the sake of computing performance, sorry for this inconvenience. It will
  be fixed with better solution in the following updates. */
-static wordnumber_t create_cluster_candidates_word_dep(struct Parameters 
-  *pParam)
+static wordnumber_t create_cluster_candidates_word_dep(
+  struct InputChunk *pRegion, struct Parameters *pParam)
 {
-  FILE *pFile;
-  struct InputFile *pFilePtr;
-  tableindex_t j, hash;
-  char logStr[MAXLOGMSGLEN];
-  char line[MAXLINELEN];
-  char words[MAXWORDS][MAXWORDLEN];
-  char key[MAXKEYLEN];
+  struct RegionReader reader;
+  tableindex_t keyHash;
+  char *line;
+  int linelen;
+  struct LineTokens tokens;
+  wordnumber_t key[MAXWORDS + 1];
   int wildcard[MAXWORDS + 1];
-  int len, wordcount, i, constants, variables;
+  int keyLen, wordLen, wordcount, i, constants, variables;
   struct Elem *pWord, *pElem;
+  char *pWordStr;
   struct Elem *pStorage[MAXWORDS + 1];
-  wordnumber_t clusterCount;
+  wordnumber_t clusterCount = 0;
   
   //wordDep
   //wordnumber_t wordNumberStorage[MAXWORDS + 1];
-  wordnumber_t p, q;
   int distinctConstants;
   
   
-  for (j = 0; j < pParam->clusterTableSize; j++)
-  {
-    pParam->ppClusterTable[j] = 0;
-  }
+  init_line_tokens(&tokens);
+  open_region(&reader, pRegion);
   
-  for (p = 0; p < pParam->wordDepMatrixBreadth; p++)
+  while (read_region_line(&reader, &line, &linelen, pParam))
   {
-    for (q = 0; q < pParam->wordDepMatrixBreadth; q++)
-    {
-      pParam->wordDepMatrix[p * pParam->wordDepMatrixBreadth + q] = 0;
-    }
-  }
-  
-  
-  for (pFilePtr = pParam->pInputFiles; pFilePtr; pFilePtr = pFilePtr->pNext)
-  {
-    if (!(pFile = fopen(pFilePtr->pName, "r")))
-    {
-      sprintf(logStr, "Can't open input file %s", pFilePtr->pName);
-      log_msg(logStr, LOG_ERR, pParam);
-      continue;
-    }
+    wordcount = find_word_spans(line, linelen, &tokens, pParam);
+    
+    keyLen = 0;
+    constants = 0;
+    variables = 0;
+    
+    //wordDep
+    distinctConstants = 0;
     
-    while (fgets(line, MAXLINELEN, pFile))
+    
+    for (i = 0; i < wordcount; i++)
     {
-      len = (int) strlen(line);
-      if (line[len - 1] == '\n')
-      {
-        line[len - 1] = 0;
-      }
-      
-      wordcount = find_words(line, words, pParam);
-      
-      *key = 0;
-      constants = 0;
-      variables = 0;
-      
-      //wordDep
-      distinctConstants = 0;
+      pWordStr = tokens.pText + tokens.words[i].offset;
+      wordLen = tokens.words[i].len;
       
-      
-      for (i = 0; i < wordcount; i++)
+      pWord = find_elem_with_hash(pWordStr, wordLen, tokens.words[i].hash,
+                                  &pParam->wordTable);
+      if (wordLen != 0 && pWord)
       {
-        pWord = find_elem(words[i], pParam->ppWordTable,
-                  pParam->wordTableSize, pParam->wordTableSeed);
-        if (words[i][0] != 0 && pWord)
+        key[++keyLen] = pWord->number;
+        
+        constants++;
+        pStorage[constants] = pWord;
+        wildcard[constants] = variables;
+        variables = 0;
+        
+        //wordDep
+        distinctConstants++;
+        //findRepeated..
+        if (is_word_repeated(pParam->wordNumStr, pWord->number,
+                   distinctConstants))
         {
-          strcat(key, words[i]);
-          len = (int) strlen(key);
-          key[len] = CLUSTERSEP;
-          key[len + 1] = 0;
-          
-          constants++;
-          pStorage[constants] = pWord;
-          wildcard[constants] = variables;
-          variables = 0;
-          
-          //wordDep
-          distinctConstants++;
-          //findRepeated..
-          if (is_word_repeated(pParam->wordNumStr, pWord->number,
-                     distinctConstants))
-          {
-            distinctConstants--;
-          }
-          else
-          {
-            pParam->wordNumStr[distinctConstants] = pWord->number;
-          }
+          distinctConstants--;
         }
         else
         {
-          variables++;
+          pParam->wordNumStr[distinctConstants] = pWord->number;
         }
       }
-      
-      //Deal with tail.
-      //wildcard[constants - 1 + 1] = variables;
-      wildcard[0] = variables;
-      
-      if (!constants)
+      else
       {
-        continue;
+        variables++;
       }
-      
-      //wordDep
-      //update wordDep matrix
-      update_word_dep_matrix(pParam->wordNumStr, distinctConstants,
-                   pParam);
-      
-      if (pParam->clusterSketchSize)
-      {
-        hash = str2hash(key, pParam->clusterSketchSize,
-                pParam->clusterSketchSeed);
-        if (pParam->pClusterSketch[hash] < pParam->support)
-        {
-          continue;
-        }
-      }
-      
-      //Put this cluster into clustertable.
-      pElem = add_elem(key, pParam->ppClusterTable,
-               pParam->clusterTableSize, pParam->clusterTableSeed,
-               pParam);
-      
-      if (pElem->count == 1)
+    }
+    
+    //Deal with tail.
+    //wildcard[constants - 1 + 1] = variables;
+    wildcard[0] = variables;
+    key[0] = keyLen;
+    
+    if (!constants)
+    {
+      continue;
+    }
+    
+    //wordDep
+    //update wordDep table
+    update_word_dep_table(pParam->wordNumStr, distinctConstants,
+                 pParam);
+    
+    keyHash = clusterkey2hash(key, pParam->clusterTable.seed);
+    
+    if (pParam->clusterSketchSize)
+    {
+      if (sketch_estimate(&pParam->clusterSketch, keyHash) < pParam->support)
       {
-        clusterCount++;
-        create_cluster_instance(pElem, constants, wildcard, pStorage,
-                    pParam);
+        continue;
       }
-      
-      adjust_cluster_instance(pElem, constants, wildcard, pParam);
-      
     }
     
-    fclose(pFile);
+    //Put this cluster into clustertable.
+    pElem = add_cluster_elem(key, keyHash, &pParam->clusterTable, pParam);
+    
+    if (pElem->count == 1)
+    {
+      clusterCount++;
+      create_cluster_instance(pElem, constants, wildcard, pStorage,
+                  pParam);
+    }
+    
+    adjust_cluster_instance(pElem, constants, wildcard, pParam);
+    
   }
   
+  free_line_tokens(&tokens);
+  
   return clusterCount;
 }
 
@@ -583,79 +695,80 @@ static wordnumber_t create_cluster_candidates_word_dep(struct Parameters
  For the sake of computing performance, sorry for this inconvenience. It will
  be fixed with better solution in the following updates. */
 static wordnumber_t create_cluster_candidates_word_dep_with_filter(
-  struct Parameters *pParam)
+  struct InputChunk *pRegion, struct Parameters *pParam)
 {
-  FILE *pFile;
-  struct InputFile *pFilePtr;
-  tableindex_t j, hash;
-  char logStr[MAXLOGMSGLEN];
-  char line[MAXLINELEN];
-  char words[MAXWORDS][MAXWORDLEN];
-  char key[MAXKEYLEN];
+  struct RegionReader reader;
+  tableindex_t keyHash;
+  char *line;
+  int linelen;
+  struct LineTokens tokens;
+  wordnumber_t key[MAXWORDS + 1];
   int wildcard[MAXWORDS + 1];
-  int len, wordcount, i, constants, variables;
+  int keyLen, wordLen, wordcount, i, constants, variables;
   struct Elem *pWord, *pElem;
+  char *pWordStr;
   struct Elem *pStorage[MAXWORDS + 1];
-  wordnumber_t clusterCount;
+  wordnumber_t clusterCount = 0;
   char newWord[MAXWORDLEN];
   
   //wordDep
   //wordnumber_t wordNumberStorage[MAXWORDS + 1];
-  wordnumber_t p, q;
   int distinctConstants;
   
   *newWord = 0;
-  for (j = 0; j < pParam->clusterTableSize; j++)
-  {
-    pParam->ppClusterTable[j] = 0;
-  }
-  
-  for (p = 0; p < pParam->wordDepMatrixBreadth; p++)
-  {
-    for (q = 0; q < pParam->wordDepMatrixBreadth; q++)
-    {
-      pParam->wordDepMatrix[p * pParam->wordDepMatrixBreadth + q] = 0;
-    }
-  }
-  
+  init_line_tokens(&tokens);
+  open_region(&reader, pRegion);
   
-  for (pFilePtr = pParam->pInputFiles; pFilePtr; pFilePtr = pFilePtr->pNext)
+  while (read_region_line(&reader, &line, &linelen, pParam))
   {
-    if (!(pFile = fopen(pFilePtr->pName, "r")))
-    {
-      sprintf(logStr, "Can't open inputfile %s", pFilePtr->pName);
-      log_msg(logStr, LOG_ERR, pParam);
-      continue;
-    }
+    wordcount = find_word_spans(line, linelen, &tokens, pParam);
+    
+    keyLen = 0;
+    constants = 0;
+    variables = 0;
     
-    while (fgets(line, MAXLINELEN, pFile))
+    //wordDep
+    distinctConstants = 0;
+    
+    
+    for (i = 0; i < wordcount; i++)
     {
-      len = (int) strlen(line);
-      if (line[len - 1] == '\n')
+      pWordStr = tokens.pText + tokens.words[i].offset;
+      wordLen = tokens.words[i].len;
+      
+      pWord = find_elem_with_hash(pWordStr, wordLen, tokens.words[i].hash,
+                                  &pParam->wordTable);
+      if (wordLen != 0 && pWord)
       {
-        line[len - 1] = 0;
+        key[++keyLen] = pWord->number;
+        
+        constants++;
+        pStorage[constants] = pWord;
+        wildcard[constants] = variables;
+        variables = 0;
+        
+        //wordDep
+        distinctConstants++;
+        //findRepeated..
+        if (is_word_repeated(pParam->wordNumStr, pWord->number,
+                   distinctConstants))
+        {
+          distinctConstants--;
+        }
+        else
+        {
+          pParam->wordNumStr[distinctConstants] = pWord->number;
+        }
+        
       }
-      
-      wordcount = find_words(line, words, pParam);
-      
-      *key = 0;
-      constants = 0;
-      variables = 0;
-      
-      //wordDep
-      distinctConstants = 0;
-      
-      
-      for (i = 0; i < wordcount; i++)
+      else if (is_word_filtered_with_len(pWordStr, wordLen, pParam))
       {
-        pWord = find_elem(words[i], pParam->ppWordTable,
-                  pParam->wordTableSize, pParam->wordTableSeed);
-        if (words[i][0] != 0 && pWord)
+        strcpy(newWord, word_search_replace_with_len(pWordStr, wordLen,
+                               pParam));
+        pWord = find_elem(newWord, &pParam->wordTable);
+        if (wordLen != 0 && pWord)
         {
-          strcat(key, words[i]);
-          len = (int) strlen(key);
-          key[len] = CLUSTERSEP;
-          key[len + 1] = 0;
+          key[++keyLen] = pWord->number;
           
           constants++;
           pStorage[constants] = pWord;
@@ -665,53 +778,16 @@ static wordnumber_t create_cluster_candidates_word_dep_with_filter(
           //wordDep
           distinctConstants++;
           //findRepeated..
-          if (is_word_repeated(pParam->wordNumStr, pWord->number,
+          if (is_word_repeated(pParam->wordNumStr,
+                     pWord->number,
                      distinctConstants))
           {
             distinctConstants--;
           }
           else
           {
-            pParam->wordNumStr[distinctConstants] = pWord->number;
-          }
-          
-        }
-        else if (is_word_filtered(words[i], pParam))
-        {
-          strcpy(newWord, word_search_replace(words[i], pParam));
-          pWord = find_elem(newWord, pParam->ppWordTable,
-                    pParam->wordTableSize,
-                    pParam->wordTableSeed);
-          if (words[i][0] != 0 && pWord)
-          {
-            strcat(key, newWord);
-            len = (int) strlen(key);
-            key[len] = CLUSTERSEP;
-            key[len + 1] = 0;
-            
-            constants++;
-            pStorage[constants] = pWord;
-            wildcard[constants] = variables;
-            variables = 0;
-            
-            //wordDep
-            distinctConstants++;
-            //findRepeated..
-            if (is_word_repeated(pParam->wordNumStr,
-                       pWord->number,
-                       distinctConstants))
-            {
-              distinctConstants--;
-            }
-            else
-            {
-              pParam->wordNumStr[distinctConstants] =
-              pWord->number;
-            }
-          }
-          else
-          {
-            variables++;
+            pParam->wordNumStr[distinctConstants] =
+            pWord->number;
           }
         }
         else
@@ -719,50 +795,53 @@ static wordnumber_t create_cluster_candidates_word_dep_with_filter(
           variables++;
         }
       }
-      
-      //Deal with tail.
-      //wildcard[constants - 1 + 1] = variables;
-      wildcard[0] = variables;
-      
-      if (!constants)
-      {
-        continue;
-      }
-      
-      //wordDep
-      //update wordDep matrix
-      update_word_dep_matrix(pParam->wordNumStr, distinctConstants,
-                   pParam);
-      
-      if (pParam->clusterSketchSize)
+      else
       {
-        hash = str2hash(key, pParam->clusterSketchSize, 
-                pParam->clusterSketchSeed);
-        if (pParam->pClusterSketch[hash] < pParam->support)
-        {
-          continue;
-        }
+        variables++;
       }
-      
-      //Put this cluster into clustertable.
-      pElem = add_elem(key, pParam->ppClusterTable,
-               pParam->clusterTableSize, pParam->clusterTableSeed,
-               pParam);
-      
-      if (pElem->count == 1)
+    }
+    
+    //Deal with tail.
+    //wildcard[constants - 1 + 1] = variables;
+    wildcard[0] = variables;
+    key[0] = keyLen;
+    
+    if (!constants)
+    {
+      continue;
+    }
+    
+    //wordDep
+    //update wordDep table
+    update_word_dep_table(pParam->wordNumStr, distinctConstants,
+                 pParam);
+    
+    keyHash = clusterkey2hash(key, pParam->clusterTable.seed);
+    
+    if (pParam->clusterSketchSize)
+    {
+      if (sketch_estimate(&pParam->clusterSketch, keyHash) < pParam->support)
       {
-        clusterCount++;
-        create_cluster_instance(pElem, constants, wildcard, pStorage,
-                    pParam);
+        continue;
       }
-      
-      adjust_cluster_instance(pElem, constants, wildcard, pParam);
-      
     }
     
-    fclose(pFile);
+    //Put this cluster into clustertable.
+    pElem = add_cluster_elem(key, keyHash, &pParam->clusterTable, pParam);
+    
+    if (pElem->count == 1)
+    {
+      clusterCount++;
+      create_cluster_instance(pElem, constants, wildcard, pStorage,
+                  pParam);
+    }
+    
+    adjust_cluster_instance(pElem, constants, wildcard, pParam);
+    
   }
   
+  free_line_tokens(&tokens);
+  
   return clusterCount;
 }
 
@@ -773,109 +852,91 @@ static wordnumber_t create_cluster_candidates_word_dep_with_filter(
  create_cluster_candidates_word_dep_with_filter().
  For the sake of computing performance, sorry for this inconvenience. It will
  be fixed with better solution in the following updates. */
-static wordnumber_t create_cluster_candidates(struct Parameters *pParam)
+static wordnumber_t create_cluster_candidates(
+  struct InputChunk *pRegion, struct Parameters *pParam)
 {
-  FILE *pFile;
-  struct InputFile *pFilePtr;
-  tableindex_t j, hash;
-  char logStr[MAXLOGMSGLEN];
-  char line[MAXLINELEN];
-  char words[MAXWORDS][MAXWORDLEN];
-  char key[MAXKEYLEN];
+  struct RegionReader reader;
+  tableindex_t keyHash;
+  char *line;
+  int linelen;
+  struct LineTokens tokens;
+  wordnumber_t key[MAXWORDS + 1];
   int wildcard[MAXWORDS + 1];
-  int len, wordcount, i, constants, variables;
+  int keyLen, wordLen, wordcount, i, constants, variables;
   struct Elem *pWord, *pElem;
+  char *pWordStr;
   struct Elem *pStorage[MAXWORDS + 1];
-  wordnumber_t clusterCount;
+  wordnumber_t clusterCount = 0;
   
-  for (j = 0; j < pParam->clusterTableSize; j++)
-  {
-    pParam->ppClusterTable[j] = 0;
-  }
+  init_line_tokens(&tokens);
+  open_region(&reader, pRegion);
   
-  for (pFilePtr = pParam->pInputFiles; pFilePtr; pFilePtr = pFilePtr->pNext)
+  while (read_region_line(&reader, &line, &linelen, pParam))
   {
-    if (!(pFile = fopen(pFilePtr->pName, "r")))
-    {
-      sprintf(logStr, "Can't open input file %s", pFilePtr->pName);
-      log_msg(logStr, LOG_ERR, pParam);
-      continue;
-    }
+    wordcount = find_word_spans(line, linelen, &tokens, pParam);
+    
+    keyLen = 0;
+    constants = 0;
+    variables = 0;
     
-    while (fgets(line, MAXLINELEN, pFile))
+    for (i = 0; i < wordcount; i++)
     {
-      len = (int) strlen(line);
-      if (line[len - 1] == '\n')
-      {
-        line[len - 1] = 0;
-      }
+      pWordStr = tokens.pText + tokens.words[i].offset;
+      wordLen = tokens.words[i].len;
       
-      wordcount = find_words(line, words, pParam);
-      
-      *key = 0;
-      constants = 0;
-      variables = 0;
-      
-      for (i = 0; i < wordcount; i++)
+      pWord = find_elem_with_hash(pWordStr, wordLen, tokens.words[i].hash,
+                                  &pParam->wordTable);
+      if (wordLen != 0 && pWord)
       {
-        pWord = find_elem(words[i], pParam->ppWordTable,
-                  pParam->wordTableSize, pParam->wordTableSeed);
-        if (words[i][0] != 0 && pWord)
-        {
-          strcat(key, words[i]);
-          len = (int) strlen(key);
-          key[len] = CLUSTERSEP;
-          key[len + 1] = 0;
-          
-          constants++;
-          pStorage[constants] = pWord;
-          wildcard[constants] = variables;
-          variables = 0;
-        }
-        else
-        {
-          variables++;
-        }
+        key[++keyLen] = pWord->number;
+        
+        constants++;
+        pStorage[constants] = pWord;
+        wildcard[constants] = variables;
+        variables = 0;
       }
-      
-      //Deal with tail.
-      //wildcard[constants - 1 + 1] = variables;
-      wildcard[0] = variables;
-      
-      if (!constants)
+      else
       {
-        continue;
+        variables++;
       }
-      
-      if (pParam->clusterSketchSize)
-      {
-        hash = str2hash(key, pParam->clusterSketchSize,
-                pParam->clusterSketchSeed);
-        if (pParam->pClusterSketch[hash] < pParam->support)
-        {
-          continue;
-        }
-      }
-      
-      //Put this cluster into clustertable.
-      pElem = add_elem(key, pParam->ppClusterTable,
-               pParam->clusterTableSize, pParam->clusterTableSeed,
-               pParam);
-      
-      if (pElem->count == 1)
+    }
+    
+    //Deal with tail.
+    //wildcard[constants - 1 + 1] = variables;
+    wildcard[0] = variables;
+    key[0] = keyLen;
+    
+    if (!constants)
+    {
+      continue;
+    }
+    
+    keyHash = clusterkey2hash(key, pParam->clusterTable.seed);
+    
+    if (pParam->clusterSketchSize)
+    {
+      if (sketch_estimate(&pParam->clusterSketch, keyHash) < pParam->support)
       {
-        clusterCount++;
-        create_cluster_instance(pElem, constants, wildcard, pStorage,
-                    pParam);
+        continue;
       }
-      
-      adjust_cluster_instance(pElem, constants, wildcard, pParam);
-      
     }
     
-    fclose(pFile);
+    //Put this cluster into clustertable.
+    pElem = add_cluster_elem(key, keyHash, &pParam->clusterTable, pParam);
+    
+    if (pElem->count == 1)
+    {
+      clusterCount++;
+      create_cluster_instance(pElem, constants, wildcard, pStorage,
+                  pParam);
+    }
+    
+    adjust_cluster_instance(pElem, constants, wildcard, pParam);
+    
   }
   
+  free_line_tokens(&tokens);
+  
   return clusterCount;
 }
 
@@ -899,134 +960,211 @@ static wordnumber_t create_cluster_candidates(struct Parameters *pParam)
  create_cluster_candidates_word_dep_with_filter().
  For the sake of computing performance, sorry for this inconvenience. It will
  be fixed with better solution in the following updates. */
-static wordnumber_t create_cluster_candidates_with_wfilter(struct Parameters 
-  *pParam)
+static wordnumber_t create_cluster_candidates_with_wfilter(
+  struct InputChunk *pRegion, struct Parameters *pParam)
 {
-  FILE *pFile;
-  struct InputFile *pFilePtr;
-  tableindex_t j, hash;
-  char logStr[MAXLOGMSGLEN];
-  char line[MAXLINELEN];
-  char words[MAXWORDS][MAXWORDLEN];
-  char key[MAXKEYLEN];
+  struct RegionReader reader;
+  tableindex_t keyHash;
+  char *line;
+  int linelen;
+  struct LineTokens tokens;
+  wordnumber_t key[MAXWORDS + 1];
   int wildcard[MAXWORDS + 1];
-  int len, wordcount, i, constants, variables;
+  int keyLen, wordLen, wordcount, i, constants, variables;
   struct Elem *pWord, *pElem;
+  char *pWordStr;
   struct Elem *pStorage[MAXWORDS + 1];
-  wordnumber_t clusterCount;
+  wordnumber_t clusterCount = 0;
   char newWord[MAXWORDLEN];
   
   *newWord = 0;
   
-  for (j = 0; j < pParam->clusterTableSize; j++)
-  {
-    pParam->ppClusterTable[j] = 0;
-  }
+  init_line_tokens(&tokens);
+  open_region(&reader, pRegion);
   
-  for (pFilePtr = pParam->pInputFiles; pFilePtr; pFilePtr = pFilePtr->pNext)
+  while (read_region_line(&reader, &line, &linelen, pParam))
   {
-    if (!(pFile = fopen(pFilePtr->pName, "r")))
-    {
-      sprintf(logStr, "Can't open input file %s", pFilePtr->pName);
-      log_msg(logStr, LOG_ERR, pParam);
-      continue;
-    }
+    wordcount = find_word_spans(line, linelen, &tokens, pParam);
     
-    while (fgets(line, MAXLINELEN, pFile))
+    keyLen = 0;
+    constants = 0;
+    variables = 0;
+    
+    for (i = 0; i < wordcount; i++)
     {
-      len = (int) strlen(line);
-      if (line[len - 1] == '\n')
+      pWordStr = tokens.pText + tokens.words[i].offset;
+      wordLen = tokens.words[i].len;
+      
+      pWord = find_elem_with_hash(pWordStr, wordLen, tokens.words[i].hash,
+                                  &pParam->wordTable);
+      if (wordLen != 0 && pWord)
       {
-        line[len - 1] = 0;
+        key[++keyLen] = pWord->number;
+        
+        constants++;
+        pStorage[constants] = pWord;
+        wildcard[constants] = variables;
+        variables = 0;
       }
-      
-      wordcount = find_words(line, words, pParam);
-      
-      *key = 0;
-      constants = 0;
-      variables = 0;
-      
-      for (i = 0; i < wordcount; i++)
+      else if(is_word_filtered_with_len(pWordStr, wordLen, pParam))
       {
-        pWord = find_elem(words[i], pParam->ppWordTable,
-                  pParam->wordTableSize, pParam->wordTableSeed);
-        if (words[i][0] != 0 && pWord)
+        strcpy(newWord, word_search_replace_with_len(pWordStr, wordLen,
+                               pParam));
+        pWord = find_elem(newWord, &pParam->wordTable);
+        if (wordLen != 0 && pWord)
         {
-          strcat(key, words[i]);
-          len = (int) strlen(key);
-          key[len] = CLUSTERSEP;
-          key[len + 1] = 0;
+          key[++keyLen] = pWord->number;
           
           constants++;
           pStorage[constants] = pWord;
           wildcard[constants] = variables;
           variables = 0;
         }
-        else if(is_word_filtered(words[i], pParam))
-        {
-          strcpy(newWord, word_search_replace(words[i], pParam));
-          pWord = find_elem(newWord, pParam->ppWordTable,
-                    pParam->wordTableSize,
-                    pParam->wordTableSeed);
-          if (words[i][0] != 0 && pWord)
-          {
-            strcat(key, newWord);
-            len = (int) strlen(key);
-            key[len] = CLUSTERSEP;
-            key[len + 1] = 0;
-            
-            constants++;
-            pStorage[constants] = pWord;
-            wildcard[constants] = variables;
-            variables = 0;
-          }
-          else
-          {
-            variables++;
-          }
-        }
         else
         {
           variables++;
         }
       }
-      
-      //Deal with tail.
-      //wildcard[constants - 1 + 1] = variables;
-      wildcard[0] = variables;
-      
-      if (!constants)
+      else
+      {
+        variables++;
+      }
+    }
+    
+    //Deal with tail.
+    //wildcard[constants - 1 + 1] = variables;
+    wildcard[0] = variables;
+    key[0] = keyLen;
+    
+    if (!constants)
+    {
+      continue;
+    }
+    
+    keyHash = clusterkey2hash(key, pParam->clusterTable.seed);
+    
+    if (pParam->clusterSketchSize)
+    {
+      if (sketch_estimate(&pParam->clusterSketch, keyHash) < pParam->support)
       {
         continue;
       }
+    }
+    
+    //Put this cluster into clustertable.
+    pElem = add_cluster_elem(key, keyHash, &pParam->clusterTable, pParam);
+    
+    if (pElem->count == 1)
+    {
+      clusterCount++;
+      create_cluster_instance(pElem, constants, wildcard, pStorage,
+                  pParam);
+    }
+    
+    adjust_cluster_instance(pElem, constants, wildcard, pParam);
+    
+  }
+  
+  free_line_tokens(&tokens);
+  
+  return clusterCount;
+}
+
+/* This function works like the four brother functions
+ create_cluster_candidates(), create_cluster_candidates_with_wfilter(),
+ create_cluster_candidates_word_dep() and
+ create_cluster_candidates_word_dep_with_filter(), but reads the records
+ [start, end) of the token cache of '--tokencache' option instead of the lines
+ of a region. With '--wfilter' option, the cache already tells which word
+ (original or replaced) is the frequent one. */
+static wordnumber_t create_cluster_candidates_from_cache(long start, long end,
+  struct Parameters *pParam)
+{
+  struct TokenCacheReader reader;
+  struct CachedLine cachedLine;
+  tableindex_t keyHash;
+  wordnumber_t key[MAXWORDS + 1];
+  int wildcard[MAXWORDS + 1];
+  int keyLen, i, constants, variables;
+  struct Elem *pWord, *pElem;
+  struct Elem *pStorage[MAXWORDS + 1];
+  wordnumber_t clusterCount = 0;
+  int distinctConstants;
+  
+  open_token_cache_reader(&reader, start, end, pParam);
+  
+  while (read_token_cache_line(&reader, &cachedLine, pParam))
+  {
+    keyLen = 0;
+    constants = 0;
+    variables = 0;
+    distinctConstants = 0;
+    
+    for (i = 0; i < cachedLine.wordcount; i++)
+    {
+      pWord = cachedLine.ppWords[i];
+      if (!pWord)
+      {
+        variables++;
+        continue;
+      }
       
-      if (pParam->clusterSketchSize)
+      key[++keyLen] = pWord->number;
+      
+      constants++;
+      pStorage[constants] = pWord;
+      wildcard[constants] = variables;
+      variables = 0;
+      
+      if (is_word_dep_counted(pParam))
       {
-        hash = str2hash(key, pParam->clusterSketchSize,
-                pParam->clusterSketchSeed);
-        if (pParam->pClusterSketch[hash] < pParam->support)
+        distinctConstants++;
+        if (is_word_repeated(pParam->wordNumStr, pWord->number,
+                   distinctConstants))
         {
-          continue;
+          distinctConstants--;
+        }
+        else
+        {
+          pParam->wordNumStr[distinctConstants] = pWord->number;
         }
       }
-      
-      //Put this cluster into clustertable.
-      pElem = add_elem(key, pParam->ppClusterTable,
-               pParam->clusterTableSize, pParam->clusterTableSeed,
-               pParam);
-      
-      if (pElem->count == 1)
+    }
+    
+    wildcard[0] = variables;
+    key[0] = keyLen;
+    
+    if (!constants)
+    {
+      continue;
+    }
+    
+    if (is_word_dep_counted(pParam))
+    {
+      update_word_dep_table(pParam->wordNumStr, distinctConstants,
+                   pParam);
+    }
+    
+    keyHash = clusterkey2hash(key, pParam->clusterTable.seed);
+    
+    if (pParam->clusterSketchSize)
+    {
+      if (sketch_estimate(&pParam->clusterSketch, keyHash) < pParam->support)
       {
-        clusterCount++;
-        create_cluster_instance(pElem, constants, wildcard, pStorage,
-                    pParam);
+        continue;
       }
-      
-      adjust_cluster_instance(pElem, constants, wildcard, pParam);
-      
     }
     
-    fclose(pFile);
+    pElem = add_cluster_elem(key, keyHash, &pParam->clusterTable, pParam);
+    
+    if (pElem->count == 1)
+    {
+      clusterCount++;
+      create_cluster_instance(pElem, constants, wildcard, pStorage,
+                  pParam);
+    }
+    
+    adjust_cluster_instance(pElem, constants, wildcard, pParam);
   }
   
   return clusterCount;
@@ -1040,29 +1178,13 @@ static struct Cluster *create_cluster_instance(struct Elem* pClusterElem,
   struct Cluster *ptr;
   int i = 0;
   
-  ptr = (struct Cluster *) malloc(sizeof(struct Cluster));
-  
-  if (!ptr)
-  {
-    log_msg(MALLOC_ERR_6009, LOG_ERR, pParam);
-    exit(1);
-  }
-  
-  ptr->ppWord = (struct Elem **) malloc((constants + 1) *
-                      sizeof(struct Elem *));
-  if (!ptr->ppWord)
-  {
-    log_msg(MALLOC_ERR_6009, LOG_ERR, pParam);
-    exit(1);
-  }
-  
-  ptr->fullWildcard = (int *) malloc(2 * (constants + 1) * sizeof(int));
-
-  if (!ptr->fullWildcard)
-  {
-    log_msg(MALLOC_ERR_6009, LOG_ERR, pParam);
-    exit(1);
-  }
+  ptr = (struct Cluster *) arena_alloc(&pParam->clusterArena,
+                     sizeof(struct Cluster), pParam);
+  ptr->ppWord = (struct Elem **) arena_alloc(&pParam->candidateArena,
+                        (constants + 1) * sizeof(struct Elem *),
+                        pParam);
+  ptr->fullWildcard = (int *) arena_alloc(&pParam->candidateArena,
+                      2 * (constants + 1) * sizeof(int), pParam);
   
   //Initializtion..
   ptr->ppWord[0] = 0; //reserved..
@@ -1079,7 +1201,7 @@ static struct Cluster *create_cluster_instance(struct Elem* pClusterElem,
   ptr->constants = constants;
   ptr->count = 0;
   ptr->bIsJoined = 0;
-  ptr->pLastNode = 0;
+  ptr->lastNode = 0;
   
   //Build bidirectional link.
   pClusterElem->pCluster = ptr;
@@ -1129,4 +1251,27 @@ static void adjust_cluster_instance(struct Elem* pClusterElem, int constants,
     
   }
   
-}
\ No newline at end of file
+}
+
+/* Merge the cluster instance pSrc of the same candidate into pDst. The
+ supports are summed up, and the minimum and maximum of every wildcard are
+ taken from both of them. */
+static void merge_cluster_instance(struct Cluster *pDst, struct Cluster *pSrc)
+{
+  int i;
+  
+  pDst->count += pSrc->count;
+  
+  for (i = 0; i <= pDst->constants; i++)
+  {
+    if (pSrc->fullWildcard[i * 2] < pDst->fullWildcard[i * 2])
+    {
+      pDst->fullWildcard[i * 2] = pSrc->fullWildcard[i * 2];
+    }
+    
+    if (pSrc->fullWildcard[i * 2 + 1] > pDst->fullWildcard[i * 2 + 1])
+    {
+      pDst->fullWildcard[i * 2 + 1] = pSrc->fullWildcard[i * 2 + 1];
+    }
+  }
+}
@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2016 Zhuge Chen, Risto Vaarandi and Mauno Pihelgas
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/* 
+ * File:   cluster_index.c
+ * 
+ * Content: Functions related to the inverted index of the cluster candidates.
+ * 
+ * Every row of the column store (see candidate_store.c) gets an ID, the rows
+ * of pCandidateGroups[1] first, then those of pCandidateGroups[2], etc. For
+ * every frequent word, the index lists the IDs of the candidates that have the
+ * word as a constant, in ascending order. The candidates that have all the
+ * constants of a candidate are then found by intersecting the lists of its
+ * words. The IDs are those of the column store after Step2.B, so the index is
+ * only valid until Step3.A removes the rows under the support threshold.
+ *
+ * Created on October 17, 2026, 6:10 AM
+ */
+
+#include "common_header.h"
+#include "cluster_index.h"
+
+#include "output.h"
+#include "utility.h"
+
+static wordnumber_t gallop(wordnumber_t *pList, wordnumber_t lo,
+        wordnumber_t hi, wordnumber_t target);
+
+/* Build pParam->clusterIndex from the column store. The lists of all the
+ words are one array, pPostings[], and the list of the word with number n is
+ pPostings[pOffsets[n] ... pOffsets[n + 1] - 1]. A word that occurs several
+ times in a candidate lists the candidate once. */
+void build_cluster_index(struct Parameters *pParam)
+{
+  struct ClusterIndex *pIndex;
+  struct CandidateGroup *pGroup;
+  struct Elem **ppWords;
+  wordnumber_t *pLast;
+  wordnumber_t id, number, j;
+  char logStr[MAXLOGMSGLEN];
+  char digit[MAXDIGITBIT];
+  int i, k;
+  
+  pIndex = &pParam->clusterIndex;
+  
+  pIndex->pOffsets = (wordnumber_t *) calloc(pParam->freWordNum + 2,
+                         sizeof(wordnumber_t));
+  
+  /* pLast[n] is the last ID that was counted for the word with number n,
+   plus 1. */
+  pLast = (wordnumber_t *) calloc(pParam->freWordNum + 1,
+                  sizeof(wordnumber_t));
+  if (!pIndex->pOffsets || !pLast)
+  {
+    log_msg(MALLOC_ERR_6040, LOG_ERR, pParam);
+    exit(1);
+  }
+  
+  /* Count the IDs of every word into pOffsets[n + 1]. */
+  id = 0;
+  pIndex->firstId[0] = 0;
+  for (i = 1; i <= pParam->biggestConstants; i++)
+  {
+    pGroup = &pParam->pCandidateGroups[i];
+    pIndex->firstId[i] = id;
+    
+    for (j = 0; j < pGroup->num; j++, id++)
+    {
+      ppWords = CANDIDATE_WORDS(pGroup, j);
+      for (k = 1; k <= i; k++)
+      {
+        number = ppWords[k]->number;
+        if (pLast[number] != id + 1)
+        {
+          pLast[number] = id + 1;
+          pIndex->pOffsets[number + 1]++;
+        }
+      }
+    }
+  }
+  pIndex->firstId[pParam->biggestConstants + 1] = id;
+  
+  for (number = 1; number <= pParam->freWordNum + 1; number++)
+  {
+    pIndex->pOffsets[number] += pIndex->pOffsets[number - 1];
+  }
+  
+  pIndex->postingNum = pIndex->pOffsets[pParam->freWordNum + 1];
+  pIndex->pPostings = (wordnumber_t *) malloc(sizeof(wordnumber_t) *
+                        (pIndex->postingNum + 1));
+  if (!pIndex->pPostings)
+  {
+    log_msg(MALLOC_ERR_6040, LOG_ERR, pParam);
+    exit(1);
+  }
+  
+  /* Fill the lists in the order of the IDs, so they are sorted. pLast[n] is
+   used as the end of the list of word n while it is filled. */
+  for (number = 0; number <= pParam->freWordNum; number++)
+  {
+    pLast[number] = pIndex->pOffsets[number];
+  }
+  
+  id = 0;
+  for (i = 1; i <= pParam->biggestConstants; i++)
+  {
+    pGroup = &pParam->pCandidateGroups[i];
+    
+    for (j = 0; j < pGroup->num; j++, id++)
+    {
+      ppWords = CANDIDATE_WORDS(pGroup, j);
+      for (k = 1; k <= i; k++)
+      {
+        number = ppWords[k]->number;
+        if (pLast[number] == pIndex->pOffsets[number] ||
+          pIndex->pPostings[pLast[number] - 1] != id)
+        {
+          pIndex->pPostings[pLast[number]++] = id;
+        }
+      }
+    }
+  }
+  
+  free((void *) pLast);
+  
+  str_format_int_grouped(digit, pIndex->postingNum);
+  sprintf(logStr, "%s entries in the inverted index of cluster candidates.",
+      digit);
+  log_msg(logStr, LOG_INFO, pParam);
+}
+
+/* Return the first position in pList[lo ... hi - 1] whose ID is at least
+ target, or hi if there is none. The distance to the position is doubled
+ until it is passed, and the last step is a binary search, so that skipping
+ over a long run of a long list costs only its logarithm. */
+static wordnumber_t gallop(wordnumber_t *pList, wordnumber_t lo,
+        wordnumber_t hi, wordnumber_t target)
+{
+  wordnumber_t bound, mid;
+  
+  if (lo >= hi || pList[lo] >= target)
+  {
+    return lo;
+  }
+  
+  /* pList[lo + bound / 2] < target. */
+  bound = 1;
+  while (lo + bound < hi && pList[lo + bound] < target)
+  {
+    bound *= 2;
+  }
+  
+  hi = lo + bound < hi ? lo + bound : hi;
+  lo = lo + bound / 2 + 1;
+  
+  while (lo < hi)
+  {
+    mid = lo + (hi - lo) / 2;
+    if (pList[mid] < target)
+    {
+      lo = mid + 1;
+    }
+    else
+    {
+      hi = mid;
+    }
+  }
+  
+  return lo;
+}
+
+/* Whether there is another candidate, with at least as many constants as
+ pCluster, that has all the constants of pCluster. The lists of the words of
+ pCluster are intersected from the first ID of its group on: every list skips
+ to the biggest ID seen so far, until all the lists are at the same ID.
+ pCluster itself is in the intersection, so the answer is yes as soon as a
+ second ID is found. */
+char has_other_candidate_with_words(struct Cluster *pCluster,
+        struct ClusterIndex *pIndex)
+{
+  wordnumber_t pos[MAXWORDS + 1];
+  wordnumber_t end[MAXWORDS + 1];
+  wordnumber_t *pList;
+  wordnumber_t target, number;
+  int listNum, matched, found, k;
+  
+  pList = pIndex->pPostings;
+  listNum = pCluster->constants;
+  for (k = 0; k < listNum; k++)
+  {
+    number = pCluster->ppWord[k + 1]->number;
+    pos[k] = pIndex->pOffsets[number];
+    end[k] = pIndex->pOffsets[number + 1];
+  }
+  
+  target = pIndex->firstId[pCluster->constants];
+  found = 0;
+  
+  while (1)
+  {
+    matched = 0;
+    k = 0;
+    
+    while (matched < listNum)
+    {
+      pos[k] = gallop(pList, pos[k], end[k], target);
+      if (pos[k] == end[k])
+      {
+        return 0;
+      }
+      
+      if (pList[pos[k]] == target)
+      {
+        matched++;
+      }
+      else
+      {
+        target = pList[pos[k]];
+        matched = 1;
+      }
+      
+      k = (k + 1) % listNum;
+    }
+    
+    found++;
+    if (found == 2)
+    {
+      return 1;
+    }
+    
+    target++;
+  }
+}
+
+void free_cluster_index(struct Parameters *pParam)
+{
+  if (pParam->clusterIndex.pOffsets)
+  {
+    free((void *) pParam->clusterIndex.pOffsets);
+    pParam->clusterIndex.pOffsets = 0;
+  }
+  
+  if (pParam->clusterIndex.pPostings)
+  {
+    free((void *) pParam->clusterIndex.pPostings);
+    pParam->clusterIndex.pPostings = 0;
+  }
+}
@@ -26,47 +26,23 @@
 #include "common_header.h"
 #include "clusters.h"
 
+#include "candidate_store.h"
+
+/* Candidates under the support threshold are deleted from the column store
+ and from pClusterFamily[], but not from the cluster hash table. Their memory
+ belongs to pParam->clusterArena, and is released with the arena. */
 wordnumber_t step_3_find_clusters_from_candidates(struct Parameters *pParam)
 {
-  int clusterNum;
-  struct Cluster *ptr, *pNext, *pPrev;
+  wordnumber_t clusterNum;
   int i;
   
   clusterNum = 0;
   
   for (i = 1; i <= pParam->biggestConstants; i++)
   {
-    ptr = pParam->pClusterFamily[i];
-    pPrev = 0;
-    while (ptr)
-    {
-      if (ptr->count >= pParam->support)
-      {
-        clusterNum++;
-        //print_cluster(ptr);
-        pPrev = ptr;
-        ptr = ptr->pNext;
-      }
-      else
-      {
-        /* Delete this cluster candidate. Only from pClusterFamily[],
-         but not from cluster hash table. */
-        if (pPrev)
-        {
-          pPrev->pNext = ptr->pNext;
-        }
-        else
-        {
-          pParam->pClusterFamily[i] = ptr->pNext;
-        }
-        pNext = ptr->pNext;
-        free((void *) ptr->ppWord);
-        free((void *) ptr->fullWildcard);
-        free((void *) ptr);
-        ptr = pNext;
-      }
-    }
+    clusterNum += keep_supported_candidates(&pParam->pCandidateGroups[i],
+                        pParam->support, pParam);
   }
   
   return clusterNum;
-}
\ No newline at end of file
+}
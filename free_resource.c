@@ -29,11 +29,20 @@
 #include <regex.h>     /* for regcomp() and regexec() */
 #include <syslog.h>    /* for syslog() */
 
+#include "token_cache.h"
+#include "arena.h"
+#include "hash_table_processing.h"
+#include "sketch.h"
+#include "candidate_store.h"
+#include "cluster_index.h"
+
 static void free_inputfiles(struct Parameters *pParam);
 static void free_delim(struct Parameters *pParam);
 static void free_filter(struct Parameters *pParam);
 static void free_template(struct Parameters *pParam);
 static void free_outlier(struct Parameters *pParam);
+static void free_token_cache_name(struct Parameters *pParam);
+
 static void free_wfilter(struct Parameters *pParam);
 static void free_wsearch(struct Parameters *pParam);
 static void free_wreplace(struct Parameters *pParam);
@@ -43,7 +52,6 @@ static void free_cluster_table(struct Parameters *pParam);
 static void free_cluster_sketch(struct Parameters *pParam);
 static void free_cluster_instances(struct Parameters *pParam);
 static void free_cluster_with_token_instances(struct Parameters *pParam);
-static void free_token(struct ClusterWithToken *pClusterWithToken);
 
 
 void free_syslog_facility(struct Parameters *pParam)
@@ -51,75 +59,6 @@ void free_syslog_facility(struct Parameters *pParam)
   free((void *) pParam->pSyslogFacility);
 }
 
-//This function can cause segment 11 error when trie is large. Thus it is not 
-//used. For more details, see the comments of function 
-//step_2_aggregate_supports();
-//void free_trie_nodes(struct TrieNode *pNode, struct Parameters *pParam)
-//{
-//  struct TrieNode *pNext, *pParent;
-//  
-//  if (pNode == 0)
-//  {
-//    return;
-//  }
-//  
-//  /*
-//   if (pParam->pPrefixRoot == 0)
-//   {
-//   return;
-//   }
-//   */
-//  
-//  //ptr = pNode;
-//  
-//  //debug purpose
-//  //char *tmp = "null11";
-//  //debug purpose...
-//  
-//  while (pNode)
-//  {
-//    free_trie_nodes(pNode->pChild, pParam);
-//    
-//    if (pParam->pPrefixRoot == 0)
-//    {
-//      return;
-//    }
-//    
-//    if (pNode != pParam->pPrefixRoot)
-//    {
-//      pNode->pParent->pChild = pNode->pNext;
-//    }
-//    
-//    pNext = pNode->pNext;
-//    pParent = pNode->pParent;
-//    
-//    //debug purpose
-//    //if (pNode->pWord) {
-//    //  log_msg(pNode->pWord->pKey, LOG_INFO, pParam);
-//    
-//    //}
-//    //else
-//    //{
-//    //  log_msg(tmp, LOG_INFO, pParam);
-//    //}
-//    //debug purpose...
-//    
-//    if (pNode == pParam->pPrefixRoot)
-//    {
-//      pParam->pPrefixRoot = 0;
-//    }
-//    
-//    free((void *) pNode);
-//    pNode = pNext;
-//    if (!pNode)
-//    {
-//      pNode =pParent;
-//      //pParent->pChild = 0;
-//    }
-//  }
-//  
-//}
-
 void free_and_clean_step_0(struct Parameters *pParam)
 {
   free_inputfiles(pParam);
@@ -128,6 +67,7 @@ void free_and_clean_step_0(struct Parameters *pParam)
   free_filter(pParam);
   free_template(pParam);
   free_outlier(pParam);
+  free_token_cache_name(pParam);
   free_wfilter(pParam);
   free_wsearch(pParam);
   free_wreplace(pParam);
@@ -139,6 +79,10 @@ void free_and_clean_step_0(struct Parameters *pParam)
 
 void free_and_clean_step_1(struct Parameters *pParam)
 {
+  if (pParam->pTokenCache)
+  {
+    close_token_cache(pParam);
+  }
   free_word_table(pParam);
   free_word_sketch(pParam);
 }
@@ -148,9 +92,16 @@ void free_and_clean_step_2(struct Parameters *pParam)
   free_cluster_table(pParam);
   free_cluster_sketch(pParam);
   free_cluster_instances(pParam);
-  if (pParam->wordWeightThreshold)
+  free_candidate_store(pParam);
+  free_cluster_index(pParam);
+  if (pParam->pTrieNodes)
+  {
+    free((void *) pParam->pTrieNodes);
+  }
+  free_word_dep_table(&pParam->wordDepTable);
+  if (pParam->pWordDepIndex)
   {
-    free((void *) pParam->wordDepMatrix);
+    free((void *) pParam->pWordDepIndex);
   }
 }
 
@@ -219,6 +170,14 @@ static void free_outlier(struct Parameters *pParam)
   }
 }
 
+static void free_token_cache_name(struct Parameters *pParam)
+{
+  if (pParam->pTokenCache)
+  {
+    free((void *) pParam->pTokenCache);
+  }
+}
+
 static void free_wfilter(struct Parameters *pParam)
 {
   if (pParam->pWordFilter)
@@ -247,135 +206,33 @@ static void free_wreplace(struct Parameters *pParam)
 
 static void free_word_table(struct Parameters *pParam)
 {
-  tableindex_t i;
-  struct Elem *ptr, *pNext;
-  
-  for (i = 0; i < pParam->wordTableSize; ++i)
-  {
-    
-    if (!pParam->ppWordTable[i])  { continue; }
-    
-    ptr = pParam->ppWordTable[i];
-    
-    while (ptr)
-    {
-      
-      pNext = ptr->pNext;
-      
-      free((void *) ptr->pKey);
-      free((void *) ptr);
-      
-      ptr = pNext;
-      
-    }
-    
-  }
-  
-  free((void *) pParam->ppWordTable);
+  free_arena(&pParam->wordArena);
+  free_hash_table(&pParam->wordTable);
 }
 
 static void free_word_sketch(struct Parameters *pParam)
 {
-  if (pParam->pWordSketch)
-  {
-    free((void *) pParam->pWordSketch);
-  }
-  
+  free_sketch(&pParam->wordSketch);
 }
 
 static void free_cluster_table(struct Parameters *pParam)
 {
-  tableindex_t i;
-  struct Elem *ptr, *pNext;
-  
-  if (pParam->ppClusterTable)
-  {
-    for (i = 0; i < pParam->clusterTableSize; ++i)
-    {
-      
-      if (!pParam->ppClusterTable[i])  { continue; }
-      
-      ptr = pParam->ppClusterTable[i];
-      
-      while (ptr)
-      {
-        pNext = ptr->pNext;
-        
-        free((void *) ptr->pKey);
-        free((void *) ptr);
-        
-        ptr = pNext;
-      }
-    }
-    
-    free((void *) pParam->ppClusterTable);
-  }
-  
+  free_hash_table(&pParam->clusterTable);
 }
 
 static void free_cluster_sketch(struct Parameters *pParam)
 {
-  if (pParam->pClusterSketch)
-  {
-    free((void *) pParam->pClusterSketch);
-  }
+  free_sketch(&pParam->clusterSketch);
 }
 
 static void free_cluster_instances(struct Parameters *pParam)
 {
-  int i;
-  struct Cluster *ptr, *pNext;
-  
-  for (i = 1; i <= pParam->biggestConstants; i++)
-  {
-    ptr = pParam->pClusterFamily[i];
-    while (ptr)
-    {
-      pNext = ptr->pNext;
-      free((void *) ptr->ppWord);
-      free((void *) ptr->fullWildcard);
-      free((void *) ptr);
-      ptr = pNext;
-    }
-  }
+  /* Together with the elements of the cluster table. */
+  free_arena(&pParam->clusterArena);
+  free_arena(&pParam->candidateArena);
 }
 
 static void free_cluster_with_token_instances(struct Parameters *pParam)
 {
-  int i;
-  struct ClusterWithToken *ptr, *pNext;
-  
-  for (i = 1; i <= pParam->biggestConstants; i++)
-  {
-    ptr = pParam->pClusterWithTokenFamily[i];
-    
-    while (ptr)
-    {
-      pNext = ptr->pNext;
-      free_token(ptr);
-      free((void *) ptr->ppToken);
-      free((void *) ptr->ppWord);
-      free((void *) ptr->fullWildcard);
-      free((void *) ptr);
-      ptr = pNext;
-    }
-  }
+  free_arena(&pParam->joinArena);
 }
-
-static void free_token(struct ClusterWithToken *pClusterWithToken)
-{
-  int i;
-  struct Token *ptr, *pNext;
-  
-  for (i = 1; i <= pClusterWithToken->constants; i++)
-  {
-    ptr = pClusterWithToken->ppToken[i];
-    
-    while (ptr)
-    {
-      pNext = ptr->pNext;
-      free((void *) ptr);
-      ptr = pNext;
-    }
-  }
-}
\ No newline at end of file
@@ -31,7 +31,6 @@ extern "C" {
 #endif
 
 void free_syslog_facility(struct Parameters *pParam);
-//void free_trie_nodes(struct TrieNode *pNode, struct Parameters *pParam);
 void free_and_clean_step_0(struct Parameters *pParam);
 void free_and_clean_step_1(struct Parameters *pParam);
 void free_and_clean_step_2(struct Parameters *pParam);
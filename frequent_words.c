@@ -27,46 +27,75 @@
 #include "frequent_words.h"
 
 #include <string.h>    /* for strcmp(), strcpy(), etc. */
+#include <math.h>      /* for sqrt() */
 
 #include "output.h"
 #include "line_processing.h"
 #include "utility.h"
 #include "word_filter_search_replace.h"
 #include "hash_table_processing.h"
+#include "parallel_processing.h"
+#include "input_reader.h"
+#include "token_cache.h"
+#include "arena.h"
+#include "sketch.h"
+#include "sorting.h"
 
-static tableindex_t create_word_sketch(struct Parameters *pParam);
-static tableindex_t create_word_sketch_with_wfilter(struct Parameters *pParam);
+static void create_word_sketch(struct Parameters *pParam);
+static void create_word_sketch_with_wfilter(struct Parameters *pParam);
 static wordnumber_t create_vocabulary(struct Parameters *pParam);
 static wordnumber_t create_vocabulary_with_wfilter(struct Parameters *pParam);
+static wordnumber_t create_vocabulary_in_parallel(struct Parameters *pParam);
+static void create_vocabulary_worker(struct WorkerContext *pWorker);
+static wordnumber_t create_vocabulary_by_sampling(struct Parameters *pParam);
+static void sample_line(struct LineTokens *pTokens, int pass, int bSampled,
+        wordnumber_t *pNumber, wordnumber_t lastCandidate, 
+        struct Parameters *pParam);
+static int sample_word(char *pWordStr, int wordLen, tableindex_t wordHash,
+        int pass, int bSampled, int distinctWords, wordnumber_t *pNumber,
+        wordnumber_t lastCandidate, struct Parameters *pParam);
+static wordnumber_t keep_sampled_candidates(support_t threshold, 
+        struct Parameters *pParam);
+static void add_line_to_vocabulary(struct LineTokens *pTokens, 
+        wordnumber_t *pNumber, wordnumber_t *pCacheNumbers,
+        struct Parameters *pParam);
+static void compact_word_table(struct Parameters *pParam);
+static void add_line_to_vocabulary_with_wfilter(struct LineTokens *pTokens, 
+        wordnumber_t *pNumber, wordnumber_t *pCacheNumbers,
+        struct Parameters *pParam);
 
 void step_1_create_word_sketch(struct Parameters *pParam)
 {
   tableindex_t effect;
+  double falsePositive;
   char logStr[MAXLOGMSGLEN];
   char digit[MAXDIGITBIT];
   
   log_msg("Creating the word sketch...", LOG_NOTICE, pParam);
-  pParam->pWordSketch = (unsigned long *) malloc(sizeof(unsigned long) *
-                           pParam->wordSketchSize);
-  if (!pParam->pWordSketch)
-  {
-    log_msg(MALLOC_ERR_6014, LOG_ERR, pParam);
-    exit(1);
-  }
+  /* With '--rsupport', the support threshold is only known after this pass,
+   then it is 0 here. */
+  init_sketch(&pParam->wordSketch, pParam->wordSketchSize, pParam->sketchDepth,
+        pParam->wordSketchSeed, 1, pParam->support, pParam);
   
   if (!pParam->pWordFilter)
   {
-    effect = create_word_sketch(pParam);
+    create_word_sketch(pParam);
   }
   else
   {
-    effect = create_word_sketch_with_wfilter(pParam);
+    create_word_sketch_with_wfilter(pParam);
   }
   
+  effect = sketch_oversupport(&pParam->wordSketch, pParam->support,
+                &falsePositive);
   
   str_format_int_grouped(digit, effect);
   sprintf(logStr, "%s slots in the word sketch >= support threshhold", digit);
   log_msg(logStr, LOG_INFO, pParam);
+  
+  sprintf(logStr, "Estimated false positive rate of the word sketch: %.4f%%",
+      falsePositive * 100);
+  log_msg(logStr, LOG_INFO, pParam);
 }
 
 wordnumber_t step_1_create_vocabulary(struct Parameters *pParam)
@@ -76,15 +105,18 @@ wordnumber_t step_1_create_vocabulary(struct Parameters *pParam)
   char digit[MAXDIGITBIT];
   
   log_msg("Creating vocabulary...", LOG_NOTICE, pParam);
-  pParam->ppWordTable = (struct Elem **) malloc(sizeof(struct Elem *) *
-                          pParam->wordTableSize);
-  if (!pParam->ppWordTable)
+  init_hash_table(&pParam->wordTable, pParam->wordTableSize,
+          pParam->wordTableSeed, pParam);
+  
+  if (pParam->wordSampleRate)
   {
-    log_msg(MALLOC_ERR_6015, LOG_ERR, pParam);
-    exit(1);
+    totalWordNum = create_vocabulary_by_sampling(pParam);
   }
-  
-  if (!pParam->pWordFilter)
+  else if (pParam->threadNum > 1)
+  {
+    totalWordNum = create_vocabulary_in_parallel(pParam);
+  }
+  else if (!pParam->pWordFilter)
   {
     totalWordNum = create_vocabulary(pParam);
   }
@@ -105,7 +137,7 @@ wordnumber_t step_1_find_frequent_words(struct Parameters *pParam,
 {
   tableindex_t i;
   wordnumber_t freWordNum;
-  struct Elem *ptr, *pPrev, *pNext;
+  struct Elem *ptr;
   struct WordFreqStat stat;
   char logStr[MAXLOGMSGLEN];
   float pct;
@@ -113,60 +145,60 @@ wordnumber_t step_1_find_frequent_words(struct Parameters *pParam,
   
   freWordNum = 0;
   
+  /* The vocabulary numbers in the token cache are translated to the frequent
+   word IDs with this array, see step_1_build_token_cache(). */
+  if (pParam->pTokenCache)
+  {
+    pParam->pVocabToFrequent = (wordnumber_t *) calloc(sum + 1,
+                               sizeof(wordnumber_t));
+    if (!pParam->pVocabToFrequent)
+    {
+      log_msg(MALLOC_ERR_6026, LOG_ERR, pParam);
+      exit(1);
+    }
+  }
+  
   stat.ones = 0;
   stat.twos = 0;
   stat.fives = 0;
   stat.tens = 0;
   stat.twenties = 0;
   
-  for (i = 0; i < pParam->wordTableSize; i++)
+  for (i = 0; i < pParam->wordTable.size; i++)
   {
-    if (!pParam->ppWordTable[i])
+    ptr = pParam->wordTable.pSlots[i].pElem;
+    if (!ptr)
     {
       continue;
     }
     
-    pPrev = 0;
-    ptr = pParam->ppWordTable[i];
+    if (ptr->count == 1)  { stat.ones++; }
+    if (ptr->count <= 2)  { stat.twos++; }
+    if (ptr->count <= 5)  { stat.fives++; }
+    if (ptr->count <= 10) { stat.tens++; }
+    if (ptr->count <= 20) { stat.twenties++; }
     
-    while (ptr)
+    if (ptr->count < pParam->support)
     {
-      if (ptr->count == 1)  { stat.ones++; }
-      if (ptr->count <= 2)  { stat.twos++; }
-      if (ptr->count <= 5)  { stat.fives++; }
-      if (ptr->count <= 10) { stat.tens++; }
-      if (ptr->count <= 20) { stat.twenties++; }
-      
-      if (ptr->count < pParam->support)
-      {
-        if (pPrev)
-        {
-          pPrev->pNext = ptr->pNext;
-        }
-        else
-        {
-          pParam->ppWordTable[i] = ptr->pNext;
-        }
-        
-        pNext = ptr->pNext;
-        
-        free((void *) ptr->pKey);
-        free((void *) ptr);
-        
-        ptr = pNext;
-      }
-      else
+      /* The table is rebuilt without the emptied slots by
+       compact_word_table(). */
+      pParam->wordTable.pSlots[i].pElem = 0;
+    }
+    else
+    {
+      /* Every frequent word gets a unique sequential ID, beginning
+       from 1, ending at FreWordNum. This unique ID will be used in word
+       dependency calculation. */
+      if (pParam->pVocabToFrequent)
       {
-        /* Every frequent word gets a unique sequential ID, beginning
-         from 1, ending at FreWordNum. This unique ID will be used in word
-         dependency calculation. */
-        ptr->number = ++freWordNum;
-        pPrev = ptr;
-        ptr = ptr->pNext;
+        pParam->pVocabToFrequent[ptr->number] = freWordNum + 1;
       }
+      ptr->number = ++freWordNum;
     }
   }
   
+  compact_word_table(pParam);
+  
   str_format_int_grouped(digit, freWordNum);
   sprintf(logStr, "%s frequent words were found.", digit);
   log_msg(logStr, LOG_NOTICE, pParam);
@@ -221,6 +253,7 @@ void debug_1_print_frequent_words(struct Parameters *pParam)
 {
   struct Elem **ppSortedArray;
   int i, j;
+  tableindex_t k;
   struct Elem *ptr;
   char logStr[MAXLOGMSGLEN];
   char digit[MAXDIGITBIT];
@@ -235,24 +268,17 @@ void debug_1_print_frequent_words(struct Parameters *pParam)
   
   j = 0;
   
-  for (i = 0; i < pParam->wordTableSize; i++)
+  for (k = 0; k < pParam->wordTable.size; k++)
   {
-    if (!pParam->ppWordTable[i])
-    {
-      continue;
-    }
-    
-    ptr = pParam->ppWordTable[i];
-    
-    while (ptr)
+    ptr = pParam->wordTable.pSlots[k].pElem;
+    if (ptr)
     {
       ppSortedArray[j] = ptr;
       j++;
-      ptr = ptr->pNext;
     }
   }
   
-  sort_elements(ppSortedArray, pParam->freWordNum, pParam);
+  sort_elements(ppSortedArray, pParam->freWordNum, compare_words, pParam);
   
   for (i = 0; i < pParam->freWordNum; i++)
   {
@@ -269,62 +295,118 @@ void debug_1_print_frequent_words(struct Parameters *pParam)
  brother function create_word_sketch_with_wfilter(). 
  For the sake of computing performance, sorry for this inconvenience. It will
  be fixed with better solution in the following updates. */
-static tableindex_t create_word_sketch(struct Parameters *pParam)
+static void create_word_sketch(struct Parameters *pParam)
 {
-  FILE *pFile;
-  tableindex_t hash, j, oversupport;
-  int len, i, wordcount;
+  struct InputChunk *pRegion;
+  struct RegionReader reader;
+  int i, wordcount;
   support_t linecount;
-  struct InputFile *pFilePtr;
-  char logStr[MAXLOGMSGLEN];
-  char line[MAXLINELEN];
-  char words[MAXWORDS][MAXWORDLEN];
+  char *line;
+  int linelen;
+  struct LineTokens tokens;
   
   linecount = 0;
   
-  for (j = 0; j < pParam->wordSketchSize; j++)
-  {
-    pParam->pWordSketch[j] = 0;
-  }
+pRegion = create_whole_input_region(pParam);
+  init_line_tokens(&tokens);
+  open_region(&reader, pRegion);
   
-  for (pFilePtr = pParam->pInputFiles; pFilePtr; pFilePtr = pFilePtr->pNext)
+  while (read_region_line(&reader, &line, &linelen, pParam))
   {
-    if (!(pFile = fopen(pFilePtr->pName, "r")))
+    wordcount = find_word_spans(line, linelen, &tokens, pParam);
+    
+    for (i = 0; i < wordcount; i++)
     {
-      sprintf(logStr, "Can't open input file %s", pFilePtr->pName);
-      log_msg(logStr, LOG_ERR, pParam);
-      continue;
+      if (tokens.words[i].len == 0)
+      {
+        continue;
+      }
+      
+      sketch_add(&pParam->wordSketch, tokens.words[i].hash);
     }
     
-    while (fgets(line, MAXLINELEN, pFile))
+    linecount++;
+  }
+  
+  free_line_tokens(&tokens);
+  free_region(pRegion);
+  
+  if (!pParam->linecount)
+  {
+    pParam->linecount = linecount;
+  }
+  
+  if (!pParam->support)
+  {
+    pParam->support = linecount * pParam->pctSupport / 100;
+  }
+}
+
+/* This is a redundant function, which works similarly as function
+ create_word_sketch(), but with consideration of '--wfilter' option. Since
+ this function has a coding style with overlapping IF-s, it could be read while
+ comparing function create_word_sketch() to see the differences. */
+
+/* This redundant function can be integrated into its original function.
+ However, for the sake of performance and readability of the original function,
+ this function is separated as an alone function. */
+
+/* In program, if '--wfilter' option is not used, this function will not be
+ called. */
+
+/* When making changes to this function, don't forget to also change its
+ brother function create_word_sketch(). 
+ For the sake of computing performance, sorry for this inconvenience. It will
+ be fixed with better solution in the following updates. */
+static void create_word_sketch_with_wfilter(struct Parameters *pParam)
+{
+  struct InputChunk *pRegion;
+  struct RegionReader reader;
+  int i, wordcount, wordLen;
+  char *pWordStr, *pNewWord;
+  support_t linecount;
+  char *line;
+  int linelen;
+  struct LineTokens tokens;
+  
+  
+  linecount = 0;
+  
+pRegion = create_whole_input_region(pParam);
+  init_line_tokens(&tokens);
+  open_region(&reader, pRegion);
+  
+  while (read_region_line(&reader, &line, &linelen, pParam))
+  {
+    wordcount = find_word_spans(line, linelen, &tokens, pParam);
+    
+    for (i = 0; i < wordcount; i++)
     {
-      len = (int) strlen(line);
-      if (line[len - 1] == '\n')
+      pWordStr = tokens.pText + tokens.words[i].offset;
+      wordLen = tokens.words[i].len;
+      
+      if (wordLen == 0)
       {
-        line[len - 1] = 0;
+        continue;
       }
       
-      wordcount = find_words(line, words, pParam);
+      sketch_add(&pParam->wordSketch, tokens.words[i].hash);
       
-      for (i = 0; i < wordcount; i++)
+      if (is_word_filtered_with_len(pWordStr, wordLen, pParam))
       {
-        if (words[i][0] == 0)
-        {
-          continue;
-        }
-        
-        hash = str2hash(words[i], pParam->wordSketchSize,
-                pParam->wordSketchSeed);
-        
-        pParam->pWordSketch[hash]++;
+        pNewWord = word_search_replace_with_len(pWordStr, wordLen, pParam);
+        sketch_add(&pParam->wordSketch,
+               str2hash(pNewWord, (int) strlen(pNewWord),
+                    pParam->wordTableSeed));
       }
-      
-      linecount++;
     }
     
-    fclose(pFile);
+    linecount++;
   }
   
+  free_line_tokens(&tokens);
+  free_region(pRegion);
+  
   if (!pParam->linecount)
   {
     pParam->linecount = linecount;
@@ -334,24 +416,72 @@ static tableindex_t create_word_sketch(struct Parameters *pParam)
   {
     pParam->support = linecount * pParam->pctSupport / 100;
   }
+}
+
+/* When making changes to this function, don't forget to also change its
+ brother function create_vocabulary_with_wfilter(). 
+ For the sake of computing performance, sorry for this inconvenience. It will
+ be fixed with better solution in the following updates. */
+static wordnumber_t create_vocabulary(struct Parameters *pParam)
+{
+  wordnumber_t number = 0;
+  struct InputChunk *pRegion;
+  struct RegionReader reader;
+  char *line;
+  int linelen;
+  struct LineTokens tokens;
+  support_t linecount;
+  wordnumber_t cacheNumbers[MAXWORDS];
+  wordnumber_t *pCacheNumbers;
+  
+  linecount = 0;
+  pCacheNumbers = 0;
+  
+  if (pParam->pTokenCache)
+  {
+    open_token_cache_parts(1, pParam);
+    pCacheNumbers = cacheNumbers;
+  }
   
-  oversupport = 0;
+  pRegion = create_whole_input_region(pParam);
+  init_line_tokens(&tokens);
+  open_region(&reader, pRegion);
   
-  for (j = 0; j < pParam->wordSketchSize; j++)
+  while (read_region_line(&reader, &line, &linelen, pParam))
   {
-    if (pParam->pWordSketch[j] >= pParam->support)
+    find_word_spans(line, linelen, &tokens, pParam);
+    
+    add_line_to_vocabulary(&tokens, &number, pCacheNumbers, pParam);
+    
+    if (pCacheNumbers)
     {
-      oversupport++;
+      write_token_cache_record(pParam->ppCacheParts[0], pCacheNumbers,
+                   tokens.wordcount, pParam);
     }
+    
+    linecount++;
+  }
+  
+  free_line_tokens(&tokens);
+  free_region(pRegion);
+  
+  if (!pParam->linecount)
+  {
+    pParam->linecount = linecount;
+  }
+  
+  if (!pParam->support)
+  {
+    pParam->support = linecount * pParam->pctSupport / 100;
   }
   
-  return oversupport;
+  return number;
 }
 
 /* This is a redundant function, which works similarly as function
- create_word_sketch(), but with consideration of '--wfilter' option. Since
+ create_vocabulary(), but with consideration of '--wfilter' option. Since
  this function has a coding style with overlapping IF-s, it could be read while
- comparing function create_word_sketch() to see the differences. */
+ comparing function create_vocabulary() to see the differences. */
 
 /* This redundant function can be integrated into its original function.
  However, for the sake of performance and readability of the original function,
@@ -361,75 +491,157 @@ static tableindex_t create_word_sketch(struct Parameters *pParam)
  called. */
 
 /* When making changes to this function, don't forget to also change its
- brother function create_word_sketch(). 
+ brother function create_vocabulary(). 
  For the sake of computing performance, sorry for this inconvenience. It will
  be fixed with better solution in the following updates. */
-static tableindex_t create_word_sketch_with_wfilter(struct Parameters *pParam)
+static wordnumber_t create_vocabulary_with_wfilter(struct Parameters *pParam)
 {
-  FILE *pFile;
-  tableindex_t hash, j, oversupport;
-  int len, i, wordcount;
+  wordnumber_t number = 0;
+  struct InputChunk *pRegion;
+  struct RegionReader reader;
+  char *line;
+  int linelen;
+  struct LineTokens tokens;
   support_t linecount;
-  struct InputFile *pFilePtr;
-  char logStr[MAXLOGMSGLEN];
-  char line[MAXLINELEN];
-  char words[MAXWORDS][MAXWORDLEN];
-  
+  wordnumber_t cacheNumbers[2 * MAXWORDS];
+  wordnumber_t *pCacheNumbers;
   
   linecount = 0;
+  pCacheNumbers = 0;
   
-  for (j = 0; j < pParam->wordSketchSize; j++)
+  if (pParam->pTokenCache)
   {
-    pParam->pWordSketch[j] = 0;
+    open_token_cache_parts(1, pParam);
+    pCacheNumbers = cacheNumbers;
   }
   
-  for (pFilePtr = pParam->pInputFiles; pFilePtr; pFilePtr = pFilePtr->pNext)
+  pRegion = create_whole_input_region(pParam);
+  init_line_tokens(&tokens);
+  open_region(&reader, pRegion);
+  
+  while (read_region_line(&reader, &line, &linelen, pParam))
   {
-    if (!(pFile = fopen(pFilePtr->pName, "r")))
+    find_word_spans(line, linelen, &tokens, pParam);
+    
+    add_line_to_vocabulary_with_wfilter(&tokens, &number, pCacheNumbers,
+                      pParam);
+    
+    if (pCacheNumbers)
     {
-      sprintf(logStr, "Can't open input file %s", pFilePtr->pName);
-      log_msg(logStr, LOG_ERR, pParam);
-      continue;
+      write_token_cache_record(pParam->ppCacheParts[0], pCacheNumbers,
+                   tokens.wordcount, pParam);
+    }
+    
+    linecount++;
+  }
+  
+  free_line_tokens(&tokens);
+  free_region(pRegion);
+  
+  if (!pParam->linecount)
+  {
+    pParam->linecount = linecount;
+  }
+  
+  if (!pParam->support)
+  {
+    pParam->support = linecount * pParam->pctSupport / 100;
+  }
+  
+  return number;
+}
+
+/* Build the vocabulary with pParam->threadNum worker threads. Every worker
+ counts the words of its own region of the data set in a local word table, see
+ function create_vocabulary_worker(). Afterwards, the local tables are merged
+ into pParam->wordTable. Since a line is read by exactly one worker, and a
+ word is counted at most once per line, the merged counts are the same as the
+ counts of the single-threaded functions. */
+static wordnumber_t create_vocabulary_in_parallel(struct Parameters *pParam)
+{
+  wordnumber_t number = 0;
+  tableindex_t j;
+  struct WorkerContext *pWorkers;
+  struct Elem *ptr, *pElem;
+  struct HashTable *pLocal;
+  wordnumber_t localNumber;
+  wordnumber_t *pMap;
+  support_t linecount;
+  int i;
+  
+  /* The workers are cloned from pParam, so the parts of the token cache must
+   be opened before. */
+  if (pParam->pTokenCache)
+  {
+    open_token_cache_parts(pParam->threadNum, pParam);
+  }
+  
+  pWorkers = create_workers(pParam);
+  run_workers(pWorkers, create_vocabulary_worker, pParam);
+  
+  /* Every worker numbers its words by itself. The numbers in a part of the
+   token cache are translated to the global ones with the map of the part. */
+  if (pParam->pTokenCache)
+  {
+    pParam->ppCachePartMaps = (wordnumber_t **) 
+                  calloc(pParam->threadNum, sizeof(wordnumber_t *));
+    if (!pParam->ppCachePartMaps)
+    {
+      log_msg(MALLOC_ERR_6025, LOG_ERR, pParam);
+      exit(1);
+    }
+  }
+  
+  linecount = 0;
+  
+  for (i = 0; i < pParam->threadNum; i++)
+  {
+    linecount += pWorkers[i].linecount;
+    pMap = 0;
+    
+    if (pParam->pTokenCache)
+    {
+      pMap = (wordnumber_t *) malloc(sizeof(wordnumber_t) *
+                     (pWorkers[i].elemNum + 1));
+      if (!pMap)
+      {
+        log_msg(MALLOC_ERR_6025, LOG_ERR, pParam);
+        exit(1);
+      }
+      pMap[0] = 0;
+      pParam->ppCachePartMaps[i] = pMap;
     }
     
-    while (fgets(line, MAXLINELEN, pFile))
+    pLocal = &pWorkers[i].param.wordTable;
+    
+    for (j = 0; j < pLocal->size; j++)
     {
-      len = (int) strlen(line);
-      if (line[len - 1] == '\n')
+      ptr = pLocal->pSlots[j].pElem;
+      if (!ptr)
       {
-        line[len - 1] = 0;
+        continue;
       }
       
-      wordcount = find_words(line, words, pParam);
+      localNumber = ptr->number;
       
-      for (i = 0; i < wordcount; i++)
+      pElem = merge_elem(ptr, &pParam->wordTable, pParam);
+      if (pElem == ptr)
       {
-        if (words[i][0] == 0)
-        {
-          continue;
-        }
-        
-        hash = str2hash(words[i], pParam->wordSketchSize,
-                pParam->wordSketchSeed);
-        
-        pParam->pWordSketch[hash]++;
-        
-        if (is_word_filtered(words[i], pParam))
-        {
-          hash = str2hash(word_search_replace(words[i], pParam),
-                  pParam->wordSketchSize,
-                  pParam->wordSketchSeed);
-          
-          pParam->pWordSketch[hash]++;
-        }
+        ptr->number = ++number;
       }
       
-      linecount++;
+      if (pMap)
+      {
+        pMap[localNumber] = pElem->number;
+      }
     }
     
-    fclose(pFile);
+    free_hash_table(pLocal);
+    adopt_arena(&pParam->wordArena, &pWorkers[i].param.wordArena);
   }
   
+  destroy_workers(pWorkers, pParam);
+  
   if (!pParam->linecount)
   {
     pParam->linecount = linecount;
@@ -440,340 +652,639 @@ static tableindex_t create_word_sketch_with_wfilter(struct Parameters *pParam)
     pParam->support = linecount * pParam->pctSupport / 100;
   }
   
-  oversupport = 0;
+  return number;
+}
+
+/* The function run by every worker thread of create_vocabulary_in_parallel().
+ The words of the region of the worker are counted in a local word table,
+ which has the same size and seed as the global one. */
+static void create_vocabulary_worker(struct WorkerContext *pWorker)
+{
+  struct Parameters *pParam;
+  struct RegionReader reader;
+  wordnumber_t number = 0;
+  char *line;
+  int linelen;
+  struct LineTokens tokens;
+  wordnumber_t cacheNumbers[2 * MAXWORDS];
+  wordnumber_t *pCacheNumbers;
+  
+  pParam = &pWorker->param;
+  pCacheNumbers = pParam->pTokenCache ? cacheNumbers : 0;
   
-  for (j = 0; j < pParam->wordSketchSize; j++)
+  init_hash_table(&pParam->wordTable, pParam->wordTableSize,
+          pParam->wordTableSeed, pParam);
+  
+  init_line_tokens(&tokens);
+  open_region(&reader, pWorker->pRegion);
+  
+  while (read_region_line(&reader, &line, &linelen, pParam))
   {
-    if (pParam->pWordSketch[j] >= pParam->support)
+    find_word_spans(line, linelen, &tokens, pParam);
+    
+    if (!pParam->pWordFilter)
     {
-      oversupport++;
+      add_line_to_vocabulary(&tokens, &number, pCacheNumbers, pParam);
     }
+    else
+    {
+      add_line_to_vocabulary_with_wfilter(&tokens, &number, pCacheNumbers,
+                        pParam);
+    }
+    
+    if (pCacheNumbers)
+    {
+      write_token_cache_record(pParam->ppCacheParts[pWorker->id],
+                   pCacheNumbers, tokens.wordcount, pParam);
+    }
+    
+    pWorker->linecount++;
   }
   
-  return oversupport;
+  free_line_tokens(&tokens);
+  
+  pWorker->elemNum = number;
 }
 
-/* When making changes to this function, don't forget to also change its
- brother function create_vocabulary_with_wfilter(). 
- For the sake of computing performance, sorry for this inconvenience. It will
- be fixed with better solution in the following updates. */
-static wordnumber_t create_vocabulary(struct Parameters *pParam)
+/* Build the vocabulary in the '--wsample' mode. Only the words that are likely
+ to be frequent are kept in memory:
+ 
+ 1. Sampling pass: a uniform sample of pParam->wordSampleRate of the lines is
+ taken, and the words of the sampled lines are counted in pParam->wordTable.
+ At the same time, the occurrences of all words of all lines are counted in
+ the word sketch. The words which reach a lowered threshold in the sample are
+ kept as candidates, the others are removed.
+ 
+ 2. Verifying pass: the candidates are counted exactly over all lines. Every
+ occurrence of a candidate is also subtracted from its sketch slot, so that
+ afterwards the sketch only holds the occurrences of the other words.
+ 
+ 3. Fix-up pass: a frequent word that was missed by the sample has at least
+ pParam->support occurrences in its sketch slot. Only if there is such a slot,
+ the data set is read once more, and the words that fall into these slots are
+ counted exactly.
+ 
+ The words under support are removed afterwards by
+ step_1_find_frequent_words(), so the frequent words are the same as without
+ sampling. Returns the number of words in the vocabulary. */
+static wordnumber_t create_vocabulary_by_sampling(struct Parameters *pParam)
 {
-  wordnumber_t number = 0;
-  tableindex_t j, hash;
-  struct InputFile *pFilePtr;
-  FILE *pFile;
+  struct InputChunk *pRegion;
+  struct RegionReader reader;
+  struct LineTokens tokens;
+  wordnumber_t number, lastCandidate, candidateNum;
+  tableindex_t suspicious;
+  support_t linecount, sampleLinecount, threshold;
+  unsigned int random, limit;
+  double expected;
+  char *line;
+  int linelen;
   char logStr[MAXLOGMSGLEN];
-  char line[MAXLINELEN];
-  char words[MAXWORDS][MAXWORDLEN];
-  int i, len, wordcount, distinctWords;
-  struct Elem *word;
-  support_t linecount;
+  char digit[MAXDIGITBIT];
+  
+  /* The counts of the candidates are taken back from the sketch in the
+   verifying pass, so the sketch is built without conservative update. */
+  init_sketch(&pParam->wordSketch, pParam->wordSketchSize, pParam->sketchDepth,
+        pParam->wordSketchSeed, 0, 0, pParam);
+  
+  number = 0;
+  linecount = 0;
+  sampleLinecount = 0;
   
+  /* The lines are sampled with a xorshift generator seeded with the
+   '--initseed' value, so that the sample does not change from run to run. */
+  random = pParam->initSeed ? pParam->initSeed : 1;
+  limit = (unsigned int) (pParam->wordSampleRate * 4294967295.0);
   
-  for (j = 0; j < pParam->wordTableSize; j++)
+  pRegion = create_whole_input_region(pParam);
+  init_line_tokens(&tokens);
+  
+  /* 1. Sampling pass. */
+  open_region(&reader, pRegion);
+  
+  while (read_region_line(&reader, &line, &linelen, pParam))
   {
-    pParam->ppWordTable[j] = 0;
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+    
+    find_word_spans(line, linelen, &tokens, pParam);
+    
+    if (random <= limit)
+    {
+      sample_line(&tokens, SAMPLING_PASS, 1, &number, 0, pParam);
+      sampleLinecount++;
+    }
+    else
+    {
+      sample_line(&tokens, SAMPLING_PASS, 0, &number, 0, pParam);
+    }
+    
+    linecount++;
   }
   
-  for (pFilePtr = pParam->pInputFiles; pFilePtr; pFilePtr = pFilePtr->pNext)
+  if (!pParam->linecount)
   {
-    if (!(pFile = fopen(pFilePtr->pName, "r")))
+    pParam->linecount = linecount;
+  }
+  
+  if (!pParam->support)
+  {
+    pParam->support = linecount * pParam->pctSupport / 100;
+  }
+  
+  /* The count of a word with support occurrences in the sample is binomial,
+   with mean support * rate. The threshold is set three standard deviations
+   below it, so that a frequent word is rarely missed by the sample (and if
+   it is, the fix-up pass will find it). */
+  expected = (double) pParam->support * sampleLinecount / 
+             (linecount ? linecount : 1);
+  expected -= 3 * sqrt(expected);
+  threshold = expected > 1 ? (support_t) expected : 1;
+  
+  lastCandidate = number;
+  candidateNum = keep_sampled_candidates(threshold, pParam);
+  
+  str_format_int_grouped(digit, candidateNum);
+  sprintf(logStr, "%s candidate frequent words were proposed by the sample "
+      "of %lu lines.", digit, (unsigned long) sampleLinecount);
+  log_msg(logStr, LOG_INFO, pParam);
+  
+  /* 2. Verifying pass. */
+  open_region(&reader, pRegion);
+  
+  while (read_region_line(&reader, &line, &linelen, pParam))
+  {
+    find_word_spans(line, linelen, &tokens, pParam);
+    sample_line(&tokens, VERIFYING_PASS, 0, &number, lastCandidate, pParam);
+  }
+  
+  suspicious = sketch_oversupport(&pParam->wordSketch, pParam->support, 0);
+  
+  /* 3. Fix-up pass. */
+  if (suspicious)
+  {
+    str_format_int_grouped(digit, suspicious);
+    sprintf(logStr, "%s slots in the word sketch may hide frequent words "
+        "which were missed by the sample, making a fix-up pass.", digit);
+    log_msg(logStr, LOG_INFO, pParam);
+    
+    open_region(&reader, pRegion);
+    
+    while (read_region_line(&reader, &line, &linelen, pParam))
+    {
+      find_word_spans(line, linelen, &tokens, pParam);
+      sample_line(&tokens, FIXUP_PASS, 0, &number, lastCandidate, pParam);
+    }
+  }
+  
+  free_line_tokens(&tokens);
+  free_region(pRegion);
+  
+  return candidateNum + (number - lastCandidate);
+}
+
+/* Count the words of one line in one of the passes of
+ create_vocabulary_by_sampling(). bSampled tells if the line belongs to the
+ sample. The words with a number not greater than lastCandidate are the
+ candidates proposed by the sample. */
+static void sample_line(struct LineTokens *pTokens, int pass, int bSampled,
+        wordnumber_t *pNumber, wordnumber_t lastCandidate, 
+        struct Parameters *pParam)
+{
+  int i, distinctWords, wordLen;
+  char *pWordStr;
+  char newWord[MAXWORDLEN];
+  
+  distinctWords = 0;
+  
+  for (i = 0; i < pTokens->wordcount; i++)
+  {
+    pWordStr = pTokens->pText + pTokens->words[i].offset;
+    wordLen = pTokens->words[i].len;
+    
+    if (wordLen == 0)
     {
-      sprintf(logStr, "Can't open input file %s", pFilePtr->pName);
-      log_msg(logStr, LOG_ERR, pParam);
       continue;
     }
     
-    while (fgets(line, MAXLINELEN, pFile))
+    distinctWords = sample_word(pWordStr, wordLen, pTokens->words[i].hash,
+                  pass, bSampled, distinctWords, pNumber,
+                  lastCandidate, pParam);
+    
+    if (pParam->pWordFilter &&
+      is_word_filtered_with_len(pWordStr, wordLen, pParam))
     {
-      len = (int) strlen(line);
-      if (line[len - 1] == '\n')
+      strcpy(newWord, word_search_replace_with_len(pWordStr, wordLen,
+                               pParam));
+      wordLen = (int) strlen(newWord);
+      distinctWords = sample_word(newWord, wordLen,
+                    str2hash(newWord, wordLen,
+                         pParam->wordTableSeed),
+                    pass, bSampled, distinctWords, pNumber,
+                    lastCandidate, pParam);
+    }
+  }
+}
+
+/* Count one word of a line, see function sample_line(). wordHash is the
+ str2hash() value of the word. Like in add_line_to_vocabulary(), a word is
+ counted at most once per line. Returns the new number of distinct words of
+ the line. */
+static int sample_word(char *pWordStr, int wordLen, tableindex_t wordHash,
+        int pass, int bSampled, int distinctWords, wordnumber_t *pNumber,
+        wordnumber_t lastCandidate, struct Parameters *pParam)
+{
+  struct Elem *word;
+  
+  switch (pass)
+  {
+    case SAMPLING_PASS:
+      sketch_add(&pParam->wordSketch, wordHash);
+      if (!bSampled)
       {
-        line[len - 1] = 0;
+        return distinctWords;
       }
       
-      wordcount = find_words(line, words, pParam);
+      word = add_elem_with_hash(pWordStr, wordLen, wordHash, &pParam->wordTable,
+                    pParam);
+      if (word->count == 1)
+      {
+        (*pNumber)++;
+        word->number = *pNumber;
+      }
+      break;
+    case VERIFYING_PASS:
+      word = find_elem_with_hash(pWordStr, wordLen, wordHash,
+                     &pParam->wordTable);
+      if (!word)
+      {
+        return distinctWords;
+      }
       
-      distinctWords = 0;
+      sketch_remove(&pParam->wordSketch, wordHash);
+      word->count++;
+      break;
+    case FIXUP_PASS:
+      if (sketch_estimate(&pParam->wordSketch, wordHash) < pParam->support)
+      {
+        return distinctWords;
+      }
       
-      for (i = 0; i < wordcount; i++)
+      word = add_elem_with_hash(pWordStr, wordLen, wordHash, &pParam->wordTable,
+                    pParam);
+      if (word->count == 1)
       {
-        if (words[i][0] == 0)
-        {
-          continue;
-        }
-        
-        /* The technique to save memory space. */
-        if (pParam->wordSketchSize)
-        {
-          hash = str2hash(words[i], pParam->wordSketchSize, 
-                  pParam->wordSketchSeed);
-          if (pParam->pWordSketch[hash] < pParam->support)
-          {
-            continue;
-          }
-        }
-        
-        word = add_elem(words[i], pParam->ppWordTable, pParam->wordTableSize, 
-                pParam->wordTableSeed, pParam);
-        distinctWords++;
-        
-        if (word->count == 1)
-        {
-          number++;
-          word->number = number;
-        }
-        
-        /* If word is repeated..its support will not increment more than
-         once in one log line. */
-        if (is_word_repeated(pParam->wordNumStr, word->number,
-                   distinctWords))
-        {
-          distinctWords--;
-          word->count--;
-        }
-        else
-        {
-          pParam->wordNumStr[distinctWords] = word->number;
-        }
-        
+        (*pNumber)++;
+        word->number = *pNumber;
       }
       
-      linecount++;
-    }
-    
-    fclose(pFile);
-    
+      /* The candidates were already counted in the verifying pass. */
+      if (word->number <= lastCandidate)
+      {
+        word->count--;
+        return distinctWords;
+      }
+      break;
+    default:
+      return distinctWords;
   }
   
-  if (!pParam->linecount)
+  distinctWords++;
+  
+  /* If word is repeated..its support will not increment more than once in
+   one log line. */
+  if (is_word_repeated(pParam->wordNumStr, word->number, distinctWords))
   {
-    pParam->linecount = linecount;
+    distinctWords--;
+    word->count--;
+  }
+  else
+  {
+    pParam->wordNumStr[distinctWords] = word->number;
   }
   
-  if (!pParam->support)
+  return distinctWords;
+}
+
+/* Remove the words that occur less than threshold times in the sample from
+ pParam->wordTable, and set the counts of the remaining candidates to zero
+ for the verifying pass. Returns the number of candidates. */
+static wordnumber_t keep_sampled_candidates(support_t threshold, 
+        struct Parameters *pParam)
+{
+  tableindex_t i;
+  wordnumber_t candidateNum;
+  struct Elem *ptr;
+  
+  candidateNum = 0;
+  
+  for (i = 0; i < pParam->wordTable.size; i++)
   {
-    pParam->support = linecount * pParam->pctSupport / 100;
+    ptr = pParam->wordTable.pSlots[i].pElem;
+    if (!ptr)
+    {
+      continue;
+    }
+    
+    if (ptr->count < threshold)
+    {
+      pParam->wordTable.pSlots[i].pElem = 0;
+    }
+    else
+    {
+      ptr->count = 0;
+      candidateNum++;
+    }
   }
   
-  return number;
+  compact_word_table(pParam);
+  
+  return candidateNum;
 }
 
-/* This is a redundant function, which works similarly as function
- create_vocabulary(), but with consideration of '--wfilter' option. Since
- this function has a coding style with overlapping IF-s, it could be read while
- comparing function create_vocabulary() to see the differences. */
+/* Insert the words of one line into pParam->wordTable. *pNumber is the
+ number of distinct words in the table so far, and is used to give every new
+ word its number. */
 
-/* This redundant function can be integrated into its original function.
- However, for the sake of performance and readability of the original function,
- this function is separated as an alone function. */
+/* When making changes to this function, don't forget to also change its
+ brother function add_line_to_vocabulary_with_wfilter(). 
+ For the sake of computing performance, sorry for this inconvenience. It will
+ be fixed with better solution in the following updates. */
+static void add_line_to_vocabulary(struct LineTokens *pTokens, 
+        wordnumber_t *pNumber, wordnumber_t *pCacheNumbers,
+        struct Parameters *pParam)
+{
+  int i, distinctWords, wordLen;
+  char *pWordStr;
+  struct Elem *word;
+  
+  distinctWords = 0;
+  
+  for (i = 0; i < pTokens->wordcount; i++)
+  {
+    pWordStr = pTokens->pText + pTokens->words[i].offset;
+    wordLen = pTokens->words[i].len;
+    
+    if (pCacheNumbers)
+    {
+      pCacheNumbers[i] = 0;
+    }
+    
+    if (wordLen == 0)
+    {
+      continue;
+    }
+    
+    /* The technique to save memory space. */
+    if (pParam->wordSketchSize)
+    {
+      if (sketch_estimate(&pParam->wordSketch, pTokens->words[i].hash) < 
+        pParam->support)
+      {
+        continue;
+      }
+    }
+    
+    word = add_elem_with_hash(pWordStr, wordLen, pTokens->words[i].hash,
+                  &pParam->wordTable, pParam);
+    distinctWords++;
+    
+    if (word->count == 1)
+    {
+      (*pNumber)++;
+      word->number = *pNumber;
+    }
+    
+    if (pCacheNumbers)
+    {
+      pCacheNumbers[i] = word->number;
+    }
+    
+    /* If word is repeated..its support will not increment more than
+     once in one log line. */
+    if (is_word_repeated(pParam->wordNumStr, word->number,
+               distinctWords))
+    {
+      distinctWords--;
+      word->count--;
+    }
+    else
+    {
+      pParam->wordNumStr[distinctWords] = word->number;
+    }
+    
+  }
+}
 
-/* In program, if '--wfilter' option is not used, this function will not be
- called. */
+/* This is a redundant function, which works similarly as function
+ add_line_to_vocabulary(), but with consideration of '--wfilter' option. */
 
 /* When making changes to this function, don't forget to also change its
- brother function create_vocabulary(). 
+ brother function add_line_to_vocabulary(). 
  For the sake of computing performance, sorry for this inconvenience. It will
  be fixed with better solution in the following updates. */
-static wordnumber_t create_vocabulary_with_wfilter(struct Parameters *pParam)
+static void add_line_to_vocabulary_with_wfilter(struct LineTokens *pTokens, 
+        wordnumber_t *pNumber, wordnumber_t *pCacheNumbers,
+        struct Parameters *pParam)
 {
-  wordnumber_t number = 0;
-  tableindex_t j, hash;
-  struct InputFile *pFilePtr;
-  FILE *pFile;
-  char logStr[MAXLOGMSGLEN];
-  char line[MAXLINELEN];   /*10240*/
-  char words[MAXWORDS][MAXWORDLEN];   /*512 10248*/
-  int i, len, wordcount, distinctWords;
+  tableindex_t newWordHash;
+  int i, distinctWords, wordLen, newWordLen;
+  char *pWordStr;
   struct Elem *word;
-  support_t linecount;
   char newWord[MAXWORDLEN];
   
   *newWord = 0;
   
-  for (j = 0; j < pParam->wordTableSize; j++)
-  {
-    pParam->ppWordTable[j] = 0;
-  }
+  distinctWords = 0;
   
-  for (pFilePtr = pParam->pInputFiles; pFilePtr; pFilePtr = pFilePtr->pNext)
+  for (i = 0; i < pTokens->wordcount; i++)
   {
-    if (!(pFile = fopen(pFilePtr->pName, "r")))
+    pWordStr = pTokens->pText + pTokens->words[i].offset;
+    wordLen = pTokens->words[i].len;
+    
+    if (pCacheNumbers)
+    {
+      pCacheNumbers[2 * i] = 0;
+      pCacheNumbers[2 * i + 1] = 0;
+    }
+    
+    if (wordLen == 0)
     {
-      sprintf(logStr, "Can't open input file %s", pFilePtr->pName);
-      log_msg(logStr, LOG_ERR, pParam);
       continue;
     }
     
-    while (fgets(line, MAXLINELEN, pFile))
+    if (pParam->wordSketchSize)
     {
-      len = (int) strlen(line);
-      if (line[len - 1] == '\n')
-      {
-        line[len - 1] = 0;
-      }
-      
-      wordcount = find_words(line, words, pParam);
-      
-      distinctWords = 0;
-      
-      for (i = 0; i < wordcount; i++)
+      if (sketch_estimate(&pParam->wordSketch, pTokens->words[i].hash) >= 
+        pParam->support)
       {
-        if (words[i][0] == 0)
+        word = add_elem_with_hash(pWordStr, wordLen, pTokens->words[i].hash,
+                      &pParam->wordTable, pParam);
+        
+        distinctWords++;
+        
+        if (word->count == 1)
         {
-          continue;
+          (*pNumber)++;
+          word->number = *pNumber;
         }
         
-        if (pParam->wordSketchSize)
+        if (pCacheNumbers)
         {
-          hash = str2hash(words[i], pParam->wordSketchSize,
-                  pParam->wordSketchSeed);
-          
-          if (pParam->pWordSketch[hash] >= pParam->support)
-          {
-            word = add_elem(words[i], pParam->ppWordTable,
-                    pParam->wordTableSize,
-                    pParam->wordTableSeed,
-                    pParam);
-            
-            distinctWords++;
-            
-            if (word->count == 1)
-            {
-              number++;
-              word->number = number;
-            }
-            
-            /* If word is repeated..its support will not increment
-             more than once in one log line. */
-            if (is_word_repeated(pParam->wordNumStr, word->number,
-                       distinctWords))
-            {
-              distinctWords--;
-              word->count--;
-            }
-            else
-            {
-              pParam->wordNumStr[distinctWords] = word->number;
-            }
-            
-          }
-          
-          if (is_word_filtered(words[i], pParam))
-          {
-            strcpy(newWord, word_search_replace(words[i], pParam));
-            hash = str2hash(newWord, pParam->wordSketchSize,
-                    pParam->wordSketchSeed);
-            
-            if (pParam->pWordSketch[hash] >= pParam->support)
-            {
-              word = add_elem(newWord, pParam->ppWordTable,
-                      pParam->wordTableSize,
-                      pParam->wordTableSeed,
-                      pParam);
-              
-              distinctWords++;
-              
-              if (word->count == 1)
-              {
-                number++;
-                word->number = number;
-              }
-              
-              /* If word is repeated..its support will not
-               increment more than once in one log line. */
-              if (is_word_repeated(pParam->wordNumStr,
-                         word->number, distinctWords))
-              {
-                distinctWords--;
-                word->count--;
-              }
-              else
-              {
-                pParam->wordNumStr[distinctWords]= word->number;
-              }
-              
-            }
-          }
+          pCacheNumbers[2 * i] = word->number;
+        }
+        
+        /* If word is repeated..its support will not increment
+         more than once in one log line. */
+        if (is_word_repeated(pParam->wordNumStr, word->number,
+                   distinctWords))
+        {
+          distinctWords--;
+          word->count--;
         }
         else
         {
-          word = add_elem(words[i], pParam->ppWordTable,
-                  pParam->wordTableSize,
-                  pParam->wordTableSeed,
-                  pParam);
+          pParam->wordNumStr[distinctWords] = word->number;
+        }
+        
+      }
+      
+      if (is_word_filtered_with_len(pWordStr, wordLen, pParam))
+      {
+        strcpy(newWord, word_search_replace_with_len(pWordStr, wordLen,
+                               pParam));
+        newWordLen = (int) strlen(newWord);
+        newWordHash = str2hash(newWord, newWordLen, pParam->wordTableSeed);
+        if (sketch_estimate(&pParam->wordSketch, newWordHash) >= 
+          pParam->support)
+        {
+          word = add_elem_with_hash(newWord, newWordLen, newWordHash,
+                        &pParam->wordTable, pParam);
           
           distinctWords++;
           
           if (word->count == 1)
           {
-            number++;
-            word->number = number;
+            (*pNumber)++;
+            word->number = *pNumber;
           }
           
-          /* If word is repeated..its support will not increment more
-           than once in one log line. */
-          if (is_word_repeated(pParam->wordNumStr, word->number,
-                     distinctWords))
+          if (pCacheNumbers)
+          {
+            pCacheNumbers[2 * i + 1] = word->number;
+          }
+          
+          /* If word is repeated..its support will not
+           increment more than once in one log line. */
+          if (is_word_repeated(pParam->wordNumStr,
+                     word->number, distinctWords))
           {
             distinctWords--;
             word->count--;
           }
           else
           {
-            pParam->wordNumStr[distinctWords] = word->number;
+            pParam->wordNumStr[distinctWords]= word->number;
           }
           
-          if (is_word_filtered(words[i], pParam))
-          {
-            strcpy(newWord, word_search_replace(words[i], pParam));
-            word = add_elem(newWord, pParam->ppWordTable,
-                    pParam->wordTableSize,
-                    pParam->wordTableSeed,
-                    pParam);
-            
-            distinctWords++;
-            
-            if (word->count == 1)
-            {
-              number++;
-              word->number = number;
-            }
-            
-            /* If word is repeated..its support will not increment
-             more than once in one log line. */
-            if (is_word_repeated(pParam->wordNumStr, word->number,
-                       distinctWords))
-            {
-              distinctWords--;
-              word->count--;
-            }
-            else
-            {
-              pParam->wordNumStr[distinctWords] = word->number;
-            }
-          }
         }
       }
+    }
+    else
+    {
+      word = add_elem_with_hash(pWordStr, wordLen, pTokens->words[i].hash,
+                    &pParam->wordTable, pParam);
+      
+      distinctWords++;
+      
+      if (word->count == 1)
+      {
+        (*pNumber)++;
+        word->number = *pNumber;
+      }
+      
+      if (pCacheNumbers)
+      {
+        pCacheNumbers[2 * i] = word->number;
+      }
+      
+      /* If word is repeated..its support will not increment more
+       than once in one log line. */
+      if (is_word_repeated(pParam->wordNumStr, word->number,
+                 distinctWords))
+      {
+        distinctWords--;
+        word->count--;
+      }
+      else
+      {
+        pParam->wordNumStr[distinctWords] = word->number;
+      }
       
-      linecount++;
+      if (is_word_filtered_with_len(pWordStr, wordLen, pParam))
+      {
+        strcpy(newWord, word_search_replace_with_len(pWordStr, wordLen,
+                               pParam));
+        word = add_elem(newWord, &pParam->wordTable, pParam);
+        
+        distinctWords++;
+        
+        if (word->count == 1)
+        {
+          (*pNumber)++;
+          word->number = *pNumber;
+        }
+        
+        if (pCacheNumbers)
+        {
+          pCacheNumbers[2 * i + 1] = word->number;
+        }
+        
+        /* If word is repeated..its support will not increment
+         more than once in one log line. */
+        if (is_word_repeated(pParam->wordNumStr, word->number,
+                   distinctWords))
+        {
+          distinctWords--;
+          word->count--;
+        }
+        else
+        {
+          pParam->wordNumStr[distinctWords] = word->number;
+        }
+      }
     }
-    
-    fclose(pFile);
-    
   }
+}
+
+/* Rebuild pParam->wordTable after a large part of it was removed (e.g. the
+ infrequent words, whose slots were emptied by the caller), so that it is sized
+ for the remaining elements. Then move these elements into a new arena, and
+ release the old one, since the removed words are not freed one by one. */
+static void compact_word_table(struct Parameters *pParam)
+{
+  struct Arena arena;
+  struct Elem *ptr, *pCopy;
+  tableindex_t i;
   
-  if (!pParam->linecount)
-  {
-    pParam->linecount = linecount;
-  }
+  purge_hash_table(&pParam->wordTable, pParam);
+  init_arena(&arena, pParam->wordArena.blockSize);
   
-  if (!pParam->support)
+  for (i = 0; i < pParam->wordTable.size; i++)
   {
-    pParam->support = linecount * pParam->pctSupport / 100;
+    ptr = pParam->wordTable.pSlots[i].pElem;
+    if (!ptr)
+    {
+      continue;
+    }
+    
+    pCopy = (struct Elem *) arena_alloc(&arena, sizeof(struct Elem), pParam);
+    *pCopy = *ptr;
+    pCopy->pKey = arena_strndup(&arena, ptr->pKey, ptr->keyLen, pParam);
+    pParam->wordTable.pSlots[i].pElem = pCopy;
   }
   
-  return number;
+  free_arena(&pParam->wordArena);
+  pParam->wordArena = arena;
 }
-
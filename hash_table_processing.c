@@ -30,117 +30,678 @@
 
 #include "utility.h"
 #include "output.h"
+#include "arena.h"
+#include "perfect_hash.h"
 
-struct Elem *add_elem(char *pKey, struct Elem **ppTable, tableindex_t tablesize, 
+static void resize_hash_table(struct HashTable *pTable, tableindex_t size,
+        struct Parameters *pParam);
+static void insert_slot(struct HashTable *pTable, tableindex_t hash, 
+        struct Elem *pElem);
+static void grow_hash_table_if_full(struct HashTable *pTable, 
+        struct Parameters *pParam);
+static int compare_slots_by_count(const void *p1, const void *p2);
+static struct Elem *find_word_slot(struct HashTable *pTable, tableindex_t hash,
+        char *pKey, int keyLen);
+static struct Elem *find_cluster_slot(struct HashTable *pTable, 
+        tableindex_t hash, wordnumber_t *pKey, size_t keySize);
+static void resize_word_dep_table(struct WordDepTable *pTable, 
+        tableindex_t size, struct Parameters *pParam);
+
+/* The home slot of a hash value: its top bits after a multiplication by the
+ 64-bit golden ratio constant (Fibonacci hashing), so that all the bits of the
+ hash value have an effect on the slot. */
+#define HOME_SLOT(pTable, hash) \
+  (((hash) * (tableindex_t) 0x9E3779B97F4A7C15ULL) >> (pTable)->shift)
+
+/* The distance of slot i from the home slot of the hash value in it. */
+#define PROBE_DIST(pTable, i, hash) \
+  (((i) - HOME_SLOT(pTable, hash)) & ((pTable)->size - 1))
+
+/* The key of a pair of frequent words in the word dependency table. The pair
+ is counted in both orders, so the smaller number is put first, and only one
+ of the two is stored. The numbers of the frequent words are assumed to fit in
+ 32 bits. The key is never 0, since the numbers begin from 1. */
+#define WORD_DEP_KEY(word1, word2) \
+  ((word1) < (word2) ? ((tableindex_t) (word1) << 32) | (word2) : \
+  ((tableindex_t) (word2) << 32) | (word1))
+#define WORD_DEP_WORD1(key) ((key) >> 32)
+#define WORD_DEP_WORD2(key) ((key) & 0xFFFFFFFFUL)
+
+/* Create an empty table with at least sizeHint slots. The table grows by
+ itself, so sizeHint only saves the first few resizes. */
+void init_hash_table(struct HashTable *pTable, tableindex_t sizeHint, 
         tableindex_t seed, struct Parameters *pParam)
 {
-  tableindex_t hash;
-  struct Elem *ptr, *pPrev;
+  tableindex_t size;
+  
+  size = HASHTABLE_MIN_SIZE;
+  while (size < sizeHint)
+  {
+    size <<= 1;
+  }
+  
+  pTable->pSlots = 0;
+  pTable->elemNum = 0;
+  pTable->seed = seed;
+  pTable->bFrozen = 0;
+  pTable->perfectHash.pPilots = 0;
+  pTable->perfectHash.pFilter = 0;
+  resize_hash_table(pTable, size, pParam);
+}
+
+/* Only the slots are freed. The elements belong to an arena. */
+void free_hash_table(struct HashTable *pTable)
+{
+  if (pTable->pSlots)
+  {
+    free((void *) pTable->pSlots);
+  }
+  pTable->pSlots = 0;
+  pTable->size = 0;
+  pTable->elemNum = 0;
+  pTable->bFrozen = 0;
+  free_perfect_hash(&pTable->perfectHash);
+}
+
+/* The callers remove elements from the table by setting pElem of their slots
+ to 0 while iterating over pSlots[] (e.g. the infrequent words). That leaves
+ holes in the probe sequences of the remaining elements, so the table is
+ rebuilt afterwards with this function, with a size that fits the remaining
+ elements. */
+void purge_hash_table(struct HashTable *pTable, struct Parameters *pParam)
+{
+  tableindex_t i, elemNum, size;
+  
+  elemNum = 0;
+  for (i = 0; i < pTable->size; i++)
+  {
+    if (pTable->pSlots[i].pElem)
+    {
+      elemNum++;
+    }
+  }
+  
+  size = HASHTABLE_MIN_SIZE;
+  while (elemNum * HASHTABLE_LOAD_DEN >= size * HASHTABLE_LOAD_NUM)
+  {
+    size <<= 1;
+  }
+  
+  resize_hash_table(pTable, size, pParam);
+}
+
+/* Order of the elements in freeze_hash_table(): by their support, in
+ descending order, and then by their hash values. */
+static int compare_slots_by_count(const void *p1, const void *p2)
+{
+  const struct HashSlot *pSlot1, *pSlot2;
+  
+  pSlot1 = (const struct HashSlot *) p1;
+  pSlot2 = (const struct HashSlot *) p2;
+  
+  if (pSlot1->pElem->count != pSlot2->pElem->count)
+  {
+    return pSlot1->pElem->count > pSlot2->pElem->count ? -1 : 1;
+  }
+  
+  if (pSlot1->hash != pSlot2->hash)
+  {
+    return pSlot1->hash < pSlot2->hash ? -1 : 1;
+  }
+  
+  return 0;
+}
+
+/* Rebuild the table for searching only, after its last element was added.
+ The new table has a load factor of at most FROZEN_LOAD_NUM / FROZEN_LOAD_DEN,
+ which shortens the probe sequences of both hits and misses. The elements are
+ inserted in the order of their support, so when they compete for a slot, the
+ frequent ones, which are also searched most often, stay closer to their home
+ slots. Afterwards nothing can be added to the table, and since a search has
+ no side effects, any number of threads can search it at the same time.
+ 
+ With bPerfectHash, the elements are placed with a minimal perfect hash
+ function instead (see perfect_hash.c), and every search looks at one slot
+ at most. This suits a table that is mostly searched for keys it does not
+ have, like the word table, since a Bloom filter rejects most of them. If no
+ perfect hash function is found, the table is rebuilt as above. */
+void freeze_hash_table(struct HashTable *pTable, char bPerfectHash,
+        struct Parameters *pParam)
+{
+  struct HashSlot *pPerfectSlots;
+  tableindex_t i, elemNum, size;
   
-  hash = str2hash(pKey, tablesize, seed);
+  /* The occupied slots are moved to the front of the old array and sorted
+   there, resize_hash_table() then inserts them in that order. */
+  elemNum = 0;
+  for (i = 0; i < pTable->size; i++)
+  {
+    if (pTable->pSlots[i].pElem)
+    {
+      pTable->pSlots[elemNum++] = pTable->pSlots[i];
+    }
+  }
   
-  if (ppTable[hash])
+  if (bPerfectHash)
   {
-    pPrev = 0;
-    ptr = ppTable[hash];
+    pPerfectSlots = build_perfect_hash(&pTable->perfectHash, pTable->pSlots,
+                       elemNum, pTable->seed, pParam);
+    if (pPerfectSlots)
+    {
+      free((void *) pTable->pSlots);
+      pTable->pSlots = pPerfectSlots;
+      pTable->size = elemNum;
+      pTable->elemNum = elemNum;
+      pTable->bFrozen = 1;
+      return;
+    }
+  }
+  
+  qsort(pTable->pSlots, elemNum, sizeof(struct HashSlot), 
+        compare_slots_by_count);
+  pTable->size = elemNum;
+  
+  size = HASHTABLE_MIN_SIZE;
+  while (elemNum * FROZEN_LOAD_DEN > size * FROZEN_LOAD_NUM)
+  {
+    size <<= 1;
+  }
+  
+  resize_hash_table(pTable, size, pParam);
+  pTable->bFrozen = 1;
+}
+
+/* Move all the elements into a new array of size slots. The home slots are
+ computed from the stored hash values, so the keys are not hashed again. */
+static void resize_hash_table(struct HashTable *pTable, tableindex_t size,
+        struct Parameters *pParam)
+{
+  struct HashSlot *pOldSlots;
+  tableindex_t oldSize, i;
+  int bits;
+  
+  pOldSlots = pTable->pSlots;
+  oldSize = pOldSlots ? pTable->size : 0;
+  
+  pTable->pSlots = (struct HashSlot *) calloc(size, sizeof(struct HashSlot));
+  if (!pTable->pSlots)
+  {
+    log_msg(MALLOC_ERR_6029, LOG_ERR, pParam);
+    exit(1);
+  }
+  
+  for (bits = 0; ((tableindex_t) 1 << bits) < size; bits++)
+    ;
+  
+  pTable->size = size;
+  pTable->shift = (int) (sizeof(tableindex_t) * 8) - bits;
+  pTable->elemNum = 0;
+  
+  for (i = 0; i < oldSize; i++)
+  {
+    if (pOldSlots[i].pElem)
+    {
+      insert_slot(pTable, pOldSlots[i].hash, pOldSlots[i].pElem);
+    }
+  }
+  
+  if (pOldSlots)
+  {
+    free((void *) pOldSlots);
+  }
+}
+
+/* Robin Hood insertion: walking from the home slot, the new element takes the
+ place of the first element that is closer to its own home slot than the new
+ one is, and that element continues the walk. This keeps the probe sequences
+ short and sorted by distance, so that a search can stop early. The key must
+ not be in the table yet. */
+static void insert_slot(struct HashTable *pTable, tableindex_t hash, 
+        struct Elem *pElem)
+{
+  tableindex_t i, dist, slotDist, mask, tmpHash;
+  struct Elem *pTmp;
+  
+  mask = pTable->size - 1;
+  i = HOME_SLOT(pTable, hash);
+  dist = 0;
+  
+  while (pTable->pSlots[i].pElem)
+  {
+    slotDist = PROBE_DIST(pTable, i, pTable->pSlots[i].hash);
+    
+    if (slotDist < dist)
+    {
+      tmpHash = pTable->pSlots[i].hash;
+      pTmp = pTable->pSlots[i].pElem;
+      pTable->pSlots[i].hash = hash;
+      pTable->pSlots[i].pElem = pElem;
+      hash = tmpHash;
+      pElem = pTmp;
+      dist = slotDist;
+    }
     
-    while (ptr)
+    i = (i + 1) & mask;
+    dist++;
+  }
+  
+  pTable->pSlots[i].hash = hash;
+  pTable->pSlots[i].pElem = pElem;
+  pTable->elemNum++;
+}
+
+/* Double the table before the load factor would exceed 
+ HASHTABLE_LOAD_NUM / HASHTABLE_LOAD_DEN. Every new element passes here, so
+ this is also where an element added to a frozen table is caught. */
+static void grow_hash_table_if_full(struct HashTable *pTable, 
+        struct Parameters *pParam)
+{
+  if (pTable->bFrozen)
+  {
+    log_msg("Can't add an element to a frozen hash table.", LOG_ERR, pParam);
+    exit(1);
+  }
+  
+  if ((pTable->elemNum + 1) * HASHTABLE_LOAD_DEN > 
+      pTable->size * HASHTABLE_LOAD_NUM)
+  {
+    resize_hash_table(pTable, pTable->size << 1, pParam);
+  }
+}
+
+/* The search stops at an empty slot, or at a slot whose element is closer to
+ its home slot than the key would be, since Robin Hood insertion would have
+ put the key there. */
+static struct Elem *find_word_slot(struct HashTable *pTable, tableindex_t hash,
+        char *pKey, int keyLen)
+{
+  tableindex_t i, dist, mask;
+  struct HashSlot *pSlot;
+  
+  if (pTable->perfectHash.pPilots)
+  {
+    i = find_perfect_slot(&pTable->perfectHash, hash, pTable->size);
+    if (i == pTable->size)
+    {
+      return 0;
+    }
+    
+    pSlot = &pTable->pSlots[i];
+    if (pSlot->hash == hash && pSlot->pElem->keyLen == keyLen &&
+        !memcmp(pSlot->pElem->pKey, pKey, keyLen))
+    {
+      return pSlot->pElem;
+    }
+    
+    return 0;
+  }
+  
+  mask = pTable->size - 1;
+  i = HOME_SLOT(pTable, hash);
+  
+  for (dist = 0; ; dist++)
+  {
+    pSlot = &pTable->pSlots[i];
+    
+    if (!pSlot->pElem || PROBE_DIST(pTable, i, pSlot->hash) < dist)
+    {
+      return 0;
+    }
+    
+    if (pSlot->hash == hash && pSlot->pElem->keyLen == keyLen &&
+        !memcmp(pSlot->pElem->pKey, pKey, keyLen))
+    {
+      return pSlot->pElem;
+    }
+    
+    i = (i + 1) & mask;
+  }
+}
+
+/* Works like find_word_slot(), but for the cluster keys of add_cluster_elem().
+ */
+static struct Elem *find_cluster_slot(struct HashTable *pTable, 
+        tableindex_t hash, wordnumber_t *pKey, size_t keySize)
+{
+  tableindex_t i, dist, mask;
+  struct HashSlot *pSlot;
+  
+  if (pTable->perfectHash.pPilots)
+  {
+    i = find_perfect_slot(&pTable->perfectHash, hash, pTable->size);
+    if (i == pTable->size)
     {
-      if (!strcmp(pKey, ptr->pKey))
-      {
-        break;
-      }
-      pPrev = ptr;
-      ptr = ptr->pNext;
+      return 0;
     }
     
-    if (ptr)
-    {
-      ptr->count++;
-      
-      if (pPrev)
-      {
-        pPrev->pNext = ptr->pNext;
-        ptr->pNext = ppTable[hash];
-        ppTable[hash] = ptr;
-      }
-      
-    }
-    else
-    {
-      ptr = (struct Elem *) malloc(sizeof(struct Elem));
-      if (!ptr)
-      {
-        log_msg(MALLOC_ERR_6007, LOG_ERR, pParam);
-        exit(1);
-      }
-      
-      ptr->pKey = (char *) malloc(strlen(pKey) + 1);
-      if (!ptr->pKey)
-      {
-        log_msg(MALLOC_ERR_6007, LOG_ERR, pParam);
-        exit(1);
-      }
-      
-      strcpy(ptr->pKey, pKey);
-      ptr->count = 1;
-      ptr->pNext = ppTable[hash];
-      
-      ppTable[hash] = ptr;
-      
-    }
-  }
-  else
-  {
-    ptr = (struct Elem *) malloc(sizeof(struct Elem));
-    if (!ptr)
-    {
-      log_msg(MALLOC_ERR_6007, LOG_ERR, pParam);
-      exit(1);
+    pSlot = &pTable->pSlots[i];
+    if (pSlot->hash == hash && !memcmp(pSlot->pElem->pKey, pKey, keySize))
+    {
+      return pSlot->pElem;
     }
     
-    ptr->pKey = (char *) malloc(strlen(pKey) + 1);
-    if (!ptr->pKey)
+    return 0;
+  }
+  
+  mask = pTable->size - 1;
+  i = HOME_SLOT(pTable, hash);
+  
+  for (dist = 0; ; dist++)
+  {
+    pSlot = &pTable->pSlots[i];
+    
+    if (!pSlot->pElem || PROBE_DIST(pTable, i, pSlot->hash) < dist)
     {
-      log_msg(MALLOC_ERR_6007, LOG_ERR, pParam);
-      exit(1);
+      return 0;
     }
     
-    strcpy(ptr->pKey, pKey);
-    ptr->count = 1;
-    ptr->pNext = 0;
+    if (pSlot->hash == hash && !memcmp(pSlot->pElem->pKey, pKey, keySize))
+    {
+      return pSlot->pElem;
+    }
     
-    ppTable[hash] = ptr;
+    i = (i + 1) & mask;
+  }
+}
+
+/* pKey is terminated with 0, e.g. a word made by '--wsearch' and '--wreplace'
+ options. The same holds for find_elem(). */
+struct Elem *add_elem(char *pKey, struct HashTable *pTable, 
+        struct Parameters *pParam)
+{
+  int keyLen;
+  
+  keyLen = (int) strlen(pKey);
+  
+  return add_elem_with_hash(pKey, keyLen, str2hash(pKey, keyLen, pTable->seed),
+                pTable, pParam);
+}
+
+/* Since nothing is moved in a search, the table can be searched by several
+ threads at the same time, as long as nobody adds to it (e.g. after it was
+ frozen with freeze_hash_table()). */
+struct Elem *find_elem(char *key, struct HashTable *pTable)
+{
+  int keyLen;
+  
+  keyLen = (int) strlen(key);
+  
+  return find_word_slot(pTable, str2hash(key, keyLen, pTable->seed), key,
+              keyLen);
+}
+
+/* The key is given with its length (e.g. a word span of a log line), and does
+ not need to be terminated with 0. hash is the str2hash() value of the key with
+ the seed of the table, which the caller usually has computed already (see
+ struct WordSpan). The stored key is a 0-terminated copy. New elements and
+ their keys are allocated from pParam->wordArena, since this function is only
+ used for word tables. */
+struct Elem *add_elem_with_hash(char *pKey, int keyLen, tableindex_t hash,
+        struct HashTable *pTable, struct Parameters *pParam)
+{
+  struct Elem *ptr;
+  
+  ptr = find_word_slot(pTable, hash, pKey, keyLen);
+  
+  if (ptr)
+  {
+    ptr->count++;
+    return ptr;
+  }
+  
+  ptr = (struct Elem *) arena_alloc(&pParam->wordArena, sizeof(struct Elem),
+                    pParam);
+  ptr->pKey = arena_strndup(&pParam->wordArena, pKey, keyLen, pParam);
+  ptr->keyLen = keyLen;
+  ptr->count = 1;
+  ptr->hash = hash;
+  
+  grow_hash_table_if_full(pTable, pParam);
+  insert_slot(pTable, hash, ptr);
+  
+  return ptr;
+}
+
+struct Elem *find_elem_with_hash(char *key, int keyLen, tableindex_t hash,
+        struct HashTable *pTable)
+{
+  return find_word_slot(pTable, hash, key, keyLen);
+}
+
+/* Merge the element pSrc, which was taken from another table with the same
+ seed (e.g. the local table of a worker thread), into pTable. If the key is not
+ in pTable yet, pSrc itself is put into pTable and returned. Otherwise the
+ count of pSrc is added to the existing element, which is returned. */
+struct Elem *merge_elem(struct Elem *pSrc, struct HashTable *pTable, 
+        struct Parameters *pParam)
+{
+  struct Elem *ptr;
+  
+  ptr = find_word_slot(pTable, pSrc->hash, pSrc->pKey, pSrc->keyLen);
+  
+  if (ptr)
+  {
+    ptr->count += pSrc->count;
+    return ptr;
   }
   
+  grow_hash_table_if_full(pTable, pParam);
+  insert_slot(pTable, pSrc->hash, pSrc);
+  
+  return pSrc;
+}
+
+/* A cluster key is an array of wordnumber_t: pKey[0] is the number of
+ constants of the cluster, and pKey[1] ... pKey[pKey[0]] are the IDs of its
+ frequent words, in their order in the line. Unlike strings, the keys are
+ compared with memcmp(), and hashed with clusterkey2hash() and the seed of the
+ table, which the caller gives in hash, since it was needed for the cluster
+ sketch already. The stored key is a copy of the pKey[0] + 1 numbers. New
+ elements are allocated from pParam->clusterArena. */
+struct Elem *add_cluster_elem(wordnumber_t *pKey, tableindex_t hash, 
+        struct HashTable *pTable, struct Parameters *pParam)
+{
+  struct Elem *ptr;
+  size_t keySize;
+  
+  keySize = (pKey[0] + 1) * sizeof(wordnumber_t);
+  ptr = find_cluster_slot(pTable, hash, pKey, keySize);
+  
+  if (ptr)
+  {
+    ptr->count++;
+    return ptr;
+  }
+  
+  ptr = (struct Elem *) arena_alloc(&pParam->clusterArena, sizeof(struct Elem),
+                    pParam);
+  ptr->pKey = (char *) arena_alloc(&pParam->clusterArena, keySize, pParam);
+  memcpy(ptr->pKey, pKey, keySize);
+  ptr->keyLen = (int) keySize;
+  ptr->count = 1;
+  ptr->hash = hash;
+  
+  grow_hash_table_if_full(pTable, pParam);
+  insert_slot(pTable, hash, ptr);
+  
   return ptr;
 }
 
-struct Elem *find_elem(char *key, struct Elem **table, tableindex_t tablesize,
-             tableindex_t seed)
+/* Works like find_elem(), but for the cluster keys of add_cluster_elem(). */
+struct Elem *find_cluster_elem(wordnumber_t *pKey, struct HashTable *pTable)
 {
-  tableindex_t hash;
-  struct Elem *ptr, *pPrev;
+  return find_cluster_slot(pTable, clusterkey2hash(pKey, pTable->seed), pKey,
+               (pKey[0] + 1) * sizeof(wordnumber_t));
+}
+
+/* Works like merge_elem(), but for the cluster keys of add_cluster_elem(). */
+struct Elem *merge_cluster_elem(struct Elem *pSrc, struct HashTable *pTable,
+        struct Parameters *pParam)
+{
+  struct Elem *ptr;
+  wordnumber_t *pKey;
   
-  pPrev = 0;
-  hash = str2hash(key, tablesize, seed);
+  pKey = (wordnumber_t *) pSrc->pKey;
+  ptr = find_cluster_slot(pTable, pSrc->hash, pKey, 
+              (pKey[0] + 1) * sizeof(wordnumber_t));
   
-  for (ptr = table[hash]; ptr; ptr = ptr->pNext)
+  if (ptr)
   {
-    if (!strcmp(key, ptr->pKey))
+    ptr->count += pSrc->count;
+    return ptr;
+  }
+  
+  grow_hash_table_if_full(pTable, pParam);
+  insert_slot(pTable, pSrc->hash, pSrc);
+  
+  return pSrc;
+}
+
+/* Create an empty word dependency table with at least sizeHint slots. Like
+ the hash tables above, it grows by itself. */
+void init_word_dep_table(struct WordDepTable *pTable, tableindex_t sizeHint,
+        struct Parameters *pParam)
+{
+  tableindex_t size;
+  
+  size = HASHTABLE_MIN_SIZE;
+  while (size < sizeHint)
+  {
+    size <<= 1;
+  }
+  
+  pTable->pSlots = 0;
+  pTable->elemNum = 0;
+  resize_word_dep_table(pTable, size, pParam);
+}
+
+void free_word_dep_table(struct WordDepTable *pTable)
+{
+  if (pTable->pSlots)
+  {
+    free((void *) pTable->pSlots);
+  }
+  pTable->pSlots = 0;
+  pTable->size = 0;
+  pTable->elemNum = 0;
+}
+
+static void resize_word_dep_table(struct WordDepTable *pTable, 
+        tableindex_t size, struct Parameters *pParam)
+{
+  struct WordDepSlot *pOldSlots;
+  tableindex_t oldSize, i, j, mask;
+  int bits;
+  
+  pOldSlots = pTable->pSlots;
+  oldSize = pOldSlots ? pTable->size : 0;
+  
+  pTable->pSlots = (struct WordDepSlot *) calloc(size, 
+                           sizeof(struct WordDepSlot));
+  if (!pTable->pSlots)
+  {
+    log_msg(MALLOC_ERR_6031, LOG_ERR, pParam);
+    exit(1);
+  }
+  
+  for (bits = 0; ((tableindex_t) 1 << bits) < size; bits++)
+    ;
+  
+  pTable->size = size;
+  pTable->shift = (int) (sizeof(tableindex_t) * 8) - bits;
+  mask = size - 1;
+  
+  for (i = 0; i < oldSize; i++)
+  {
+    if (!pOldSlots[i].key)
     {
-      break;
+      continue;
     }
-    pPrev = ptr;
+    
+    j = HOME_SLOT(pTable, pOldSlots[i].key);
+    while (pTable->pSlots[j].key)
+    {
+      j = (j + 1) & mask;
+    }
+    pTable->pSlots[j] = pOldSlots[i];
   }
   
-  /* After success finding, Move-To-Front */
-  if (ptr && pPrev)
+  if (pOldSlots)
   {
-    pPrev->pNext = ptr->pNext;
-    ptr->pNext = table[hash];
-    table[hash] = ptr;
+    free((void *) pOldSlots);
   }
+}
+
+/* Add count to the number of lines in which the frequent words word1 and
+ word2 occur together (or word1 occurs, if word1 == word2). */
+void add_word_dep(wordnumber_t word1, wordnumber_t word2, support_t count,
+        struct WordDepTable *pTable, struct Parameters *pParam)
+{
+  tableindex_t key, i, mask;
   
-  return ptr;
+  key = WORD_DEP_KEY(word1, word2);
+  mask = pTable->size - 1;
+  
+  for (i = HOME_SLOT(pTable, key); pTable->pSlots[i].key; i = (i + 1) & mask)
+  {
+    if (pTable->pSlots[i].key == key)
+    {
+      pTable->pSlots[i].count += count;
+      return;
+    }
+  }
+  
+  if ((pTable->elemNum + 1) * HASHTABLE_LOAD_DEN > 
+      pTable->size * HASHTABLE_LOAD_NUM)
+  {
+    resize_word_dep_table(pTable, pTable->size << 1, pParam);
+    mask = pTable->size - 1;
+    
+    for (i = HOME_SLOT(pTable, key); pTable->pSlots[i].key; 
+       i = (i + 1) & mask)
+      ;
+  }
+  
+  pTable->pSlots[i].key = key;
+  pTable->pSlots[i].count = count;
+  pTable->elemNum++;
+}
+
+/* Return the number of lines in which word1 and word2 occur together, which
+ is 0 if they were never counted. */
+support_t find_word_dep(wordnumber_t word1, wordnumber_t word2, 
+        struct WordDepTable *pTable)
+{
+  tableindex_t key, i, mask;
+  
+  key = WORD_DEP_KEY(word1, word2);
+  mask = pTable->size - 1;
+  
+  for (i = HOME_SLOT(pTable, key); pTable->pSlots[i].key; i = (i + 1) & mask)
+  {
+    if (pTable->pSlots[i].key == key)
+    {
+      return pTable->pSlots[i].count;
+    }
+  }
+  
+  return 0;
+}
+
+/* Add the counts of pSrc (e.g. the local table of a worker thread) to
+ pTable. */
+void merge_word_dep_table(struct WordDepTable *pSrc, 
+        struct WordDepTable *pTable, struct Parameters *pParam)
+{
+  tableindex_t i;
+  
+  for (i = 0; i < pSrc->size; i++)
+  {
+    if (pSrc->pSlots[i].key)
+    {
+      add_word_dep(WORD_DEP_WORD1(pSrc->pSlots[i].key), 
+             WORD_DEP_WORD2(pSrc->pSlots[i].key), 
+             pSrc->pSlots[i].count, pTable, pParam);
+    }
+  }
 }
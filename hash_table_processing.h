@@ -30,10 +30,35 @@
 extern "C" {
 #endif
 
-struct Elem *add_elem(char *pKey, struct Elem **ppTable, tableindex_t tablesize, 
+void init_hash_table(struct HashTable *pTable, tableindex_t sizeHint, 
         tableindex_t seed, struct Parameters *pParam);
-struct Elem *find_elem(char *key, struct Elem **table, tableindex_t tablesize,
-             tableindex_t seed);
+void free_hash_table(struct HashTable *pTable);
+void purge_hash_table(struct HashTable *pTable, struct Parameters *pParam);
+void freeze_hash_table(struct HashTable *pTable, char bPerfectHash,
+        struct Parameters *pParam);
+struct Elem *add_elem(char *pKey, struct HashTable *pTable, 
+        struct Parameters *pParam);
+struct Elem *find_elem(char *key, struct HashTable *pTable);
+struct Elem *add_elem_with_hash(char *pKey, int keyLen, tableindex_t hash,
+        struct HashTable *pTable, struct Parameters *pParam);
+struct Elem *find_elem_with_hash(char *key, int keyLen, tableindex_t hash,
+        struct HashTable *pTable);
+struct Elem *merge_elem(struct Elem *pSrc, struct HashTable *pTable, 
+        struct Parameters *pParam);
+struct Elem *add_cluster_elem(wordnumber_t *pKey, tableindex_t hash, 
+        struct HashTable *pTable, struct Parameters *pParam);
+struct Elem *find_cluster_elem(wordnumber_t *pKey, struct HashTable *pTable);
+struct Elem *merge_cluster_elem(struct Elem *pSrc, struct HashTable *pTable,
+        struct Parameters *pParam);
+void init_word_dep_table(struct WordDepTable *pTable, tableindex_t sizeHint,
+        struct Parameters *pParam);
+void free_word_dep_table(struct WordDepTable *pTable);
+void add_word_dep(wordnumber_t word1, wordnumber_t word2, support_t count,
+        struct WordDepTable *pTable, struct Parameters *pParam);
+support_t find_word_dep(wordnumber_t word1, wordnumber_t word2, 
+        struct WordDepTable *pTable);
+void merge_word_dep_table(struct WordDepTable *pSrc, 
+        struct WordDepTable *pTable, struct Parameters *pParam);
 
 #ifdef __cplusplus
 }
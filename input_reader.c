@@ -0,0 +1,379 @@
+/*
+ * Copyright (C) 2016 Zhuge Chen, Risto Vaarandi and Mauno Pihelgas
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/* 
+ * File:   input_reader.c
+ * 
+ * Content: Functions related to reading the lines of the input files. Every
+ * pass over the data set reads the lines of a region (a chain of input file
+ * chunks) through read_region_line().
+ *
+ * Created on October 16, 2026, 2:51 PM
+ */
+
+/* For posix_madvise(). */
+#define _POSIX_C_SOURCE 200112L
+
+#include "common_header.h"
+#include "input_reader.h"
+
+#include <string.h>    /* for memchr() and memmove() */
+#include <fcntl.h>     /* for open() */
+#include <unistd.h>    /* for read() and close() */
+#include <sys/mman.h>  /* for mmap() and munmap() */
+#include <sys/stat.h>  /* for fstat() */
+
+#include "output.h"
+
+static int open_chunk(struct RegionReader *pReader, struct Parameters *pParam);
+static void close_chunk(struct RegionReader *pReader);
+static void fill_input_buffer(struct RegionReader *pReader);
+static void skip_to_chunk_start(struct RegionReader *pReader);
+
+/* Create a region which consists of all the input files, for the passes over
+ the data set that are done without worker threads. */
+struct InputChunk *create_whole_input_region(struct Parameters *pParam)
+{
+  struct InputChunk *pRegion;
+  struct InputFile *pFilePtr;
+  
+  pRegion = 0;
+  
+  for (pFilePtr = pParam->pInputFiles; pFilePtr; pFilePtr = pFilePtr->pNext)
+  {
+    add_chunk_to_region(&pRegion, pFilePtr, 0, -1, pParam);
+  }
+  
+  return pRegion;
+}
+
+/* Append the chunk [start, end) of the input file pFile to the end of the
+ region *ppRegion. */
+void add_chunk_to_region(struct InputChunk **ppRegion, struct InputFile *pFile,
+        long start, long end, struct Parameters *pParam)
+{
+  struct InputChunk *ptr, *pChunk;
+  
+  pChunk = (struct InputChunk *) malloc(sizeof(struct InputChunk));
+  if (!pChunk)
+  {
+    log_msg(MALLOC_ERR_6023, LOG_ERR, pParam);
+    exit(1);
+  }
+  
+  pChunk->pFile = pFile;
+  pChunk->start = start;
+  pChunk->end = end;
+  pChunk->pNext = 0;
+  
+  if (!*ppRegion)
+  {
+    *ppRegion = pChunk;
+  }
+  else
+  {
+    for (ptr = *ppRegion; ptr->pNext; ptr = ptr->pNext);
+    ptr->pNext = pChunk;
+  }
+}
+
+void free_region(struct InputChunk *pRegion)
+{
+  struct InputChunk *pNext;
+  
+  while (pRegion)
+  {
+    pNext = pRegion->pNext;
+    free((void *) pRegion);
+    pRegion = pNext;
+  }
+}
+
+void open_region(struct RegionReader *pReader, struct InputChunk *pRegion)
+{
+  pReader->pChunk = pRegion;
+  pReader->pData = 0;
+  pReader->base = 0;
+  pReader->size = 0;
+  pReader->pos = 0;
+  pReader->fd = -1;
+  pReader->bMapped = 0;
+  pReader->bOpened = 0;
+  pReader->bAtLineStart = 1;
+}
+
+/* Find the next line of a region. *ppLine is set to point to the line in the
+ mapped input file (or in the buffer of the file), and *pLineLen to its length
+ without the newline. The line is not copied and not terminated with 0, it
+ must not be modified, and it is only valid until the next call.
+ 
+ Lines are cut exactly as fgets(line, MAXLINELEN, ...) would do, so a line
+ longer than MAXLINELEN - 1 bytes is returned in pieces, and every piece is
+ handled as a line by the passes over the data set.
+ 
+ Returns 0 when the region is finished. */
+int read_region_line(struct RegionReader *pReader, char **ppLine,
+        int *pLineLen, struct Parameters *pParam)
+{
+  long end, limit;
+  char *pLine, *pNewline;
+  
+  while (pReader->pChunk)
+  {
+    if (!pReader->bOpened && !open_chunk(pReader, pParam))
+    {
+      pReader->pChunk = pReader->pChunk->pNext;
+      continue;
+    }
+  
+    /* A file that is not mapped keeps a whole line in its buffer, if the
+     file has it. */
+    if (pReader->fd != -1 && pReader->size - pReader->pos < MAXLINELEN - 1)
+    {
+      fill_input_buffer(pReader);
+    }
+  
+    end = pReader->size;
+    if (pReader->pChunk->end >= 0 && 
+      pReader->pChunk->end - pReader->base < end)
+    {
+      end = pReader->pChunk->end - pReader->base;
+    }
+  
+    /* A line whose first byte is beyond the chunk belongs to the next
+     chunk. */
+    if (pReader->pos >= pReader->size ||
+      (pReader->bAtLineStart && pReader->pos >= end))
+    {
+      close_chunk(pReader);
+      pReader->pChunk = pReader->pChunk->pNext;
+      continue;
+    }
+  
+    pLine = pReader->pData + pReader->pos;
+    limit = pReader->size - pReader->pos;
+    if (limit > MAXLINELEN - 1)
+    {
+      limit = MAXLINELEN - 1;
+    }
+  
+    pNewline = (char *) memchr(pLine, '\n', limit);
+  
+    if (pNewline)
+    {
+      *pLineLen = (int) (pNewline - pLine);
+      pReader->pos += *pLineLen + 1;
+      pReader->bAtLineStart = 1;
+    }
+    else
+    {
+      *pLineLen = (int) limit;
+      pReader->pos += limit;
+      pReader->bAtLineStart = 0;
+    }
+  
+    *ppLine = pLine;
+  
+    return 1;
+  }
+  
+  return 0;
+}
+
+/* Map the file of the current chunk into memory and move to the first line
+ that begins inside the chunk. A file that can't be mapped is read through a
+ buffer of INPUT_BUFFER_SIZE bytes instead, so that a pipe uses as little
+ memory as a file does. */
+static int open_chunk(struct RegionReader *pReader, struct Parameters *pParam)
+{
+  struct InputChunk *pChunk;
+  struct stat fileStat;
+  char logStr[MAXLOGMSGLEN];
+  char *pNewline;
+  int fd;
+  
+  pChunk = pReader->pChunk;
+  
+  if ((fd = open(pChunk->pFile->pName, O_RDONLY)) == -1)
+  {
+    sprintf(logStr, "Can't open input file %s", pChunk->pFile->pName);
+    log_msg(logStr, LOG_ERR, pParam);
+    return 0;
+  }
+  
+  pReader->pData = 0;
+  pReader->base = 0;
+  pReader->size = 0;
+  pReader->pos = 0;
+  pReader->fd = -1;
+  pReader->bMapped = 0;
+  pReader->bAtLineStart = 1;
+  pReader->bOpened = 1;
+  
+  if (!fstat(fd, &fileStat) && S_ISREG(fileStat.st_mode) &&
+    fileStat.st_size > 0)
+  {
+    pReader->pData = (char *) mmap(0, fileStat.st_size, PROT_READ,
+                     MAP_PRIVATE, fd, 0);
+    if (pReader->pData == MAP_FAILED)
+    {
+      pReader->pData = 0;
+    }
+    else
+    {
+      pReader->size = (long) fileStat.st_size;
+      pReader->bMapped = 1;
+      posix_madvise(pReader->pData, pReader->size, POSIX_MADV_SEQUENTIAL);
+    }
+  }
+  
+  /* Pipes, devices etc. can't be mapped. They are read through a buffer,
+   and fd stays open until the end of the file. */
+  if (!pReader->bMapped)
+  {
+    pReader->pData = (char *) malloc(INPUT_BUFFER_SIZE);
+    if (!pReader->pData)
+    {
+      log_msg(MALLOC_ERR_6024, LOG_ERR, pParam);
+      exit(1);
+    }
+    
+    pReader->fd = fd;
+    fill_input_buffer(pReader);
+    
+    if (pChunk->start > 0)
+    {
+      skip_to_chunk_start(pReader);
+    }
+    
+    return 1;
+  }
+  
+  close(fd);
+  
+  if (pChunk->start > 0 && pChunk->start < pReader->size)
+  {
+    /* The line that is cut by the beginning of the chunk belongs to the
+     previous chunk. */
+    pReader->pos = pChunk->start;
+    if (pReader->pData[pChunk->start - 1] != '\n')
+    {
+      pNewline = (char *) memchr(pReader->pData + pChunk->start, '\n',
+                     pReader->size - pChunk->start);
+      pReader->pos = pNewline ? pNewline - pReader->pData + 1 :
+                     pReader->size;
+    }
+  }
+  else if (pChunk->start > 0)
+  {
+    pReader->pos = pReader->size;
+  }
+  
+  return 1;
+}
+
+
+static void close_chunk(struct RegionReader *pReader)
+{
+  if (pReader->bMapped)
+  {
+    munmap(pReader->pData, pReader->size);
+  }
+  else if (pReader->pData)
+  {
+    free((void *) pReader->pData);
+  }
+  
+  if (pReader->fd != -1)
+  {
+    close(pReader->fd);
+  }
+  
+  pReader->pData = 0;
+  pReader->base = 0;
+  pReader->size = 0;
+  pReader->pos = 0;
+  pReader->fd = -1;
+  pReader->bMapped = 0;
+  pReader->bOpened = 0;
+}
+
+/* Move the bytes from pos on to the beginning of the buffer of a file that is
+ not mapped, and read from the file until the buffer is full. */
+static void fill_input_buffer(struct RegionReader *pReader)
+{
+  ssize_t len;
+  
+  pReader->size -= pReader->pos;
+  memmove(pReader->pData, pReader->pData + pReader->pos, pReader->size);
+  pReader->base += pReader->pos;
+  pReader->pos = 0;
+  
+  while (pReader->fd != -1 && pReader->size < INPUT_BUFFER_SIZE)
+  {
+    len = read(pReader->fd, pReader->pData + pReader->size, 
+          INPUT_BUFFER_SIZE - pReader->size);
+    if (len <= 0)
+    {
+      close(pReader->fd);
+      pReader->fd = -1;
+      break;
+    }
+    
+    pReader->size += len;
+  }
+}
+
+/* Works like the part of open_chunk() that moves to the first line of the
+ chunk, for a file that is not mapped. The bytes before the chunk are read and
+ dropped. */
+static void skip_to_chunk_start(struct RegionReader *pReader)
+{
+  char *pNewline;
+  long last;
+  
+  /* The offset of the byte before the chunk. The line that is cut by the
+   beginning of the chunk belongs to the previous chunk. */
+  last = pReader->pChunk->start - 1;
+  
+  while (pReader->pos < pReader->size)
+  {
+    if (pReader->base + pReader->size <= last)
+    {
+      pReader->pos = pReader->size;
+    }
+    else
+    {
+      if (pReader->base + pReader->pos < last)
+      {
+        pReader->pos = last - pReader->base;
+      }
+      
+      pNewline = (char *) memchr(pReader->pData + pReader->pos, '\n',
+                     pReader->size - pReader->pos);
+      if (pNewline)
+      {
+        pReader->pos = pNewline - pReader->pData + 1;
+        return;
+      }
+      
+      pReader->pos = pReader->size;
+    }
+    
+    fill_input_buffer(pReader);
+  }
+}
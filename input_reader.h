@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2016 Zhuge Chen, Risto Vaarandi and Mauno Pihelgas
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/* 
+ * File:   input_reader.h
+ * 
+ * Content: Declarations of global functions in input_reader.c .
+ *
+ * Created on October 16, 2026, 2:52 PM
+ */
+
+#ifndef INPUT_READER_H
+#define INPUT_READER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct InputChunk *create_whole_input_region(struct Parameters *pParam);
+void add_chunk_to_region(struct InputChunk **ppRegion, struct InputFile *pFile,
+        long start, long end, struct Parameters *pParam);
+void free_region(struct InputChunk *pRegion);
+void open_region(struct RegionReader *pReader, struct InputChunk *pRegion);
+int read_region_line(struct RegionReader *pReader, char **ppLine,
+        int *pLineLen, struct Parameters *pParam);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INPUT_READER_H */
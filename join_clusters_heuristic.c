@@ -32,6 +32,11 @@
 #include "hash_table_processing.h"
 #include "utility.h"
 #include "line_processing.h"
+#include "arena.h"
+#include "word_filter_search_replace.h"
+#include "parallel_processing.h"
+#include "input_reader.h"
+#include "token_cache.h"
 
 static void set_token(struct Parameters *pParam);
 static void join_cluster(struct Parameters *pParam);
@@ -47,6 +52,17 @@ static double cal_word_dep(struct Elem *word1, struct Elem *word2,
           struct Parameters *pParam);
 static double cal_word_dep_number_version(wordnumber_t word1num, 
         wordnumber_t word2num, struct Parameters *pParam);
+static wordnumber_t get_word_dep_index(wordnumber_t number, 
+        struct Parameters *pParam);
+static void index_cluster_words(struct Parameters *pParam);
+static int store_word_dep_index(wordnumber_t number, int distinctWords,
+        struct Parameters *pParam);
+static void find_word_deps_in_region(struct InputChunk *pRegion, 
+        struct Parameters *pParam);
+static void find_word_deps_from_cache(long start, long end, 
+        struct Parameters *pParam);
+static void find_word_deps_in_parallel(struct Parameters *pParam);
+static void find_word_deps_worker(struct WorkerContext *pWorker);
 static void get_unique_frequent_words_out_of_cluster(struct Cluster *pCluster,
                         struct Parameters *pParam);
 static void join_cluster_with_token(struct Cluster *pCluster,
@@ -58,23 +74,274 @@ static void adjust_cluster_with_token_instance(struct Cluster *pCluster,
 static int check_if_token_key_is_exist(struct ClusterWithToken *ptr, int serial,
                 struct Elem *pElem);
 
-void update_word_dep_matrix(wordnumber_t *storage, int serial,
+/* Count the lines in which the frequent words of storage[1..serial] (which
+ are distinct) occur together. Every pair is counted once, with the smaller
+ word number first, see add_word_dep(). With '--threads', every worker thread
+ counts into its own table, and the tables are merged afterwards. */
+void update_word_dep_table(wordnumber_t *storage, int serial,
               struct Parameters *pParam)
 {
   int i, j;
-  //unsigned long long coor;
   
   for (i = 1; i <= serial; i++)
   {
-    for (j = 1; j <= serial; j++)
+    for (j = i; j <= serial; j++)
     {
-      //coor = storage[i] * pParam->wordDepMatrixBreadth + storage[j];
-      pParam->wordDepMatrix[storage[i] * pParam->wordDepMatrixBreadth +
-                  storage[j]]++;
+      add_word_dep(storage[i], storage[j], 1, &pParam->wordDepTable, pParam);
     }
   }
 }
 
+/* The pass of '--wdeppass' option. The constants of the clusters found in
+ step 3 get the indices 1...wordDepWordNum (see index_cluster_words()), and
+ the word dependencies are counted only between these words, with their
+ indices instead of their frequent word numbers. The join heuristic only asks
+ for the dependencies between the constants of a cluster, so it gets the
+ same answers as from the table of all frequent words. */
+void step_3_find_word_deps(struct Parameters *pParam)
+{
+  struct InputChunk *pRegion;
+  char logStr[MAXLOGMSGLEN];
+  char digit[MAXDIGITBIT];
+  
+  log_msg("Finding word dependencies...", LOG_NOTICE, pParam);
+  
+  index_cluster_words(pParam);
+  init_word_dep_table(&pParam->wordDepTable, DEF_WORD_DEP_TABLE_SIZE, pParam);
+  
+  str_format_int_grouped(digit, pParam->wordDepWordNum);
+  sprintf(logStr, "%s frequent words are constants of the clusters.", digit);
+  log_msg(logStr, LOG_INFO, pParam);
+  
+  if (!pParam->wordDepWordNum)
+  {
+    return;
+  }
+  
+  if (pParam->threadNum > 1)
+  {
+    find_word_deps_in_parallel(pParam);
+  }
+  else if (pParam->bTokenCacheReady)
+  {
+    find_word_deps_from_cache(0, pParam->cacheSize, pParam);
+  }
+  else
+  {
+    pRegion = create_whole_input_region(pParam);
+    find_word_deps_in_region(pRegion, pParam);
+    free_region(pRegion);
+  }
+  
+  str_format_int_grouped(digit, pParam->wordDepTable.elemNum);
+  sprintf(logStr, "%s pairs of words were counted.", digit);
+  log_msg(logStr, LOG_INFO, pParam);
+}
+
+/* Give every frequent word that is a constant of a cluster an index in the
+ word dependency table, see pParam->pWordDepIndex. */
+static void index_cluster_words(struct Parameters *pParam)
+{
+  struct CandidateGroup *pGroup;
+  struct Elem **ppWords;
+  wordnumber_t number, j;
+  int i, k;
+  
+  pParam->pWordDepIndex = (wordnumber_t *) calloc(pParam->freWordNum + 1,
+                          sizeof(wordnumber_t));
+  if (!pParam->pWordDepIndex)
+  {
+    log_msg(MALLOC_ERR_6032, LOG_ERR, pParam);
+    exit(1);
+  }
+  
+  pParam->wordDepWordNum = 0;
+  
+  for (i = 1; i <= pParam->biggestConstants; i++)
+  {
+    pGroup = &pParam->pCandidateGroups[i];
+    for (j = 0; j < pGroup->num; j++)
+    {
+      ppWords = CANDIDATE_WORDS(pGroup, j);
+      for (k = 1; k <= i; k++)
+      {
+        number = ppWords[k]->number;
+        if (!pParam->pWordDepIndex[number])
+        {
+          pParam->pWordDepIndex[number] = ++pParam->wordDepWordNum;
+        }
+      }
+    }
+  }
+}
+
+/* The index of a frequent word in the word dependency table. */
+static wordnumber_t get_word_dep_index(wordnumber_t number, 
+        struct Parameters *pParam)
+{
+  if (pParam->pWordDepIndex)
+  {
+    return pParam->pWordDepIndex[number];
+  }
+  
+  return number;
+}
+
+/* Put the index of a frequent word of a line into pParam->wordNumStr[],
+ unless the word is not a constant of any cluster, or is already there.
+ Returns the new number of the indices in pParam->wordNumStr[]. */
+static int store_word_dep_index(wordnumber_t number, int distinctWords,
+        struct Parameters *pParam)
+{
+  wordnumber_t index;
+  
+  index = pParam->pWordDepIndex[number];
+  if (!index)
+  {
+    return distinctWords;
+  }
+  
+  distinctWords++;
+  if (is_word_repeated(pParam->wordNumStr, index, distinctWords))
+  {
+    return distinctWords - 1;
+  }
+  
+  pParam->wordNumStr[distinctWords] = index;
+  
+  return distinctWords;
+}
+
+/* Count the word dependencies of the lines of a region. The frequent words of
+ a line are found like in create_cluster_candidates_word_dep() and
+ create_cluster_candidates_word_dep_with_filter(). */
+static void find_word_deps_in_region(struct InputChunk *pRegion, 
+        struct Parameters *pParam)
+{
+  struct RegionReader reader;
+  struct LineTokens tokens;
+  struct Elem *pWord;
+  char *line, *pWordStr;
+  int linelen, wordcount, wordLen, distinctWords, i;
+  
+  init_line_tokens(&tokens);
+  open_region(&reader, pRegion);
+  
+  while (read_region_line(&reader, &line, &linelen, pParam))
+  {
+    wordcount = find_word_spans(line, linelen, &tokens, pParam);
+    distinctWords = 0;
+    
+    for (i = 0; i < wordcount; i++)
+    {
+      pWordStr = tokens.pText + tokens.words[i].offset;
+      wordLen = tokens.words[i].len;
+      
+      if (wordLen == 0)
+      {
+        continue;
+      }
+      
+      pWord = find_elem_with_hash(pWordStr, wordLen, tokens.words[i].hash,
+                    &pParam->wordTable);
+      
+      if (!pWord && pParam->pWordFilter &&
+        is_word_filtered_with_len(pWordStr, wordLen, pParam))
+      {
+        pWord = find_elem(word_search_replace_with_len(pWordStr, wordLen, 
+                                 pParam),
+                  &pParam->wordTable);
+      }
+      
+      if (pWord)
+      {
+        distinctWords = store_word_dep_index(pWord->number, distinctWords,
+                           pParam);
+      }
+    }
+    
+    if (distinctWords)
+    {
+      update_word_dep_table(pParam->wordNumStr, distinctWords, pParam);
+    }
+  }
+  
+  free_line_tokens(&tokens);
+}
+
+/* Works like find_word_deps_in_region(), but reads the records [start, end)
+ of the token cache of '--tokencache' option. */
+static void find_word_deps_from_cache(long start, long end, 
+        struct Parameters *pParam)
+{
+  struct TokenCacheReader reader;
+  struct CachedLine cachedLine;
+  int distinctWords, i;
+  
+  open_token_cache_reader(&reader, start, end, pParam);
+  
+  while (read_token_cache_line(&reader, &cachedLine, pParam))
+  {
+    distinctWords = 0;
+    
+    for (i = 0; i < cachedLine.wordcount; i++)
+    {
+      if (cachedLine.ppWords[i])
+      {
+        distinctWords = store_word_dep_index(cachedLine.ppWords[i]->number,
+                           distinctWords, pParam);
+      }
+    }
+    
+    if (distinctWords)
+    {
+      update_word_dep_table(pParam->wordNumStr, distinctWords, pParam);
+    }
+  }
+}
+
+/* Every worker counts the word dependencies of its own region in a local
+ table, and the local tables are merged into pParam->wordDepTable. */
+static void find_word_deps_in_parallel(struct Parameters *pParam)
+{
+  struct WorkerContext *pWorkers;
+  int i;
+  
+  pWorkers = create_workers(pParam);
+  if (pParam->bTokenCacheReady)
+  {
+    split_token_cache(pWorkers, pParam);
+  }
+  run_workers(pWorkers, find_word_deps_worker, pParam);
+  
+  for (i = 0; i < pParam->threadNum; i++)
+  {
+    merge_word_dep_table(&pWorkers[i].param.wordDepTable, 
+               &pParam->wordDepTable, pParam);
+    free_word_dep_table(&pWorkers[i].param.wordDepTable);
+  }
+  
+  destroy_workers(pWorkers, pParam);
+}
+
+static void find_word_deps_worker(struct WorkerContext *pWorker)
+{
+  struct Parameters *pParam;
+  
+  pParam = &pWorker->param;
+  
+  init_word_dep_table(&pParam->wordDepTable, DEF_WORD_DEP_TABLE_SIZE, pParam);
+  
+  if (pParam->bTokenCacheReady)
+  {
+    find_word_deps_from_cache(pWorker->cacheStart, pWorker->cacheEnd, pParam);
+  }
+  else
+  {
+    find_word_deps_in_region(pWorker->pRegion, pParam);
+  }
+}
+
 void step_3_join_clusters(struct Parameters *pParam)
 {
   char logStr[MAXLOGMSGLEN];
@@ -100,8 +367,7 @@ void step_3_join_clusters(struct Parameters *pParam)
  generate random string to replace "token". */
 static void set_token(struct Parameters *pParam)
 {
-  while (find_elem(pParam->token, pParam->ppWordTable, pParam->wordTableSize,
-           pParam->wordTableSeed))
+  while (find_elem(pParam->token, &pParam->wordTable))
   {
     gen_random_string(pParam->token, TOKENLEN - 1);
   }
@@ -110,17 +376,17 @@ static void set_token(struct Parameters *pParam)
 static void join_cluster(struct Parameters *pParam)
 {
   int i;
-  struct Cluster *pCluster;
+  struct CandidateGroup *pGroup;
   struct ClusterWithToken *pClusterWithToken;
+  wordnumber_t j;
   
   for (i = 1; i <= pParam->biggestConstants; i++)
   {
-    pCluster = pParam->pClusterFamily[i];
+    pGroup = &pParam->pCandidateGroups[i];
     
-    while (pCluster)
+    for (j = 0; j < pGroup->num; j++)
     {
-      check_cluster_for_join_cluster(pCluster, pParam);
-      pCluster = pCluster->pNext;
+      check_cluster_for_join_cluster(pGroup->ppClusters[j], pParam);
     }
   }
   
@@ -255,14 +521,17 @@ static double cal_word_dep(struct Elem *word1, struct Elem *word2,
   //how many times word2 appears with word1.
   wordnumber_t word2NumInWord1;
   
+  //their indices in the word dependency table.
+  wordnumber_t word1Index, word2Index;
+  
   
-  word1Total = pParam->wordDepMatrix[word1->number *
-                     pParam->wordDepMatrixBreadth +
-                     word1->number];
+  word1Index = get_word_dep_index(word1->number, pParam);
+  word2Index = get_word_dep_index(word2->number, pParam);
   
-  word2NumInWord1 = pParam->wordDepMatrix[word1->number *
-                      pParam->wordDepMatrixBreadth +
-                      word2->number];
+  word1Total = find_word_dep(word1Index, word1Index, &pParam->wordDepTable);
+  
+  word2NumInWord1 = find_word_dep(word1Index, word2Index, 
+                  &pParam->wordDepTable);
   
   dependency = (double) word2NumInWord1 / word1Total;
   
@@ -309,12 +578,12 @@ static double cal_word_dep_number_version(wordnumber_t word1num,
   wordnumber_t word2NumInWord1;
   
   
-  word1Total = pParam->wordDepMatrix[word1num * pParam->wordDepMatrixBreadth +
-                     word1num];
+  word1num = get_word_dep_index(word1num, pParam);
+  word2num = get_word_dep_index(word2num, pParam);
+  
+  word1Total = find_word_dep(word1num, word1num, &pParam->wordDepTable);
   
-  word2NumInWord1 = pParam->wordDepMatrix[word1num *
-                      pParam->wordDepMatrixBreadth +
-                      word2num];
+  word2NumInWord1 = find_word_dep(word1num, word2num, &pParam->wordDepTable);
   
   dependency = (double) word2NumInWord1 / word1Total;
   
@@ -324,31 +593,29 @@ static double cal_word_dep_number_version(wordnumber_t word1num,
 static void join_cluster_with_token(struct Cluster *pCluster,
                struct Parameters *pParam)
 {
-  char key[MAXKEYLEN];
-  int i, len;
+  wordnumber_t key[MAXWORDS + 1];
+  int i;
   struct Elem *pElem;
   
   pParam->joinedClusterInputNum++;
   
-  *key = 0;
+  key[0] = pCluster->constants;
   
+  /* A token gets the ID 0, which is not used by any frequent word. */
   for (i = 1; i <= pCluster->constants; i++)
   {
     if (pParam->tokenMarker[i] == 0)
     {
-      strcat(key, pCluster->ppWord[i]->pKey);
+      key[i] = pCluster->ppWord[i]->number;
     }
     else
     {
-      strcat(key, pParam->token);
+      key[i] = 0;
     }
-    len = (int) strlen(key);
-    key[len] = CLUSTERSEP;
-    key[len + 1] = 0;
   }
   
-  pElem = add_elem(key, pParam->ppClusterTable, pParam->clusterTableSize,
-           pParam->clusterTableSeed, pParam);
+  pElem = add_cluster_elem(key, clusterkey2hash(key, pParam->clusterTable.seed),
+               &pParam->clusterTable, pParam);
   
   if (pElem->count == 1)
   {
@@ -368,37 +635,19 @@ static struct ClusterWithToken *create_cluster_with_token_instance(
   struct ClusterWithToken *ptr;
   int i;
   
-  ptr = (struct ClusterWithToken *) malloc(sizeof(struct ClusterWithToken));
-  if (!ptr)
-  {
-    log_msg(MALLOC_ERR_6010, LOG_ERR, pParam);
-    exit(1);
-  }
+  ptr = (struct ClusterWithToken *) arena_alloc(&pParam->joinArena,
+                          sizeof(struct ClusterWithToken),
+                          pParam);
+  ptr->ppWord = (struct Elem **) arena_alloc(&pParam->joinArena,
+                        (pCluster->constants + 1) *
+                        sizeof(struct Elem *), pParam);
+  ptr->ppToken = (struct Token **) arena_alloc(&pParam->joinArena,
+                         (pCluster->constants + 1) *
+                         sizeof(struct Token *), pParam);
+  ptr->fullWildcard = (int *) arena_alloc(&pParam->joinArena,
+                      2 * (pCluster->constants + 1) *
+                      sizeof(int), pParam);
   
-  ptr->ppWord = (struct Elem **) malloc((pCluster->constants + 1) * 
-          sizeof(struct Elem *));
-  if (!ptr->ppWord)
-  {
-    log_msg(MALLOC_ERR_6010, LOG_ERR, pParam);
-    exit(1);
-  }
-  
-  ptr->ppToken = (struct Token **) malloc((pCluster->constants + 1) * 
-          sizeof(struct Token *));
-  if (!ptr->ppToken)
-  {
-    log_msg(MALLOC_ERR_6010, LOG_ERR, pParam);
-    exit(1);
-  }
-  
-	ptr->fullWildcard = (int *) malloc(2 * (pCluster->constants + 1) * 
-          sizeof(int));
-  if (!ptr->fullWildcard)
-  {
-    log_msg(MALLOC_ERR_6010, LOG_ERR, pParam);
-    exit(1);
-  }
-	
   //Initialization..
   ptr->ppWord[0] = 0; //reserved..
   ptr->ppToken[0] = 0; //reserved..
@@ -417,7 +666,7 @@ static struct ClusterWithToken *create_cluster_with_token_instance(
   ptr->constants = pCluster->constants;
   ptr->count = 0;
   ptr->bIsJoined = pCluster->bIsJoined;
-  ptr->pLastNode = pCluster->pLastNode;
+  ptr->lastNode = pCluster->lastNode;
   
   //Build bidirectional link.
   //Type converted to (struct Cluster *) here. Should not cause a probelm.
@@ -475,12 +724,8 @@ static void adjust_cluster_with_token_instance(struct Cluster *pCluster,
         continue;
       }
       
-      ptrToken = (struct Token *) malloc(sizeof(struct Token));
-      if (!ptrToken)
-      {
-        log_msg(MALLOC_ERR_6011, LOG_ERR, pParam);
-        exit(1);
-      }
+      ptrToken = (struct Token *) arena_alloc(&pParam->joinArena,
+                          sizeof(struct Token), pParam);
       ptrToken->pWord = pCluster->ppWord[i];
       
       if (ptr->ppToken[i])
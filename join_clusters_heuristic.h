@@ -30,8 +30,9 @@
 extern "C" {
 #endif
 
-void update_word_dep_matrix(wordnumber_t *storage, int serial,
+void update_word_dep_table(wordnumber_t *storage, int serial,
               struct Parameters *pParam);
+void step_3_find_word_deps(struct Parameters *pParam);
 void step_3_join_clusters(struct Parameters *pParam);
 
 #ifdef __cplusplus
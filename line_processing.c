@@ -30,16 +30,23 @@
 #include <regex.h>     /* for regcomp() and regexec() */
 #include <time.h>      /* for time() and ctime() */
 #include <string.h>    /* for strcmp(), strcpy(), etc. */
+#ifdef __SSE2__
+#include <emmintrin.h> /* for SSE2 intrinsics */
+#endif
 
 #include "utility.h"
 #include "output.h"
 
-static int find_words_debug_0_1(char *line, char (*words)[MAXWORDLEN],
-             struct Parameters *pParam);
-static int find_words_debug_2(char *line, char (*words)[MAXWORDLEN],
-             struct Parameters *pParam);
-static int find_words_debug_3(char *line, char (*words)[MAXWORDLEN],
-             struct Parameters *pParam);
+static int find_word_spans_debug_0_1(char *line, int linelen, 
+             struct LineTokens *pTokens, struct Parameters *pParam);
+static int find_word_spans_debug_2(char *line, int linelen, 
+             struct LineTokens *pTokens, struct Parameters *pParam);
+static int find_word_spans_debug_3(char *line, int linelen, 
+             struct LineTokens *pTokens, struct Parameters *pParam);
+static int find_separator(char *text, int len, int *pStart, int *pEnd,
+        struct Parameters *pParam);
+static unsigned char *find_first_delim_byte(unsigned char *ptr, 
+        unsigned char *pEnd, struct Parameters *pParam);
 
 /* The three sub functions can be integrated into one function. However, for
  the sake of performance and code readability, they are divided. When making
@@ -48,27 +55,63 @@ static int find_words_debug_3(char *line, char (*words)[MAXWORDLEN],
  fixed in the following updates (considering to integrate all these 
  possibilities, regardless of readability. Or some other better upcoming 
  solutions). */
-/* The words in one log line will be copied to char (*words)[MAXWORDLEN] for 
- later process. Returns the number of words in one log line. */
-int find_words(char *line, char (*words)[MAXWORDLEN], struct Parameters *pParam)
+/* Find the words of one log line. The words are not copied, but described
+ with (offset, length) spans in pTokens->words[], relative to pTokens->pText.
+ pTokens->pText is the line itself (after '--byteoffset'), or a buffer in
+ pTokens, if the line was converted by '--template'. The line is given as a
+ pointer and a length, as handed out by read_region_line(), and does not need
+ to be terminated with 0. Empty words (e.g. the one before a leading
+ separator) are kept as spans of length 0. Returns the number of words in one
+ log line, which is also stored in pTokens->wordcount. */
+int find_word_spans(char *line, int linelen, struct LineTokens *pTokens, 
+        struct Parameters *pParam)
 {
+  int i, wordcount;
+  
   switch (pParam->debug)
   {
     case 0:
     case 1:
-      return find_words_debug_0_1(line, words, pParam);
+      wordcount = find_word_spans_debug_0_1(line, linelen, pTokens, pParam);
       break;
     case 2:
-      return find_words_debug_2(line, words, pParam);
+      wordcount = find_word_spans_debug_2(line, linelen, pTokens, pParam);
       break;
     case 3:
-      return find_words_debug_3(line, words, pParam);
+      wordcount = find_word_spans_debug_3(line, linelen, pTokens, pParam);
       break;
     default:
+      wordcount = 0;
       break;
   }
   
-  return 0;
+  pTokens->wordcount = wordcount;
+  
+  /* Every word is hashed here once, and the hash is carried with the word
+   through the pass (see struct WordSpan). */
+  for (i = 0; i < wordcount; i++)
+  {
+    pTokens->words[i].hash = str2hash(pTokens->pText + pTokens->words[i].offset,
+                      pTokens->words[i].len, 
+                      pParam->wordTableSeed);
+  }
+  
+  return wordcount;
+}
+
+void init_line_tokens(struct LineTokens *pTokens)
+{
+  pTokens->pText = 0;
+  pTokens->wordcount = 0;
+  pTokens->pBuffer = 0;
+  pTokens->bufferSize = 0;
+}
+
+void free_line_tokens(struct LineTokens *pTokens)
+{
+  free((void *) pTokens->pBuffer);
+  pTokens->pBuffer = 0;
+  pTokens->bufferSize = 0;
 }
 
 int is_word_repeated(wordnumber_t *storage, wordnumber_t wordNumber, int serial)
@@ -88,26 +131,24 @@ int is_word_repeated(wordnumber_t *storage, wordnumber_t wordNumber, int serial)
 
 /* When making changes to this function, don't forget to also change the 
  corresponding lines in the other two brother functions. They are:
- find_words_debug_0_1(), find_words_debug_2(), find_words_debug_3(). 
+ find_word_spans_debug_0_1(), find_word_spans_debug_2(), 
+ find_word_spans_debug_3(). 
  For the sake of computing performance, sorry for this inconvenience. It will
  be fixed with better solution in the following updates. */
-static int find_words_debug_0_1(char *line, char (*words)[MAXWORDLEN],
-             struct Parameters *pParam)
+static int find_word_spans_debug_0_1(char *line, int linelen, 
+             struct LineTokens *pTokens, struct Parameters *pParam)
 {
   regmatch_t match[MAXPARANEXPR];
   
-  int i, j, linelen, len;
+  int i, len, offset, sepStart, sepEnd;
   struct TemplElem *ptr;
-  char *buffer = NULL;
+  char *buffer;
   
-  if (*line == 0)
+  if (linelen == 0)
   {
     return 0;
   }
   
-  linelen = (int) strlen(line);
-  
-  
   if (pParam->byteOffset >= linelen)  { return 0; }
   
   if (pParam->byteOffset)
@@ -118,7 +159,10 @@ static int find_words_debug_0_1(char *line, char (*words)[MAXWORDLEN],
   
   if (pParam->pFilter)
   {
-    if (regexec(&pParam->filter_regex, line, MAXPARANEXPR, match, 0))
+    match[0].rm_so = 0;
+    match[0].rm_eo = linelen;
+    if (regexec(&pParam->filter_regex, line, MAXPARANEXPR, match, 
+          REG_STARTEND))
     {
       return 0;
     }
@@ -146,13 +190,19 @@ static int find_words_debug_0_1(char *line, char (*words)[MAXWORDLEN],
       }
       
       i = 0;
-      //free((void *) buffer);
-      buffer = (char *) malloc(len + 1);
-      if (!buffer)
+      /* The buffer is kept in pTokens, since the spans point into it. */
+      if (len + 1 > pTokens->bufferSize)
       {
-        log_msg(MALLOC_ERR_6008, LOG_ERR, pParam);
-        exit(1);
+        free((void *) pTokens->pBuffer);
+        pTokens->bufferSize = len + 1;
+        pTokens->pBuffer = (char *) malloc(pTokens->bufferSize);
+        if (!pTokens->pBuffer)
+        {
+          log_msg(MALLOC_ERR_6041, LOG_ERR, pParam);
+          exit(1);
+        }
       }
+      buffer = pTokens->pBuffer;
       
       for (ptr = pParam->pTemplate; ptr; ptr = ptr->pNext)
       {
@@ -179,43 +229,36 @@ static int find_words_debug_0_1(char *line, char (*words)[MAXWORDLEN],
       
       buffer[i] = 0;
       line = buffer;
+      linelen = i;
     }
     
   }
   
+  pTokens->pText = line;
+  offset = 0;
+  
   for (i = 0; i < MAXWORDS; ++i)
   {
-    if (regexec(&pParam->delim_regex, line, 1, match, 0))
+    if (!find_separator(line + offset, linelen - offset, &sepStart, &sepEnd,
+              pParam))
     {  /* This is the last word. */
-      for (j = 0; line[j] != 0; j++)
-      {
-        words[i][j] = line[j];
-      }
-      words[i][j] = 0;
+      pTokens->words[i].offset = offset;
+      pTokens->words[i].len = linelen - offset;
       
       break;
     }
     
-    for (j = 0; j < match[0].rm_so; ++j)
-    {
-      words[i][j] = line[j];
-    }
-    
-    words[i][j] = 0;
+    pTokens->words[i].offset = offset;
+    pTokens->words[i].len = sepStart;
     
-    line += match[0].rm_eo;
+    offset += sepEnd;
     
-    if (*line == 0)
+    if (offset == linelen)
     {
       break;
     }
   }
   
-  if (pParam->pTemplate)
-  {
-    free((void *) buffer);
-  }
-  
   /* Return the word numbers in the line, including the repeated ones. */
   if (i == MAXWORDS)
   {
@@ -229,32 +272,31 @@ static int find_words_debug_0_1(char *line, char (*words)[MAXWORDLEN],
 
 /* When making changes to this function, don't forget to also change the 
  corresponding lines in the other two brother functions. They are:
- find_words_debug_0_1(), find_words_debug_2(), find_words_debug_3(). 
+ find_word_spans_debug_0_1(), find_word_spans_debug_2(), 
+ find_word_spans_debug_3(). 
  For the sake of computing performance, sorry for this inconvenience. It will
  be fixed with better solution in the following updates. */
-static int find_words_debug_2(char *line, char (*words)[MAXWORDLEN],
-             struct Parameters *pParam)
+static int find_word_spans_debug_2(char *line, int linelen, 
+             struct LineTokens *pTokens, struct Parameters *pParam)
 {
   regmatch_t match[MAXPARANEXPR];
   
-  int i, j, linelen, len;
+  int i, len, offset, sepStart, sepEnd;
   struct TemplElem *ptr;
-  char *buffer = NULL;
+  char *buffer;
   
   //debug2
   static support_t linecnt = 0;
+  support_t curcnt;
   char logStr[MAXLOGMSGLEN];
   char digit[MAXDIGITBIT];
   double pct;
   
-  if (*line == 0)
+  if (linelen == 0)
   {
     return 0;
   }
   
-  linelen = (int) strlen(line);
-  
-  
   if (pParam->byteOffset >= linelen)  { return 0; }
   
   if (pParam->byteOffset)
@@ -265,7 +307,10 @@ static int find_words_debug_2(char *line, char (*words)[MAXWORDLEN],
   
   if (pParam->pFilter)
   {
-    if (regexec(&pParam->filter_regex, line, MAXPARANEXPR, match, 0))
+    match[0].rm_so = 0;
+    match[0].rm_eo = linelen;
+    if (regexec(&pParam->filter_regex, line, MAXPARANEXPR, match, 
+          REG_STARTEND))
     {
       return 0;
     }
@@ -293,13 +338,19 @@ static int find_words_debug_2(char *line, char (*words)[MAXWORDLEN],
       }
       
       i = 0;
-      //free((void *) buffer);
-      buffer = (char *) malloc(len + 1);
-      if (!buffer)
+      /* The buffer is kept in pTokens, since the spans point into it. */
+      if (len + 1 > pTokens->bufferSize)
       {
-        log_msg(MALLOC_ERR_6008, LOG_ERR, pParam);
-        exit(1);
+        free((void *) pTokens->pBuffer);
+        pTokens->bufferSize = len + 1;
+        pTokens->pBuffer = (char *) malloc(pTokens->bufferSize);
+        if (!pTokens->pBuffer)
+        {
+          log_msg(MALLOC_ERR_6041, LOG_ERR, pParam);
+          exit(1);
+        }
       }
+      buffer = pTokens->pBuffer;
       
       for (ptr = pParam->pTemplate; ptr; ptr = ptr->pNext)
       {
@@ -326,51 +377,45 @@ static int find_words_debug_2(char *line, char (*words)[MAXWORDLEN],
       
       buffer[i] = 0;
       line = buffer;
+      linelen = i;
     }
     
   }
   
+  pTokens->pText = line;
+  offset = 0;
+  
   for (i = 0; i < MAXWORDS; ++i)
   {
-    if (regexec(&pParam->delim_regex, line, 1, match, 0))
+    if (!find_separator(line + offset, linelen - offset, &sepStart, &sepEnd,
+              pParam))
     {  /* This is the last word. */
-      for (j = 0; line[j] != 0; j++)
-      {
-        words[i][j] = line[j];
-      }
-      words[i][j] = 0;
+      pTokens->words[i].offset = offset;
+      pTokens->words[i].len = linelen - offset;
       
       break;
     }
     
-    for (j = 0; j < match[0].rm_so; ++j)
-    {
-      words[i][j] = line[j];
-    }
-    
-    words[i][j] = 0;
+    pTokens->words[i].offset = offset;
+    pTokens->words[i].len = sepStart;
     
-    line += match[0].rm_eo;
+    offset += sepEnd;
     
-    if (*line == 0)
+    if (offset == linelen)
     {
       break;
     }
   }
   
-  if (pParam->pTemplate)
-  {
-    free((void *) buffer);
-  }
-  
   //debug_2
-  linecnt++;
-  if (linecnt % DEBUG_2_INTERVAL == 0)
+  /* The counter is shared by the worker threads, if '--threads' is used. */
+  curcnt = __sync_add_and_fetch(&linecnt, 1);
+  if (curcnt % DEBUG_2_INTERVAL == 0)
   {
-    str_format_int_grouped(digit, linecnt);
+    str_format_int_grouped(digit, curcnt);
     if (pParam->totalLineNum)
     {
-      pct = (double) linecnt / pParam->totalLineNum;
+      pct = (double) curcnt / pParam->totalLineNum;
       sprintf(logStr, "%.2f%% Finished. - %s lines out of %s", pct * 100,
           digit, pParam->totalLineNumDigit);
     }
@@ -396,32 +441,33 @@ static int find_words_debug_2(char *line, char (*words)[MAXWORDLEN],
 
 /* When making changes to this function, don't forget to also change the 
  corresponding lines in the other two brother functions. They are:
- find_words_debug_0_1(), find_words_debug_2(), find_words_debug_3(). 
+ find_word_spans_debug_0_1(), find_word_spans_debug_2(), 
+ find_word_spans_debug_3(). 
  For the sake of computing performance, sorry for this inconvenience. It will
  be fixed with better solution in the following updates. */
-static int find_words_debug_3(char *line, char (*words)[MAXWORDLEN],
-             struct Parameters *pParam)
+static int find_word_spans_debug_3(char *line, int linelen, 
+             struct LineTokens *pTokens, struct Parameters *pParam)
 {
   regmatch_t match[MAXPARANEXPR];
   
-  int i, j, linelen, len;
+  int i, len, offset, sepStart, sepEnd;
   struct TemplElem *ptr;
-  char *buffer = NULL;
+  char *buffer;
   
   //debug3
   static support_t linecnt = 0;
+  static time_t timeStorage = 0;
+  support_t curcnt;
+  time_t now, lastReport;
   char logStr[MAXLOGMSGLEN];
   char digit[MAXDIGITBIT];
   double pct;
   
-  if (*line == 0)
+  if (linelen == 0)
   {
     return 0;
   }
   
-  linelen = (int) strlen(line);
-  
-  
   if (pParam->byteOffset >= linelen)  { return 0; }
   
   if (pParam->byteOffset)
@@ -432,7 +478,10 @@ static int find_words_debug_3(char *line, char (*words)[MAXWORDLEN],
   
   if (pParam->pFilter)
   {
-    if (regexec(&pParam->filter_regex, line, MAXPARANEXPR, match, 0))
+    match[0].rm_so = 0;
+    match[0].rm_eo = linelen;
+    if (regexec(&pParam->filter_regex, line, MAXPARANEXPR, match, 
+          REG_STARTEND))
     {
       return 0;
     }
@@ -460,13 +509,19 @@ static int find_words_debug_3(char *line, char (*words)[MAXWORDLEN],
       }
       
       i = 0;
-      //free((void *) buffer);
-      buffer = (char *) malloc(len + 1);
-      if (!buffer)
+      /* The buffer is kept in pTokens, since the spans point into it. */
+      if (len + 1 > pTokens->bufferSize)
       {
-        log_msg(MALLOC_ERR_6008, LOG_ERR, pParam);
-        exit(1);
+        free((void *) pTokens->pBuffer);
+        pTokens->bufferSize = len + 1;
+        pTokens->pBuffer = (char *) malloc(pTokens->bufferSize);
+        if (!pTokens->pBuffer)
+        {
+          log_msg(MALLOC_ERR_6041, LOG_ERR, pParam);
+          exit(1);
+        }
       }
+      buffer = pTokens->pBuffer;
       
       for (ptr = pParam->pTemplate; ptr; ptr = ptr->pNext)
       {
@@ -493,52 +548,50 @@ static int find_words_debug_3(char *line, char (*words)[MAXWORDLEN],
       
       buffer[i] = 0;
       line = buffer;
+      linelen = i;
     }
     
   }
   
+  pTokens->pText = line;
+  offset = 0;
+  
   for (i = 0; i < MAXWORDS; ++i)
   {
-    if (regexec(&pParam->delim_regex, line, 1, match, 0))
+    if (!find_separator(line + offset, linelen - offset, &sepStart, &sepEnd,
+              pParam))
     {  /* This is the last word. */
-      for (j = 0; line[j] != 0; j++)
-      {
-        words[i][j] = line[j];
-      }
-      words[i][j] = 0;
+      pTokens->words[i].offset = offset;
+      pTokens->words[i].len = linelen - offset;
       
       break;
     }
     
-    for (j = 0; j < match[0].rm_so; ++j)
-    {
-      words[i][j] = line[j];
-    }
-    
-    words[i][j] = 0;
+    pTokens->words[i].offset = offset;
+    pTokens->words[i].len = sepStart;
     
-    line += match[0].rm_eo;
+    offset += sepEnd;
     
-    if (*line == 0)
+    if (offset == linelen)
     {
       break;
     }
   }
   
-  if (pParam->pTemplate)
-  {
-    free((void *) buffer);
-  }
-  
   //debug_3
-  linecnt++;
-  if (time(0) != pParam->timeStorage && time(0) % DEBUG_3_INTERVAL == 0)
+  /* The counter and the time of the last report are shared by the worker
+   threads, if '--threads' is used. Only the thread that manages to update
+   the time prints the report. */
+  curcnt = __sync_add_and_fetch(&linecnt, 1);
+  now = time(0);
+  lastReport = timeStorage;
+  if (now != lastReport && now % DEBUG_3_INTERVAL == 0 &&
+    __sync_bool_compare_and_swap(&timeStorage, lastReport, now))
   {
-    pParam->timeStorage = time(0);
-    str_format_int_grouped(digit, linecnt);
+    str_format_int_grouped(digit, curcnt);
     if (pParam->totalLineNum)
     {
-      pct = (double) linecnt / pParam->totalLineNum;
+      pct = (double) curcnt / pParam->totalLineNum;
       sprintf(logStr, "%.2f%% Finished. - %s lines out of %s", pct * 100,
           digit, pParam->totalLineNumDigit);
     }
@@ -560,4 +613,106 @@ static int find_words_debug_3(char *line, char (*words)[MAXWORDLEN],
   {
     return i+1;
   }
-}
\ No newline at end of file
+}
+
+/* Find the first separator in text[0, len). On success, the separator is
+ text[*pStart, *pEnd) and 1 is returned. If there is no separator, 0 is
+ returned. Simple separators (see detect_simple_separator() in preparation.c)
+ are found by scanning bytes, the others with regexec(). */
+static int find_separator(char *text, int len, int *pStart, int *pEnd,
+        struct Parameters *pParam)
+{
+  regmatch_t match[1];
+  unsigned char *ptr, *pTextEnd;
+  
+  if (!pParam->bSimpleDelim)
+  {
+    match[0].rm_so = 0;
+    match[0].rm_eo = len;
+    if (regexec(&pParam->delim_regex, text, 1, match, REG_STARTEND))
+    {
+      return 0;
+    }
+    
+    *pStart = (int) match[0].rm_so;
+    *pEnd = (int) match[0].rm_eo;
+    
+    return 1;
+  }
+  
+  pTextEnd = (unsigned char *) text + len;
+  ptr = find_first_delim_byte((unsigned char *) text, pTextEnd, pParam);
+  
+  if (ptr == pTextEnd)
+  {
+    return 0;
+  }
+  
+  *pStart = (int) (ptr - (unsigned char *) text);
+  ptr++;
+  
+  if (pParam->bDelimRepeat)
+  {
+    while (ptr < pTextEnd && pParam->delimSet[*ptr])
+    {
+      ptr++;
+    }
+  }
+  
+  *pEnd = (int) (ptr - (unsigned char *) text);
+  
+  return 1;
+}
+
+/* Returns a pointer to the first byte in [ptr, pEnd) that belongs to the
+ simple separator, or pEnd if there is none. */
+static unsigned char *find_first_delim_byte(unsigned char *ptr, 
+        unsigned char *pEnd, struct Parameters *pParam)
+{
+#ifdef __SSE2__
+  __m128i needles[MAXSIMDDELIMS];
+  __m128i chunk, hits;
+  int i, mask;
+#endif
+  
+  if (pParam->delimByteNum == 1)
+  {
+    ptr = (unsigned char *) memchr(ptr, pParam->delimBytes[0], pEnd - ptr);
+    return ptr ? ptr : pEnd;
+  }
+  
+#ifdef __SSE2__
+  if (pParam->delimByteNum <= MAXSIMDDELIMS && pEnd - ptr >= 16)
+  {
+    for (i = 0; i < pParam->delimByteNum; i++)
+    {
+      needles[i] = _mm_set1_epi8((char) pParam->delimBytes[i]);
+    }
+    
+    while (pEnd - ptr >= 16)
+    {
+      chunk = _mm_loadu_si128((const __m128i *) ptr);
+      hits = _mm_cmpeq_epi8(chunk, needles[0]);
+      for (i = 1; i < pParam->delimByteNum; i++)
+      {
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, needles[i]));
+      }
+      
+      mask = _mm_movemask_epi8(hits);
+      if (mask)
+      {
+        return ptr + __builtin_ctz(mask);
+      }
+      
+      ptr += 16;
+    }
+  }
+#endif
+  
+  while (ptr < pEnd && !pParam->delimSet[*ptr])
+  {
+    ptr++;
+  }
+  
+  return ptr;
+}
@@ -30,7 +30,10 @@
 extern "C" {
 #endif
 
-int find_words(char *line, char (*words)[MAXWORDLEN], struct Parameters *pParam);
+int find_word_spans(char *line, int linelen, struct LineTokens *pTokens, 
+        struct Parameters *pParam);
+void init_line_tokens(struct LineTokens *pTokens);
+void free_line_tokens(struct LineTokens *pTokens);
 int is_word_repeated(wordnumber_t *storage, wordnumber_t wordNumber, int serial);
 
 #ifdef __cplusplus
@@ -56,19 +56,39 @@ extern "C" {
  frequent words and clusters.*/
 #define MAXDIGITBIT 32
 
-/* Separator character used for building hash keys of the cluster hash table. */
-#define CLUSTERSEP '\n'
-
-/* Maximum hash key length in cluster hash table. */
-#define MAXKEYLEN 20480
-
 /* Token length used in Join_Clusters. Token is an identifier for the words that
  is below word weight threshold. */
 #define TOKENLEN 10
 
-/* Word hash table's default size is 100000. */
+/* Word hash table's default initial size is 100000 (rounded up to a power of
+ two). The hash tables grow by themselves, see hash_table_processing.c. */
 #define DEF_WORD_TABLE_SIZE 100000
 
+/* Initial size of the cluster hash table. */
+#define DEF_CLUSTER_TABLE_SIZE 4096
+
+/* The smallest size of a hash table, and its highest load factor
+ (HASHTABLE_LOAD_NUM / HASHTABLE_LOAD_DEN), above which the table doubles. */
+#define HASHTABLE_MIN_SIZE 16
+#define HASHTABLE_LOAD_NUM 3
+#define HASHTABLE_LOAD_DEN 4
+
+/* Highest load factor of a frozen hash table, see freeze_hash_table(). */
+#define FROZEN_LOAD_NUM 1
+#define FROZEN_LOAD_DEN 2
+
+/* Perfect hash function of a frozen table, see perfect_hash.c. The keys of a
+ bucket are placed together, about PERFECT_HASH_BUCKET_SIZE keys per bucket.
+ The pilots of a bucket are tried up to PERFECT_HASH_PILOT_LIMIT(n), and a new
+ seed is tried up to PERFECT_HASH_TRIES times, before the table is frozen
+ without a perfect hash function. The Bloom filter has at least 
+ FILTER_BITS_PER_KEY bits per key, and FILTER_HASH_NUM of them are set. */
+#define PERFECT_HASH_BUCKET_SIZE 4
+#define PERFECT_HASH_PILOT_LIMIT(n) ((n) * 16 + 1024)
+#define PERFECT_HASH_TRIES 4
+#define FILTER_BITS_PER_KEY 16
+#define FILTER_HASH_NUM 4
+
 /* InitSeed is default to 1. It is used to generate random numbers, which help
  in the string hashing processes. */
 #define DEF_INIT_SEED 1
@@ -88,9 +108,88 @@ extern "C" {
  facility is "local2". */
 #define DEF_SYSLOG_FACILITY "local2"
 
+/* Default number of worker threads used in the passes over the data set. One
+ thread means the original single-threaded processing. */
+#define DEF_THREAD_NUM 1
+
+/* Size of the word sketch used in the '--wsample' mode, if '--wsize' is not
+ given. After the verifying pass, the sketch only holds the occurrences of the
+ words that were not proposed by the sample, so it should be large enough that
+ these rarely add up to the support in one slot. */
+#define DEF_SAMPLE_SKETCH_SIZE 1000000
+
+/* The passes over the data set in the '--wsample' mode, see function
+ create_vocabulary_by_sampling(). */
+#define SAMPLING_PASS 0
+#define VERIFYING_PASS 1
+#define FIXUP_PASS 2
+
+/* The offset of every TOKENCACHE_CHECKPOINT-th record of the token cache is
+ kept, so that the cache can be split between worker threads. */
+#define TOKENCACHE_CHECKPOINT 4096
+
+/* Default size of an arena block, and the alignment of arena allocations. */
+#define ARENA_BLOCK_SIZE (4 * 1024 * 1024)
+#define ARENA_ALIGN 8
+
+/* Upper limit of the '--threads' option. */
+#define MAXTHREADS 256
+
+/* Default number of rows of the word and cluster sketches, and the upper limit
+ of the '--sketchdepth' option. One row means the original single-row sketch.
+ */
+#define DEF_SKETCH_DEPTH 1
+#define MAXSKETCHDEPTH 8
+
+/* Initial size of the word dependency table of '--wweight' option. */
+#define DEF_WORD_DEP_TABLE_SIZE 65536
+
+/* Arrays of at most INSERTION_SORT_SIZE elements are sorted with insertion
+ sort, and arrays of at least PARALLEL_SORT_SIZE elements are sorted with
+ several threads, if '--threads' option is given. See sort_elements(). */
+#define INSERTION_SORT_SIZE 16
+#define PARALLEL_SORT_SIZE 65536
+
+/* With '--threads' option, the threads of '--aggrsup' option take the
+ candidates AGGREGATE_CHUNK_SIZE at a time, see aggregate_task_main(). */
+#define AGGREGATE_CHUNK_SIZE 64
+
+/* Number of the entries of the cache of '--aggrsup' option, a power of 2, and
+ the number of the nodes below a node that makes it worth looking up the 
+ cache. See find_more_specific_cached(). */
+#define AGGREGATE_MEMO_SIZE 65536
+#define AGGREGATE_MEMO_MIN_SUBTREE 256
+
+/* Size of the buffer of struct OutputWriter. */
+#define OUTPUT_BUFFER_SIZE (1024 * 1024)
+
+/* Size of the buffer of struct RegionReader for an input file that can't be
+ mapped into memory, at least MAXLINELEN. */
+#define INPUT_BUFFER_SIZE (1024 * 1024)
+
+/* Values of the '--outputformat' option. */
+#define OUTPUT_FORMAT_TEXT 0
+#define OUTPUT_FORMAT_NDJSON 1
+#define OUTPUT_FORMAT_BINARY 2
+
+/* The binary output format begins with these 4 bytes, see
+ print_cluster_binary(). */
+#define BINARY_OUTPUT_MAGIC "LCB1"
+
+/* Stack size of a worker thread. The passes over the data set keep the words
+ of a line in a char[MAXWORDS][MAXWORDLEN] array on the stack, which is more
+ than some platforms give to a new thread by default. */
+#define WORKER_STACK_SIZE (16 * 1024 * 1024)
+
 /* Words are separated by space. Tab is not considered as a separator. */
 //#define DEF_WORD_DELM "[ \t]+"
 #define DEF_WORD_DELM "[ ]+"
+
+/* A simple separator (a single byte or a bracket expression, optionally
+ followed by '+') with at most this many different bytes is searched with SSE2
+ instructions, if they are available. Other simple separators are searched with
+ a byte table. */
+#define MAXSIMDDELIMS 8
   
 /* ==== Type definitions ==== */
 
@@ -127,7 +226,14 @@ Options:\n\
 --initseed=<seed>\n\
 --wtablesize=<wordtable_size>\n\
 --outputmode=<output_mode> (1)\n\
+--outputformat=<output_format> (text, ndjson, binary)\n\
 --detailtoken\n\
+--threads=<thread_number>\n\
+--wsample=<sample_rate>\n\
+--tokencache=<cache_file>\n\
+--sketchdepth=<sketch_depth>\n\
+--wdeppass\n\
+--top=<cluster_number>\n\
 --help, -h\n\
 --version\n\
 \n\
@@ -158,6 +264,9 @@ equivalent to --support=20.\n\
 Regular expression which matches separating characters between words.\n\
 Default value for <word_separator_regexp> is \\s+ (i.e., regular expression\n\
 that matches one or more whitespace characters).\n\
+A separator which is a single character or a bracket expression, optionally\n\
+followed by +, (e.g. ',' or '[ :]+') is matched without regular expression\n\
+engine, which is considerably faster.\n\
 \n\
 --lfilter=<line_filter_regexp>\n\
 When clustering log file lines from file(s) given with --input option(s),\n\
@@ -197,6 +306,9 @@ out infrequent words from the word frequency estimation process. This\n\
 option requires an additional pass over input files, but can save large\n\
 amount of memory, since most words in log files are usually infrequent.\n\
 For example, --wsize=250000 uses a sketch of 250,000 counters for filtering.\n\
+A counter takes 1, 2 or 4 bytes, depending on the support threshold (4 bytes\n\
+with --rsupport, since the threshold is not known yet when the sketch is\n\
+built). The same applies to --csize.\n\
 \n\
 --wweight=<word_weight_threshold>\n\
 This option enables word weight based heuristic for joining clusters.\n\
@@ -299,8 +411,9 @@ which is used to generate seed values for string hashing functions inside\n\
 LogCluster. The default value for the option is 1.\n\
 \n\
 --wtablesize=<wordtable_size>\n\
-The number of slots in the vocabulary hash table. The default value for the\n\
-option is 100,000.\n\
+The initial number of slots in the vocabulary hash table. The table grows\n\
+automatically when it fills up, so the option only saves the first resizes.\n\
+The default value for the option is 100,000.\n\
 \n\
 --outputmode=<output_mode> (1)\n\
 This program outputs the clusters with a support value descending order. This\n\
@@ -311,6 +424,26 @@ complex.\n\
 You can also use this option with out argument, like '--outputmode', which will\n\
 set output mode to 1.\n\
 \n\
+--outputformat=<output_format> (text, ndjson, binary)\n\
+The format in which the clusters are written to standard output. The default\n\
+is text, the human readable format. With ndjson, every cluster is a JSON\n\
+object on a line of its own, for example\n\
+{\"id\":1,\"support\":20,\"constants\":[\"Interface\",[\"up\",\"down\"]],\n\
+\"wildcards\":[[0,0],[1,1],[0,0]]}\n\
+(without the line break). id numbers the clusters in their output order,\n\
+beginning from 1. A constant is a string, or a list of strings if it is a\n\
+token of '--wweight' option. wildcards has one more element than constants:\n\
+the [min,max] ranges of the wildcards before each constant, and at last the\n\
+range of the wildcard after the last constant, [0,0] meaning no wildcard.\n\
+The words are written as UTF-8. A byte that is not part of a valid UTF-8\n\
+sequence is written as the escape \\u00XX of its value.\n\
+With binary, the output begins with the 4 bytes \"LCB1\", which are followed\n\
+by the clusters, each of them as: id (8 bytes), support\n\
+(8 bytes), number of constants (4 bytes); for every constant: wildcard min and\n\
+max before it (4 + 4 bytes), number of its words (4 bytes), and for every\n\
+word its length (4 bytes) and its bytes; at last wildcard min and max after\n\
+the last constant (4 + 4 bytes). All integers are unsigned and little-endian.\n\
+\n\
 --detailtoken\n\
 If Join_Cluster heuristic('--wweight' option) is used, this option can make the\n\
 output more detailed. For the sake of simplicity, by default, if a token has\n\
@@ -324,6 +457,69 @@ With this option, output is\n\
 (Interface) eth0 (up|down)\n\
 This option is meaningless without '--wweight' option.\n\
 \n\
+--threads=<thread_number>\n\
+Use <thread_number> worker threads. The input file(s) are split into\n\
+<thread_number> regions of roughly equal size, across files and across byte\n\
+ranges within a file (aligned to line boundaries). Every thread processes its\n\
+own region with private tables, and the private tables are merged in the order\n\
+of the regions afterwards. The threads are used in the following passes:\n\
+building the vocabulary (except with '--wsample' option), finding cluster\n\
+candidates, counting word dependencies for '--wweight' option, finding\n\
+outliers for '--outliers' option, aggregating supports for '--aggrsup'\n\
+option (each thread takes a share of the candidates), and sorting the output\n\
+clusters (for large numbers of clusters). The result is the same as with a\n\
+single thread. The default value for the option is 1.\n\
+\n\
+--wsample=<sample_rate>\n\
+Find frequent words without keeping every word of the input in memory. The\n\
+option takes a real number from the range 0..1 for its value, which is the\n\
+fraction of input lines that are sampled. The words of the sampled lines are\n\
+counted, and the words that reach a lowered support threshold in the sample\n\
+are proposed as frequent words. In the same pass, a sketch of all words is\n\
+built (its size is set with --wsize, default is 1,000,000 counters). A second\n\
+pass counts the proposed words exactly. If the sketch shows that a frequent\n\
+word may have been missed by the sample, a third pass counts the words that\n\
+fall into the suspicious sketch slots. The result is the same as without\n\
+this option, and memory is proportional to the number of frequent words.\n\
+For example, --wsample=0.05 samples 5% of the input lines.\n\
+Vocabulary is built with one thread in this mode.\n\
+\n\
+--tokencache=<cache_file>\n\
+While building the vocabulary, write every line as a compact sequence of\n\
+word numbers into <cache_file>. After the frequent words are found, the\n\
+cache is rewritten with frequent word IDs only (infrequent words become 0),\n\
+and the following passes over the data set (cluster sketch, cluster\n\
+candidates, outliers) read the cache instead of splitting the lines into\n\
+words again. The cache file is removed at the end. This option can not be\n\
+used together with --wsample option.\n\
+\n\
+--sketchdepth=<sketch_depth>\n\
+Use Count-Min sketches of <sketch_depth> rows for the --wsize and --csize\n\
+options. Every row has <wordsketch_size> (or <clustersketch_size>) counters\n\
+and its own hash function, and a word or cluster candidate is estimated by the\n\
+smallest of its counters. The counters are raised with conservative update,\n\
+i.e. only the smallest ones are raised, so the estimates are much closer to\n\
+the real counts than with one row of the same total size. The estimated\n\
+false positive rate of a sketch (the fraction of infrequent words or\n\
+candidates that pass it) is logged after the sketch is built. The option takes\n\
+a number from the range 1..8, the default value is 1, i.e. a single row.\n\
+For example, --wsize=50000 --sketchdepth=4 uses 4 rows of 50,000 counters.\n\
+\n\
+--wdeppass\n\
+With '--wweight' option, count the word dependencies in a pass of their own\n\
+after the clusters are found, instead of in the pass that finds the cluster\n\
+candidates. Only the words that are constants of the clusters are counted,\n\
+so the memory and time this takes scale with the words of the clusters, not\n\
+with all frequent words. The result is the same, but an additional pass over\n\
+input files is made. This option is meaningless without '--wweight' option.\n\
+\n\
+--top=<cluster_number>\n\
+Print only the <cluster_number> clusters with the highest support, instead of\n\
+all clusters. The clusters are selected without sorting all of them, which\n\
+saves time when a large number of clusters is found. Clusters of equal support\n\
+are printed in alphabetical order of their constants. This option can not be\n\
+used together with '--outputmode' option.\n\
+\n\
 --help, or -h\n\
 Print this help.\n\
 \n\
@@ -369,7 +565,6 @@ static char *pSyslogFacilityList[] =
 #define MALLOC_ERR_6005 "malloc() failed! Function: build_template_chain()."
 #define MALLOC_ERR_6006 "malloc() failed! Function: parse_options()."
 #define MALLOC_ERR_6007 "malloc() failed! Function: add_elem()."
-#define MALLOC_ERR_6008 "malloc() failed! Function: find_words()."
 #define MALLOC_ERR_6009 "malloc() failed! Function: create_cluster_instance()."
 #define MALLOC_ERR_6010 "malloc() failed! Function: create_cluster_with_token_instance()."
 #define MALLOC_ERR_6011 "malloc() failed. Function: adjust_cluster_with_token_instance()."
@@ -382,11 +577,39 @@ static char *pSyslogFacilityList[] =
 #define MALLOC_ERR_6018 "malloc() failed. Function: print_clusters_default_1()."
 #define MALLOC_ERR_6019 "malloc() failed. Function: print_clusters_if_join_cluster_default_0()."
 #define MALLOC_ERR_6020 "malloc() failed. Function: __print_clusters_if_join_cluster_default_0()."
+#define MALLOC_ERR_6021 "malloc() failed. Function: create_workers()."
+#define MALLOC_ERR_6022 "malloc() failed. Function: split_input_into_regions()."
+#define MALLOC_ERR_6023 "malloc() failed. Function: add_chunk_to_region()."
+#define MALLOC_ERR_6024 "malloc() failed. Function: open_chunk()."
+#define MALLOC_ERR_6025 "malloc() failed. Function: create_vocabulary_in_parallel()."
+#define MALLOC_ERR_6026 "malloc() failed. Function: step_1_find_frequent_words()."
+#define MALLOC_ERR_6027 "malloc() failed. Function: step_1_build_token_cache()."
+#define MALLOC_ERR_6028 "mmap() failed. Function: arena_alloc()."
+#define MALLOC_ERR_6029 "malloc() failed. Function: resize_hash_table()."
+#define MALLOC_ERR_6030 "malloc() failed. Function: init_sketch()."
+#define MALLOC_ERR_6031 "malloc() failed. Function: resize_word_dep_table()."
+#define MALLOC_ERR_6032 "malloc() failed. Function: step_3_find_word_deps()."
+#define MALLOC_ERR_6033 "malloc() failed. Function: sort_elements()."
+#define MALLOC_ERR_6034 "malloc() failed. Function: init_output_writer()."
+#define MALLOC_ERR_6035 "malloc() failed. Function: build_perfect_hash()."
+#define MALLOC_ERR_6036 "malloc() failed. Function: build_candidate_store()."
+#define MALLOC_ERR_6037 "malloc() failed. Function: build_prefix_trie()."
+#define MALLOC_ERR_6038 "malloc() failed. Function: aggregate_candidates_in_parallel()."
+#define MALLOC_ERR_6039 "malloc() failed. Function: init_aggregate_memo()."
+#define MALLOC_ERR_6040 "malloc() failed. Function: build_cluster_index()."
+#define MALLOC_ERR_6041 "malloc() failed. Function: find_word_spans()."
 
 /* ==== Macro function ==== */
 
 #define ARR_SIZE(a) (sizeof((a))/sizeof((a[0])))
 
+/* The row j of a {struct CandidateGroup}: the elements of the constants of the
+ candidate (from index 1 on, like ppWord), and its wildcard ranges. */
+#define CANDIDATE_WORDS(pGroup, j) \
+  ((pGroup)->ppWords + (j) * ((pGroup)->constants + 1))
+#define CANDIDATE_WILDCARDS(pGroup, j) \
+  ((pGroup)->pWildcards + (j) * 2 * ((pGroup)->constants + 1))
+
 
 #ifdef __cplusplus
 }
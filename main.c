@@ -41,6 +41,9 @@
 #include "output.h"
 #include "free_resource.h"
 #include "utility.h"
+#include "token_cache.h"
+#include "hash_table_processing.h"
+#include "candidate_store.h"
 
 int main(int argc, char **argv)
 {
@@ -101,7 +104,8 @@ int main(int argc, char **argv)
   /*Tag: Optional, One pass over the data set*/
   /*Very useful in mining process of large log files, e.g. more than 1GB. It
    significantly optimizes memory consumption.*/
-  if (param.wordSketchSize)
+  /*In '--wsample' mode, the sketch is built in Step1.B.*/
+  if (param.wordSketchSize && !param.wordSampleRate)
   {
     step_1_create_word_sketch(&param);
     param.totalLineNum = param.linecount * param.dataPassTimes;
@@ -123,6 +127,11 @@ int main(int argc, char **argv)
   
   param.freWordNum = step_1_find_frequent_words(&param, totalWordNum);
   
+  /*No word is added to the word table after this, it is only searched, also
+   by several threads at the same time. Most of the searched words are not in
+   it, which is why it gets a perfect hash function with a filter.*/
+  freeze_hash_table(&param.wordTable, 1, &param);
+  
   /*Step1.D Debug_1 mode: print frequent words*/
   /*Tag: Optional*/
   if (param.debug == 1)
@@ -138,6 +147,15 @@ int main(int argc, char **argv)
     return 0;
   }
   
+  /*Step1.F Build token cache*/
+  /*Tag: Optional*/
+  /*The cached lines replace the tokenizing and word lookups of the
+   following passes over the data set.*/
+  if (param.pTokenCache)
+  {
+    step_1_build_token_cache(&param);
+  }
+  
   /* ######## #### ## Step2 Cluster Candidates ## #### ######## */
   
   /*Step2.A Create cluster candidate sketch*/
@@ -151,6 +169,10 @@ int main(int argc, char **argv)
   /*Tag: One pass over the data set*/
   step_2_find_cluster_candidates(&param);
   
+  /*The candidates are complete, copy them into the column store, which the
+   following steps scan.*/
+  build_candidate_store(&param);
+  
   /*Step2.C Aggregate support*/
   /*Tag: Optional*/
   if (param.bAggrsupFlag)
@@ -179,19 +201,36 @@ int main(int argc, char **argv)
   sprintf(logStr, "%s cluster were found.", digit);
   log_msg(logStr, LOG_NOTICE, &param);
   
-  /*Step3.B Join clusters*/
+  /*Step3.B Find word dependencies*/
+  /*Tag: Optional, One pass over the data set*/
+  /*With '--wdeppass', the word dependencies are only counted for the
+   constants of the clusters, instead of in Step2.B.*/
+  if (param.wordWeightThreshold && param.bWordDepPassFlag)
+  {
+    step_3_find_word_deps(&param);
+  }
+  
+  /*Step3.C Join clusters*/
   /*Tag: Optional*/
   if (param.wordWeightThreshold)
   {
     step_3_join_clusters(&param);
   }
   
-  /*Step3.C Print clusters*/
+  /*Step3.D Print clusters*/
   if (param.clusterNum)
   {
     step_3_print_clusters(&param);
   }
   
+  /*Step3.E Freeze cluster table*/
+  /*Tag: Optional*/
+  /*The table is complete, from now on it is only searched by Step4.A.*/
+  if (param.pOutlier)
+  {
+    freeze_hash_table(&param.clusterTable, 0, &param);
+  }
+  
   /* ######## #### ## Step4 Outliers ## #### ######## */
   
   /*Step4.A Find outliers*/
@@ -36,17 +36,27 @@ OBJECTDIR=${CND_BUILDDIR}/${CND_CONF}/${CND_PLATFORM}
 # Object Files
 OBJECTFILES= \
 	${OBJECTDIR}/aggregate_supports_heuristic.o \
+	${OBJECTDIR}/arena.o \
+	${OBJECTDIR}/candidate_store.o \
 	${OBJECTDIR}/cluster_candidates.o \
+	${OBJECTDIR}/cluster_index.o \
 	${OBJECTDIR}/clusters.o \
 	${OBJECTDIR}/free_resource.o \
 	${OBJECTDIR}/frequent_words.o \
 	${OBJECTDIR}/hash_table_processing.o \
+	${OBJECTDIR}/input_reader.o \
 	${OBJECTDIR}/join_clusters_heuristic.o \
 	${OBJECTDIR}/line_processing.o \
 	${OBJECTDIR}/main.o \
 	${OBJECTDIR}/outliers.o \
 	${OBJECTDIR}/output.o \
+	${OBJECTDIR}/output_writer.o \
+	${OBJECTDIR}/parallel_processing.o \
+	${OBJECTDIR}/perfect_hash.o \
 	${OBJECTDIR}/preparation.o \
+	${OBJECTDIR}/sketch.o \
+	${OBJECTDIR}/sorting.o \
+	${OBJECTDIR}/token_cache.o \
 	${OBJECTDIR}/utility.o \
 	${OBJECTDIR}/word_filter_search_replace.o
 
@@ -65,7 +75,7 @@ FFLAGS=
 ASFLAGS=
 
 # Link Libraries and Options
-LDLIBSOPTIONS=
+LDLIBSOPTIONS=-lpthread -lm
 
 # Build Targets
 .build-conf: ${BUILD_SUBPROJECTS}
@@ -80,11 +90,26 @@ ${OBJECTDIR}/aggregate_supports_heuristic.o: aggregate_supports_heuristic.c
 	${RM} "$@.d"
 	$(COMPILE.c) -O2 -std=c99 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/aggregate_supports_heuristic.o aggregate_supports_heuristic.c
 
+${OBJECTDIR}/arena.o: arena.c
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -std=c99 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/arena.o arena.c
+
+${OBJECTDIR}/candidate_store.o: candidate_store.c
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -std=c99 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/candidate_store.o candidate_store.c
+
 ${OBJECTDIR}/cluster_candidates.o: cluster_candidates.c
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
 	$(COMPILE.c) -O2 -std=c99 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/cluster_candidates.o cluster_candidates.c
 
+${OBJECTDIR}/cluster_index.o: cluster_index.c
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -std=c99 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/cluster_index.o cluster_index.c
+
 ${OBJECTDIR}/clusters.o: clusters.c
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
@@ -105,6 +130,11 @@ ${OBJECTDIR}/hash_table_processing.o: hash_table_processing.c
 	${RM} "$@.d"
 	$(COMPILE.c) -O2 -std=c99 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/hash_table_processing.o hash_table_processing.c
 
+${OBJECTDIR}/input_reader.o: input_reader.c
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -std=c99 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/input_reader.o input_reader.c
+
 ${OBJECTDIR}/join_clusters_heuristic.o: join_clusters_heuristic.c
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
@@ -130,11 +160,41 @@ ${OBJECTDIR}/output.o: output.c
 	${RM} "$@.d"
 	$(COMPILE.c) -O2 -std=c99 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/output.o output.c
 
+${OBJECTDIR}/output_writer.o: output_writer.c
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -std=c99 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/output_writer.o output_writer.c
+
+${OBJECTDIR}/parallel_processing.o: parallel_processing.c
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -std=c99 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/parallel_processing.o parallel_processing.c
+
+${OBJECTDIR}/perfect_hash.o: perfect_hash.c
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -std=c99 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/perfect_hash.o perfect_hash.c
+
 ${OBJECTDIR}/preparation.o: preparation.c
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
 	$(COMPILE.c) -O2 -std=c99 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/preparation.o preparation.c
 
+${OBJECTDIR}/sketch.o: sketch.c
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -std=c99 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/sketch.o sketch.c
+
+${OBJECTDIR}/sorting.o: sorting.c
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -std=c99 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/sorting.o sorting.c
+
+${OBJECTDIR}/token_cache.o: token_cache.c
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -std=c99 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/token_cache.o token_cache.c
+
 ${OBJECTDIR}/utility.o: utility.c
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
@@ -23,88 +23,249 @@
  * Created on November 30, 2016, 10:48 PM
  */
 
+/* For fileno(). */
+#define _POSIX_C_SOURCE 200112L
+
 #include "common_header.h"
 #include "outliers.h"
 
+#include <fcntl.h>     /* for open() */
 #include <string.h>    /* for strcmp(), strcpy(), etc. */
+#include <unistd.h>    /* for close() */
 
 #include "output.h"
 #include "line_processing.h"
 #include "hash_table_processing.h"
+#include "input_reader.h"
+#include "token_cache.h"
+#include "output_writer.h"
+#include "parallel_processing.h"
+
+static wordnumber_t find_outliers_in_region(struct InputChunk *pRegion,
+        struct OutputWriter *pWriter, struct Parameters *pParam);
+static wordnumber_t find_outliers_in_parallel(struct OutputWriter *pWriter,
+        struct Parameters *pParam);
+static void find_outliers_worker(struct WorkerContext *pWorker);
+static wordnumber_t find_outliers_from_cache(struct OutputWriter *pWriter,
+        struct Parameters *pParam);
 
+/* The outliers are written through a struct OutputWriter, which hands them to
+ write() in large blocks. The word table and the cluster table are only read
+ in this step, so the lines can be checked by several threads. */
 wordnumber_t step_4_find_outliers(struct Parameters *pParam)
 {
-  FILE *pOutliers;
-  FILE *pFile;
-  struct InputFile *pFilePtr;
+  struct OutputWriter writer;
+  struct InputChunk *pRegion;
   char logStr[MAXLOGMSGLEN];
-  char line[MAXLINELEN];
-  char key[MAXKEYLEN];
-  char words[MAXWORDS][MAXWORDLEN];
-  int len, wordcount, i;
-  struct Elem *pWord, *pElem;
   wordnumber_t outlierNum;
+  int fd;
   
-  outlierNum = 0;
-  
-  if (!(pOutliers = fopen(pParam->pOutlier, "w")))
+  if ((fd = open(pParam->pOutlier, O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0)
   {
     sprintf(logStr, "Can't open outliers file %s", pParam->pOutlier);
     log_msg(logStr, LOG_ERR, pParam);
     exit(1);
   }
   
-  for (pFilePtr = pParam->pInputFiles; pFilePtr; pFilePtr = pFilePtr->pNext)
+  init_output_writer(&writer, fd, pParam);
+  
+  if (pParam->threadNum > 1)
   {
-    if (!(pFile = fopen(pFilePtr->pName, "r")))
-    {
-      sprintf(logStr, "Can't open input file %s", pFilePtr->pName);
-      log_msg(logStr, LOG_ERR, pParam);
-      continue;
-    }
+    outlierNum = find_outliers_in_parallel(&writer, pParam);
+  }
+  else if (pParam->bTokenCacheReady)
+  {
+    outlierNum = find_outliers_from_cache(&writer, pParam);
+  }
+  else
+  {
+    pRegion = create_whole_input_region(pParam);
+    outlierNum = find_outliers_in_region(pRegion, &writer, pParam);
+    free_region(pRegion);
+  }
+  
+  free_output_writer(&writer, pParam);
+  close(fd);
+  
+  return outlierNum;
+}
+
+/* Write the lines of pRegion that do not belong to any cluster. */
+static wordnumber_t find_outliers_in_region(struct InputChunk *pRegion,
+        struct OutputWriter *pWriter, struct Parameters *pParam)
+{
+  struct RegionReader reader;
+  char *line;
+  int linelen;
+  wordnumber_t key[MAXWORDS + 1];
+  struct LineTokens tokens;
+  int keyLen, wordLen, wordcount, i;
+  struct Elem *pWord, *pElem;
+  char *pWordStr;
+  wordnumber_t outlierNum;
+  
+  outlierNum = 0;
+  
+  init_line_tokens(&tokens);
+  open_region(&reader, pRegion);
+  
+  while (read_region_line(&reader, &line, &linelen, pParam))
+  {
+    wordcount = find_word_spans(line, linelen, &tokens, pParam);
     
-    while (fgets(line, MAXLINELEN, pFile))
+    keyLen = 0;
+    
+    for (i = 0; i < wordcount; i++)
     {
-      len = (int) strlen(line);
-      if (line[len - 1] == '\n')
-      {
-        line[len - 1] = 0;
-      }
+      pWordStr = tokens.pText + tokens.words[i].offset;
+      wordLen = tokens.words[i].len;
       
-      wordcount = find_words(line, words, pParam);
-      
-      *key = 0;
-      
-      for (i = 0; i < wordcount; i++)
-      {
-        pWord = find_elem(words[i], pParam->ppWordTable,
-                  pParam->wordTableSize, pParam->wordTableSeed);
-        if (words[i][0] != 0 && pWord)
-        {
-          strcat(key, words[i]);
-          len = (int) strlen(key);
-          key[len] = CLUSTERSEP;
-          key[len + 1] = 0;
-        }
-      }
-      
-      if (*key == 0 && wordcount)
+      pWord = find_elem_with_hash(pWordStr, wordLen, tokens.words[i].hash,
+                    &pParam->wordTable);
+      if (wordLen != 0 && pWord)
       {
-        fprintf(pOutliers, "%s\n", line);
-        outlierNum++;
-        continue;
+        key[++keyLen] = pWord->number;
       }
-      
-      pElem = find_elem(key, pParam->ppClusterTable, pParam->clusterTableSize,
-                pParam->clusterTableSeed);
-      
-      if (!pElem || (pElem->count < pParam->support))
+    }
+    
+    if (!keyLen && wordcount)
+    {
+      writer_write(pWriter, line, linelen, pParam);
+      writer_putc(pWriter, '\n', pParam);
+      outlierNum++;
+      continue;
+    }
+    
+    key[0] = keyLen;
+    pElem = find_cluster_elem(key, &pParam->clusterTable);
+    
+    if (!pElem || (pElem->count < pParam->support))
+    {
+      writer_write(pWriter, line, linelen, pParam);
+      writer_putc(pWriter, '\n', pParam);
+      outlierNum++;
+    }
+  }
+  
+  free_line_tokens(&tokens);
+  
+  return outlierNum;
+}
+
+/* Find the outliers with pParam->threadNum worker threads, each of them checks
+ the lines of its own region. A worker writes its outliers into a temporary
+ file of its own, and the files are appended to the outliers file in the order
+ of the regions, which is the order of the lines in the input files. The
+ workers always read the input files, even if the token cache is ready, since
+ the cache is not split at the same lines as the input files. */
+static wordnumber_t find_outliers_in_parallel(struct OutputWriter *pWriter,
+        struct Parameters *pParam)
+{
+  struct WorkerContext *pWorkers;
+  wordnumber_t outlierNum;
+  int i;
+  
+  pWorkers = create_workers(pParam);
+  
+  for (i = 0; i < pParam->threadNum; i++)
+  {
+    if (!(pWorkers[i].pOutput = tmpfile()))
+    {
+      log_msg("Can't create temporary file for outliers", LOG_ERR, pParam);
+      exit(1);
+    }
+    
+    init_output_writer(&pWorkers[i].param.outputWriter, 
+               fileno(pWorkers[i].pOutput), pParam);
+  }
+  
+  run_workers(pWorkers, find_outliers_worker, pParam);
+  
+  outlierNum = 0;
+  
+  for (i = 0; i < pParam->threadNum; i++)
+  {
+    writer_append_file(pWriter, fileno(pWorkers[i].pOutput), pParam);
+    fclose(pWorkers[i].pOutput);
+    outlierNum += pWorkers[i].elemNum;
+  }
+  
+  destroy_workers(pWorkers, pParam);
+  
+  return outlierNum;
+}
+
+/* The function run by every worker thread of find_outliers_in_parallel(). */
+static void find_outliers_worker(struct WorkerContext *pWorker)
+{
+  struct Parameters *pParam;
+  
+  pParam = &pWorker->param;
+  
+  pWorker->elemNum = find_outliers_in_region(pWorker->pRegion, 
+                         &pParam->outputWriter, pParam);
+  free_output_writer(&pParam->outputWriter, pParam);
+}
+
+/* This function works like step_4_find_outliers(), but the frequent words of a
+ line are read from the token cache of '--tokencache' option. The text of the
+ line is still read from the input files, since it is written to the outliers
+ file. The words replaced by '--wfilter' option are not used here, just as in
+ step_4_find_outliers(). */
+static wordnumber_t find_outliers_from_cache(struct OutputWriter *pWriter,
+        struct Parameters *pParam)
+{
+  struct InputChunk *pRegion;
+  struct RegionReader reader;
+  struct TokenCacheReader cacheReader;
+  struct CachedLine cachedLine;
+  char *line;
+  int linelen;
+  wordnumber_t key[MAXWORDS + 1];
+  int keyLen, i;
+  struct Elem *pWord, *pElem;
+  wordnumber_t outlierNum;
+  
+  outlierNum = 0;
+  
+  pRegion = create_whole_input_region(pParam);
+  open_region(&reader, pRegion);
+  open_token_cache_reader(&cacheReader, 0, pParam->cacheSize, pParam);
+  
+  while (read_region_line(&reader, &line, &linelen, pParam) &&
+       read_token_cache_line(&cacheReader, &cachedLine, pParam))
+  {
+    keyLen = 0;
+    
+    for (i = 0; i < cachedLine.wordcount; i++)
+    {
+      pWord = cachedLine.ppWords[i];
+      if (pWord && !cachedLine.bReplaced[i])
       {
-        fprintf(pOutliers, "%s\n", line);
-        outlierNum++;
+        key[++keyLen] = pWord->number;
       }
     }
+    
+    if (!keyLen && cachedLine.wordcount)
+    {
+      writer_write(pWriter, line, linelen, pParam);
+      writer_putc(pWriter, '\n', pParam);
+      outlierNum++;
+      continue;
+    }
+    
+    key[0] = keyLen;
+    pElem = find_cluster_elem(key, &pParam->clusterTable);
+    
+    if (!pElem || (pElem->count < pParam->support))
+    {
+      writer_write(pWriter, line, linelen, pParam);
+      writer_putc(pWriter, '\n', pParam);
+      outlierNum++;
+    }
   }
   
+  free_region(pRegion);
+  
   return outlierNum;
-}
\ No newline at end of file
+}
@@ -27,8 +27,11 @@
 #include "output.h"
 
 #include <string.h>    /* for strcmp(), strcpy(), etc. */
+#include <unistd.h>    /* for STDOUT_FILENO */
 
 #include "utility.h"
+#include "sorting.h"
+#include "output_writer.h"
 
 static void print_clusters_default_config(struct Parameters *pParam);
 static void print_clusters_constant_config(struct Parameters *pParam);
@@ -41,9 +44,19 @@ static void print_clusters_if_join_cluster_constant_1(
   struct Parameters *pParam);
 static void print_clusters_constant_1(struct Parameters *pParam);
 
-static void print_cluster(struct Cluster* pCluster);
-static void print_cluster_with_token(struct ClusterWithToken *pClusterWithToken,
-                struct Parameters *pParam);
+static void print_cluster(struct Cluster *pCluster, struct Token **ppToken,
+        struct Parameters *pParam);
+static void print_wildcard_text(int min, int max, struct Parameters *pParam);
+static void print_cluster_text(struct Cluster *pCluster, struct Token **ppToken,
+        struct Parameters *pParam);
+static int utf8_sequence_length(unsigned char *pStr, int len);
+static void print_json_string(struct Elem *pWord, struct Parameters *pParam);
+static void print_wildcard_ndjson(int min, int max, struct Parameters *pParam);
+static void print_cluster_ndjson(struct Cluster *pCluster,
+        struct Token **ppToken, struct Parameters *pParam);
+static void print_word_binary(struct Elem *pWord, struct Parameters *pParam);
+static void print_cluster_binary(struct Cluster *pCluster,
+        struct Token **ppToken, struct Parameters *pParam);
 
 /* Log message operator. It refines a message into timestamped format, and
  forwards it to user terminal. It also forwards the message to Syslog. */
@@ -105,7 +118,19 @@ void print_cluster_to_string(struct Cluster *pCluster,
 
 void step_3_print_clusters(struct Parameters *pParam)
 {
-  printf("\n");
+  init_output_writer(&pParam->outputWriter, STDOUT_FILENO, pParam);
+  
+  switch (pParam->outputFormat)
+  {
+    case OUTPUT_FORMAT_TEXT:
+      writer_putc(&pParam->outputWriter, '\n', pParam);
+      break;
+    case OUTPUT_FORMAT_BINARY:
+      writer_write(&pParam->outputWriter, BINARY_OUTPUT_MAGIC, 4, pParam);
+      break;
+    default:
+      break;
+  }
   
   switch (pParam->outputMode)
   {
@@ -122,7 +147,12 @@ void step_3_print_clusters(struct Parameters *pParam)
       break;
   }
   
-  printf("\n");
+  if (pParam->outputFormat == OUTPUT_FORMAT_TEXT)
+  {
+    writer_putc(&pParam->outputWriter, '\n', pParam);
+  }
+  
+  free_output_writer(&pParam->outputWriter, pParam);
 }
 
 //clusters are arranged according to their support value
@@ -186,8 +216,9 @@ static void print_clusters_if_join_cluster_default_0(
   int i, j, k;
   struct Cluster *pCluster;
   struct ClusterWithToken *pClusterWithToken, *ptr;
+  struct CandidateGroup *pGroup;
   struct Elem **ppSortedArray;
-  wordnumber_t toBeSortedNum;
+  wordnumber_t toBeSortedNum, printNum, r;
   
   toBeSortedNum = (pParam->clusterNum - pParam->joinedClusterInputNum) +
   pParam->joinedClusterOutputNum;
@@ -202,15 +233,15 @@ static void print_clusters_if_join_cluster_default_0(
   j = 0;
   for (i = 1; i <= pParam->biggestConstants; i++)
   {
-    pCluster = pParam->pClusterFamily[i];
-    while (pCluster)
+    pGroup = &pParam->pCandidateGroups[i];
+    for (r = 0; r < pGroup->num; r++)
     {
+      pCluster = pGroup->ppClusters[r];
       if (pCluster->bIsJoined == 0)
       {
         ppSortedArray[j] = pCluster->pElem;
         j++;
       }
-      pCluster = pCluster->pNext;
     }
     
     pClusterWithToken = pParam->pClusterWithTokenFamily[i];
@@ -222,9 +253,10 @@ static void print_clusters_if_join_cluster_default_0(
     }
   }
   
-  sort_elements(ppSortedArray, toBeSortedNum, pParam);
+  printNum = sort_top_elements(ppSortedArray, toBeSortedNum, pParam->topNum,
+                 compare_clusters, pParam);
   
-  for (k = 0; k < toBeSortedNum; k++)
+  for (k = 0; k < printNum; k++)
   {
     /* For clusters in pClusterFamily[], only print those who were not
      marked as bIsJoined. Those who were joined, will be printed later, by
@@ -232,11 +264,11 @@ static void print_clusters_if_join_cluster_default_0(
     if (ppSortedArray[k]->pCluster->bIsJoined == 1)
     {
       ptr = (struct ClusterWithToken *) ppSortedArray[k]->pCluster;
-      print_cluster_with_token(ptr, pParam);
+      print_cluster((struct Cluster *) ptr, ptr->ppToken, pParam);
     }
     else
     {
-      print_cluster(ppSortedArray[k]->pCluster);
+      print_cluster(ppSortedArray[k]->pCluster, 0, pParam);
     }
   }
   
@@ -338,8 +370,9 @@ static void print_clusters_if_join_cluster_default_0(
 static void print_clusters_default_0(struct Parameters *pParam)
 {
   int i, j, k;
-  struct Cluster *pCluster;
+  struct CandidateGroup *pGroup;
   struct Elem **ppSortedArray;
+  wordnumber_t printNum, r;
   
   ppSortedArray = (struct Elem **) malloc(sizeof(struct Elem *) *
                       pParam->clusterNum);
@@ -352,20 +385,20 @@ static void print_clusters_default_0(struct Parameters *pParam)
   j = 0;
   for (i = 1; i <= pParam->biggestConstants; i++)
   {
-    pCluster = pParam->pClusterFamily[i];
-    while (pCluster)
+    pGroup = &pParam->pCandidateGroups[i];
+    for (r = 0; r < pGroup->num; r++)
     {
-      ppSortedArray[j] = pCluster->pElem;
+      ppSortedArray[j] = pGroup->ppClusters[r]->pElem;
       j++;
-      pCluster = pCluster->pNext;
     }
   }
   
-  sort_elements(ppSortedArray, pParam->clusterNum, pParam);
+  printNum = sort_top_elements(ppSortedArray, pParam->clusterNum,
+                 pParam->topNum, compare_clusters, pParam);
   
-  for (k = 0; k < pParam->clusterNum; k++)
+  for (k = 0; k < printNum; k++)
   {
-    print_cluster(ppSortedArray[k]->pCluster);
+    print_cluster(ppSortedArray[k]->pCluster, 0, pParam);
   }
   
   free((void *) ppSortedArray);
@@ -381,27 +414,30 @@ static void print_clusters_if_join_cluster_constant_1(
   int i;
   struct Cluster *pCluster;
   struct ClusterWithToken *pClusterWithToken;
+  struct CandidateGroup *pGroup;
+  wordnumber_t r;
   
   for (i = 1; i <= pParam->biggestConstants; i++)
   {
     /* For clusters in pClusterFamily[], only print those who were not
      marked as bIsJoined. Those who were joined, will be printed later, by
      accessing pClusterWithTokenFamily[]. */
-    pCluster = pParam->pClusterFamily[i];
-    while (pCluster)
+    pGroup = &pParam->pCandidateGroups[i];
+    for (r = 0; r < pGroup->num; r++)
     {
+      pCluster = pGroup->ppClusters[r];
       if (pCluster->bIsJoined == 0)
       {
-        print_cluster(pCluster);
+        print_cluster(pCluster, 0, pParam);
         
       }
-      pCluster = pCluster->pNext;
     }
     
     pClusterWithToken = pParam->pClusterWithTokenFamily[i];
     while (pClusterWithToken)
     {
-      print_cluster_with_token(pClusterWithToken, pParam);
+      print_cluster((struct Cluster *) pClusterWithToken,
+              pClusterWithToken->ppToken, pParam);
       pClusterWithToken = pClusterWithToken->pNext;
     }
     
@@ -462,120 +498,342 @@ static void print_clusters_if_join_cluster_constant_1(
 static void print_clusters_constant_1(struct Parameters *pParam)
 {
   int i;
-  struct Cluster *pCluster;
+  struct CandidateGroup *pGroup;
+  wordnumber_t r;
   
   for (i = 1; i <= pParam->biggestConstants; i++)
   {
-    pCluster = pParam->pClusterFamily[i];
-    while (pCluster)
+    pGroup = &pParam->pCandidateGroups[i];
+    for (r = 0; r < pGroup->num; r++)
     {
-      print_cluster(pCluster);
-      pCluster = pCluster->pNext;
+      print_cluster(pGroup->ppClusters[r], 0, pParam);
     }
   }
 }
 
-static void print_cluster(struct Cluster* pCluster)
+/* Write one cluster in the format of '--outputformat' option. ppToken is the
+ token array of a joined cluster of '--wweight' option, or 0. */
+static void print_cluster(struct Cluster *pCluster, struct Token **ppToken,
+        struct Parameters *pParam)
 {
-  char digit[MAXDIGITBIT];
+  pParam->outputWriter.recordNum++;
+  
+  switch (pParam->outputFormat)
+  {
+    case OUTPUT_FORMAT_NDJSON:
+      print_cluster_ndjson(pCluster, ppToken, pParam);
+      break;
+    case OUTPUT_FORMAT_BINARY:
+      print_cluster_binary(pCluster, ppToken, pParam);
+      break;
+    default:
+      print_cluster_text(pCluster, ppToken, pParam);
+      break;
+  }
+}
+
+static void print_wildcard_text(int min, int max, struct Parameters *pParam)
+{
+  struct OutputWriter *pWriter;
+  
+  pWriter = &pParam->outputWriter;
+  
+  writer_write(pWriter, "*{", 2, pParam);
+  writer_put_number(pWriter, (unsigned long) min, 0, pParam);
+  writer_putc(pWriter, ',', pParam);
+  writer_put_number(pWriter, (unsigned long) max, 0, pParam);
+  writer_putc(pWriter, '}', pParam);
+}
+
+static void print_cluster_text(struct Cluster *pCluster, struct Token **ppToken,
+        struct Parameters *pParam)
+{
+  struct OutputWriter *pWriter;
+  struct Token *pToken;
   int i;
   
+  pWriter = &pParam->outputWriter;
+  
   for (i = 1; i <= pCluster->constants; i++)
   {
     if (pCluster->fullWildcard[i * 2 + 1])
     {
-      printf("*{%d,%d} ", pCluster->fullWildcard[i * 2],
-           pCluster->fullWildcard[i * 2 + 1]);
+      print_wildcard_text(pCluster->fullWildcard[i * 2],
+                pCluster->fullWildcard[i * 2 + 1], pParam);
+      writer_putc(pWriter, ' ', pParam);
+    }
+    
+    if (!ppToken || !ppToken[i])
+    {
+      writer_puts(pWriter, pCluster->ppWord[i]->pKey, pParam);
+    }
+    else if (!pParam->bDetailedTokenFlag && !ppToken[i]->pNext)
+    {
+      /* By default, a token is not marked if it is the only word. */
+      writer_puts(pWriter, ppToken[i]->pWord->pKey, pParam);
     }
-    printf("%s ", pCluster->ppWord[i]->pKey);
+    else
+    {
+      /* With '--detailtoken' option, a token is marked with (), no matter
+       how many words it contains. */
+      writer_putc(pWriter, '(', pParam);
+      for (pToken = ppToken[i]; pToken; pToken = pToken->pNext)
+      {
+        writer_puts(pWriter, pToken->pWord->pKey, pParam);
+        if (pToken->pNext)
+        {
+          writer_putc(pWriter, '|', pParam);
+        }
+      }
+      writer_putc(pWriter, ')', pParam);
+    }
+    
+    writer_putc(pWriter, ' ', pParam);
   }
   
   if (pCluster->fullWildcard[1])
   {
-    printf("*{%d,%d}", pCluster->fullWildcard[0],
-         pCluster->fullWildcard[1]);
+    print_wildcard_text(pCluster->fullWildcard[0], pCluster->fullWildcard[1],
+              pParam);
+  }
+  
+  writer_write(pWriter, "\nSupport : ", 11, pParam);
+  writer_put_number(pWriter, pCluster->count, 1, pParam);
+  writer_write(pWriter, "\n\n", 2, pParam);
+}
+
+/* Write a JSON string. The bytes of the word are copied as they are, except
+ for the quotation mark, the backslash and the control characters, which are
+ escaped. */
+/* The length of the valid UTF-8 sequence of 2 to 4 bytes at the beginning of
+ pStr[0 ... len - 1], or 0 if there is none. Overlong forms and surrogates are
+ not valid. */
+static int utf8_sequence_length(unsigned char *pStr, int len)
+{
+  unsigned char lo, hi;
+  int seqLen, i;
+  
+  lo = 0x80;
+  hi = 0xBF;
+  
+  if (pStr[0] >= 0xC2 && pStr[0] <= 0xDF)
+  {
+    seqLen = 2;
+  }
+  else if (pStr[0] >= 0xE0 && pStr[0] <= 0xEF)
+  {
+    seqLen = 3;
+    if (pStr[0] == 0xE0)
+    {
+      lo = 0xA0;
+    }
+    else if (pStr[0] == 0xED)
+    {
+      hi = 0x9F;
+    }
+  }
+  else if (pStr[0] >= 0xF0 && pStr[0] <= 0xF4)
+  {
+    seqLen = 4;
+    if (pStr[0] == 0xF0)
+    {
+      lo = 0x90;
+    }
+    else if (pStr[0] == 0xF4)
+    {
+      hi = 0x8F;
+    }
+  }
+  else
+  {
+    return 0;
   }
   
-  printf("\n");
+  if (seqLen > len || pStr[1] < lo || pStr[1] > hi)
+  {
+    return 0;
+  }
   
-  str_format_int_grouped(digit, pCluster->count);
-  printf("Support : %s\n\n", digit);
+  for (i = 2; i < seqLen; i++)
+  {
+    if (pStr[i] < 0x80 || pStr[i] > 0xBF)
+    {
+      return 0;
+    }
+  }
+  
+  return seqLen;
 }
 
-static void print_cluster_with_token(struct ClusterWithToken *pClusterWithToken,
-                struct Parameters *pParam)
+/* Write the key of pWord as a JSON string. The key is taken with its stored
+ length, so an embedded 0 is written as an escape, too. Valid UTF-8 sequences
+ are copied, and every other byte of 0x80 or more is written as \u00XX, so the
+ output is valid UTF-8 for any input. */
+static void print_json_string(struct Elem *pWord, struct Parameters *pParam)
 {
-  char digit[MAXDIGITBIT];
+  struct OutputWriter *pWriter;
+  static const char hex[] = "0123456789abcdef";
+  unsigned char *pStr;
+  unsigned char c;
+  int len, i, seqLen;
+  
+  pWriter = &pParam->outputWriter;
+  pStr = (unsigned char *) pWord->pKey;
+  len = pWord->keyLen;
+  
+  writer_putc(pWriter, '"', pParam);
+  
+  for (i = 0; i < len; i++)
+  {
+    c = pStr[i];
+    
+    if (c == '"' || c == '\\')
+    {
+      writer_putc(pWriter, '\\', pParam);
+      writer_putc(pWriter, (char) c, pParam);
+    }
+    else if (c >= 0x80 && (seqLen = utf8_sequence_length(pStr + i, len - i)))
+    {
+      writer_write(pWriter, (char *) pStr + i, seqLen, pParam);
+      i += seqLen - 1;
+    }
+    else if (c < 0x20 || c >= 0x80)
+    {
+      writer_write(pWriter, "\\u00", 4, pParam);
+      writer_putc(pWriter, hex[c >> 4], pParam);
+      writer_putc(pWriter, hex[c & 0xF], pParam);
+    }
+    else
+    {
+      writer_putc(pWriter, (char) c, pParam);
+    }
+  }
+  
+  writer_putc(pWriter, '"', pParam);
+}
+
+static void print_wildcard_ndjson(int min, int max, struct Parameters *pParam)
+{
+  struct OutputWriter *pWriter;
+  
+  pWriter = &pParam->outputWriter;
+  
+  writer_putc(pWriter, '[', pParam);
+  writer_put_number(pWriter, (unsigned long) min, 0, pParam);
+  writer_putc(pWriter, ',', pParam);
+  writer_put_number(pWriter, (unsigned long) max, 0, pParam);
+  writer_putc(pWriter, ']', pParam);
+}
+
+/* Write a cluster as a JSON object on a line of its own, see the help of
+ '--outputformat' option. */
+static void print_cluster_ndjson(struct Cluster *pCluster,
+        struct Token **ppToken, struct Parameters *pParam)
+{
+  struct OutputWriter *pWriter;
   struct Token *pToken;
   int i;
   
-  for (i = 1; i <= pClusterWithToken->constants; i++)
+  pWriter = &pParam->outputWriter;
+  
+  writer_puts(pWriter, "{\"id\":", pParam);
+  writer_put_number(pWriter, pWriter->recordNum, 0, pParam);
+  writer_puts(pWriter, ",\"support\":", pParam);
+  writer_put_number(pWriter, pCluster->count, 0, pParam);
+  writer_puts(pWriter, ",\"constants\":[", pParam);
+  
+  for (i = 1; i <= pCluster->constants; i++)
   {
-    if (pClusterWithToken->fullWildcard[i * 2 + 1])
+    if (i > 1)
     {
-      printf("*{%d,%d} ", pClusterWithToken->fullWildcard[i * 2],
-           pClusterWithToken->fullWildcard[i * 2 + 1]);
+      writer_putc(pWriter, ',', pParam);
     }
     
-    if (pClusterWithToken->ppToken[i] != 0)
+    if (!ppToken || !ppToken[i])
     {
-      if (pParam->bDetailedTokenFlag == 0)
-      {
-        /* This solution will not mark a token, if it is the only word.
-         */
-        if (pClusterWithToken->ppToken[i]->pNext != 0)
-        {
-          printf("(");
-          pToken = pClusterWithToken->ppToken[i];
-          while (pToken)
-          {
-            printf("%s", pToken->pWord->pKey);
-            if (pToken->pNext)
-            {
-              printf("|");
-            }
-            pToken = pToken->pNext;
-          }
-          printf(") ");
-        }
-        else
-        {
-          printf("%s ", pClusterWithToken->ppToken[i]->pWord->pKey);
-        }
-      }
-      else
-      {
-        /* This solution marks a token with (), no matter how many words
-         it contains. */
-        printf("(");
-        pToken = pClusterWithToken->ppToken[i];
-        while (pToken)
-        {
-          printf("%s", pToken->pWord->pKey);
-          if (pToken->pNext)
-          {
-            printf("|");
-          }
-          pToken = pToken->pNext;
-        }
-        printf(") ");
-      }
-      
+      print_json_string(pCluster->ppWord[i], pParam);
+      continue;
     }
-    else
+    
+    writer_putc(pWriter, '[', pParam);
+    for (pToken = ppToken[i]; pToken; pToken = pToken->pNext)
     {
-      printf("%s ", pClusterWithToken->ppWord[i]->pKey);
+      print_json_string(pToken->pWord, pParam);
+      if (pToken->pNext)
+      {
+        writer_putc(pWriter, ',', pParam);
+      }
     }
+    writer_putc(pWriter, ']', pParam);
   }
   
-  if (pClusterWithToken->fullWildcard[1])
+  writer_puts(pWriter, "],\"wildcards\":[", pParam);
+  
+  for (i = 1; i <= pCluster->constants; i++)
   {
-    printf("*{%d,%d}", pClusterWithToken->fullWildcard[0],
-         pClusterWithToken->fullWildcard[1]);
+    print_wildcard_ndjson(pCluster->fullWildcard[i * 2],
+                pCluster->fullWildcard[i * 2 + 1], pParam);
+    writer_putc(pWriter, ',', pParam);
   }
   
-  printf("\n");
+  print_wildcard_ndjson(pCluster->fullWildcard[0], pCluster->fullWildcard[1],
+              pParam);
+  writer_write(pWriter, "]}\n", 3, pParam);
+}
+
+static void print_word_binary(struct Elem *pWord, struct Parameters *pParam)
+{
+  writer_put_uint(&pParam->outputWriter, (unsigned long) pWord->keyLen, 4,
+          pParam);
+  writer_write(&pParam->outputWriter, pWord->pKey, pWord->keyLen, pParam);
+}
+
+/* Write a cluster in the binary format, see the help of '--outputformat'
+ option. The output begins with BINARY_OUTPUT_MAGIC, which is written by
+ step_3_print_clusters(). */
+static void print_cluster_binary(struct Cluster *pCluster,
+        struct Token **ppToken, struct Parameters *pParam)
+{
+  struct OutputWriter *pWriter;
+  struct Token *pToken;
+  unsigned long wordNum;
+  int i;
+  
+  pWriter = &pParam->outputWriter;
+  
+  writer_put_uint(pWriter, pWriter->recordNum, 8, pParam);
+  writer_put_uint(pWriter, pCluster->count, 8, pParam);
+  writer_put_uint(pWriter, (unsigned long) pCluster->constants, 4, pParam);
   
-  str_format_int_grouped(digit, pClusterWithToken->count);
-  printf("Support : %s\n\n", digit);
-}
\ No newline at end of file
+  for (i = 1; i <= pCluster->constants; i++)
+  {
+    writer_put_uint(pWriter, (unsigned long) pCluster->fullWildcard[i * 2], 4,
+            pParam);
+    writer_put_uint(pWriter, (unsigned long) pCluster->fullWildcard[i * 2 + 1],
+            4, pParam);
+    
+    if (!ppToken || !ppToken[i])
+    {
+      writer_put_uint(pWriter, 1, 4, pParam);
+      print_word_binary(pCluster->ppWord[i], pParam);
+      continue;
+    }
+    
+    wordNum = 0;
+    for (pToken = ppToken[i]; pToken; pToken = pToken->pNext)
+    {
+      wordNum++;
+    }
+    
+    writer_put_uint(pWriter, wordNum, 4, pParam);
+    for (pToken = ppToken[i]; pToken; pToken = pToken->pNext)
+    {
+      print_word_binary(pToken->pWord, pParam);
+    }
+  }
+  
+  writer_put_uint(pWriter, (unsigned long) pCluster->fullWildcard[0], 4,
+          pParam);
+  writer_put_uint(pWriter, (unsigned long) pCluster->fullWildcard[1], 4,
+          pParam);
+}
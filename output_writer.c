@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2016 Zhuge Chen, Risto Vaarandi and Mauno Pihelgas
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/* 
+ * File:   output_writer.c
+ * 
+ * Content: Functions of the buffered writer, through which the clusters and
+ * the outliers are written.
+ *
+ * The output is collected in a buffer of OUTPUT_BUFFER_SIZE bytes, which is
+ * handed to write() when it is full, so a cluster or an outlier line does not
+ * cost a call into the C library per piece of it. Numbers are formatted by the
+ * writer itself, in decimal (optionally grouped with commas, like
+ * str_format_int_grouped()) or as little-endian binary integers.
+ *
+ * Created on October 16, 2026, 10:40 PM
+ */
+
+#include "common_header.h"
+#include "output_writer.h"
+
+#include <errno.h>     /* for errno and EINTR */
+#include <string.h>    /* for memcpy() and strlen() */
+#include <unistd.h>    /* for read(), write() and lseek() */
+
+#include "output.h"
+
+static void write_all(int fd, const char *pData, size_t len, 
+        struct Parameters *pParam);
+
+/* Prepare a writer of the file descriptor fd. The writer does not close fd. */
+void init_output_writer(struct OutputWriter *pWriter, int fd, 
+        struct Parameters *pParam)
+{
+  pWriter->fd = fd;
+  pWriter->size = OUTPUT_BUFFER_SIZE;
+  pWriter->used = 0;
+  pWriter->recordNum = 0;
+  
+  pWriter->pBuffer = (char *) malloc(pWriter->size);
+  if (!pWriter->pBuffer)
+  {
+    log_msg(MALLOC_ERR_6034, LOG_ERR, pParam);
+    exit(1);
+  }
+}
+
+/* Hand len bytes to write(), which may take less of them at a time. */
+static void write_all(int fd, const char *pData, size_t len, 
+        struct Parameters *pParam)
+{
+  ssize_t written;
+  
+  while (len)
+  {
+    written = write(fd, pData, len);
+    
+    if (written < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      
+      log_msg("Can't write output", LOG_ERR, pParam);
+      exit(1);
+    }
+    
+    pData += written;
+    len -= (size_t) written;
+  }
+}
+
+void flush_output_writer(struct OutputWriter *pWriter, 
+        struct Parameters *pParam)
+{
+  write_all(pWriter->fd, pWriter->pBuffer, pWriter->used, pParam);
+  pWriter->used = 0;
+}
+
+/* Flush the writer and release its buffer. */
+void free_output_writer(struct OutputWriter *pWriter, 
+        struct Parameters *pParam)
+{
+  if (pWriter->pBuffer)
+  {
+    flush_output_writer(pWriter, pParam);
+    free((void *) pWriter->pBuffer);
+    pWriter->pBuffer = 0;
+  }
+}
+
+/* Append len bytes to the output. Data that does not fit into the buffer even
+ when it is empty is written directly. */
+void writer_write(struct OutputWriter *pWriter, const char *pData, size_t len,
+        struct Parameters *pParam)
+{
+  if (pWriter->used + len > pWriter->size)
+  {
+    flush_output_writer(pWriter, pParam);
+    
+    if (len > pWriter->size)
+    {
+      write_all(pWriter->fd, pData, len, pParam);
+      return;
+    }
+  }
+  
+  memcpy(pWriter->pBuffer + pWriter->used, pData, len);
+  pWriter->used += len;
+}
+
+void writer_puts(struct OutputWriter *pWriter, const char *pStr, 
+        struct Parameters *pParam)
+{
+  writer_write(pWriter, pStr, strlen(pStr), pParam);
+}
+
+void writer_putc(struct OutputWriter *pWriter, char c, 
+        struct Parameters *pParam)
+{
+  if (pWriter->used == pWriter->size)
+  {
+    flush_output_writer(pWriter, pParam);
+  }
+  
+  pWriter->pBuffer[pWriter->used++] = c;
+}
+
+/* Append num in decimal. If bGrouped is set, a comma is put between every
+ three digits, e.g. 1,234,567. */
+void writer_put_number(struct OutputWriter *pWriter, unsigned long num, 
+        char bGrouped, struct Parameters *pParam)
+{
+  char digits[MAXDIGITBIT];
+  int i, n;
+  
+  i = MAXDIGITBIT;
+  n = 0;
+  
+  do
+  {
+    if (bGrouped && n && n % 3 == 0)
+    {
+      digits[--i] = ',';
+    }
+    digits[--i] = (char) ('0' + num % 10);
+    num /= 10;
+    n++;
+  }
+  while (num);
+  
+  writer_write(pWriter, digits + i, MAXDIGITBIT - i, pParam);
+}
+
+/* Append the whole content of the file fd, e.g. a temporary file that another
+ writer has written and flushed. The file is read from its beginning through
+ the buffer of the writer. */
+void writer_append_file(struct OutputWriter *pWriter, int fd, 
+        struct Parameters *pParam)
+{
+  ssize_t len;
+  
+  flush_output_writer(pWriter, pParam);
+  
+  if (lseek(fd, 0, SEEK_SET) < 0)
+  {
+    log_msg("Can't rewind temporary output file", LOG_ERR, pParam);
+    exit(1);
+  }
+  
+  while ((len = read(fd, pWriter->pBuffer, pWriter->size)) != 0)
+  {
+    if (len < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      
+      log_msg("Can't read temporary output file", LOG_ERR, pParam);
+      exit(1);
+    }
+    
+    write_all(pWriter->fd, pWriter->pBuffer, (size_t) len, pParam);
+  }
+}
+
+/* Append the lowest size bytes of value as a little-endian integer. */
+void writer_put_uint(struct OutputWriter *pWriter, unsigned long value, 
+        int size, struct Parameters *pParam)
+{
+  char bytes[sizeof(unsigned long)];
+  int i;
+  
+  for (i = 0; i < size; i++)
+  {
+    bytes[i] = (char) (value & 0xFF);
+    value >>= 8;
+  }
+  
+  writer_write(pWriter, bytes, size, pParam);
+}
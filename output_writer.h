@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2016 Zhuge Chen, Risto Vaarandi and Mauno Pihelgas
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/* 
+ * File:   output_writer.h
+ * 
+ * Content: Declarations of global functions in output_writer.c .
+ *
+ * Created on October 16, 2026, 10:40 PM
+ */
+
+#ifndef OUTPUT_WRITER_H
+#define OUTPUT_WRITER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  
+#include <stddef.h>
+  
+void init_output_writer(struct OutputWriter *pWriter, int fd, 
+        struct Parameters *pParam);
+void flush_output_writer(struct OutputWriter *pWriter, 
+        struct Parameters *pParam);
+void free_output_writer(struct OutputWriter *pWriter, 
+        struct Parameters *pParam);
+void writer_write(struct OutputWriter *pWriter, const char *pData, size_t len,
+        struct Parameters *pParam);
+void writer_puts(struct OutputWriter *pWriter, const char *pStr, 
+        struct Parameters *pParam);
+void writer_putc(struct OutputWriter *pWriter, char c, 
+        struct Parameters *pParam);
+void writer_put_number(struct OutputWriter *pWriter, unsigned long num, 
+        char bGrouped, struct Parameters *pParam);
+void writer_put_uint(struct OutputWriter *pWriter, unsigned long value, 
+        int size, struct Parameters *pParam);
+void writer_append_file(struct OutputWriter *pWriter, int fd, 
+        struct Parameters *pParam);
+  
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OUTPUT_WRITER_H */
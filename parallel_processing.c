@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2016 Zhuge Chen, Risto Vaarandi and Mauno Pihelgas
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/* 
+ * File:   parallel_processing.c
+ * 
+ * Content: Functions related to multi-threaded processing ('--threads'
+ * option): splitting the input files into regions and running worker threads.
+ *
+ * Created on October 16, 2026, 9:10 AM
+ */
+
+#include "common_header.h"
+#include "parallel_processing.h"
+
+#include <pthread.h>   /* for pthread_create() and pthread_join() */
+#include <regex.h>     /* for regcomp() and regexec() */
+#include <string.h>    /* for strcmp(), strcpy(), etc. */
+#include <sys/stat.h>  /* for stat() */
+
+#include "output.h"
+#include "input_reader.h"
+#include "arena.h"
+
+static struct InputChunk **split_input_into_regions(struct Parameters *pParam);
+static void clone_parameters(struct Parameters *pDst, 
+        struct Parameters *pSrc);
+static void *worker_thread_main(void *pArg);
+
+/* Prepare pParam->threadNum workers. Each of them gets its own region of the
+ data set and its own copy of the parameters. */
+struct WorkerContext *create_workers(struct Parameters *pParam)
+{
+  struct WorkerContext *pWorkers;
+  struct InputChunk **ppRegions;
+  int i;
+  
+  pWorkers = (struct WorkerContext *) malloc(sizeof(struct WorkerContext) *
+                         pParam->threadNum);
+  if (!pWorkers)
+  {
+    log_msg(MALLOC_ERR_6021, LOG_ERR, pParam);
+    exit(1);
+  }
+  
+  ppRegions = split_input_into_regions(pParam);
+  
+  for (i = 0; i < pParam->threadNum; i++)
+  {
+    pWorkers[i].id = i;
+    clone_parameters(&pWorkers[i].param, pParam);
+    pWorkers[i].pGlobalParam = pParam;
+    pWorkers[i].pRegion = ppRegions[i];
+    pWorkers[i].pWork = 0;
+    pWorkers[i].linecount = 0;
+    pWorkers[i].elemNum = 0;
+    pWorkers[i].pOutput = 0;
+  }
+  
+  free((void *) ppRegions);
+  
+  return pWorkers;
+}
+
+/* Run pWork() in every worker, each in its own thread, and wait until all of
+ them are done. */
+void run_workers(struct WorkerContext *pWorkers, 
+        void (*pWork)(struct WorkerContext *), struct Parameters *pParam)
+{
+  pthread_t threads[MAXTHREADS];
+  pthread_attr_t attr;
+  char logStr[MAXLOGMSGLEN];
+  int i;
+  
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, WORKER_STACK_SIZE);
+  
+  for (i = 0; i < pParam->threadNum; i++)
+  {
+    pWorkers[i].pWork = pWork;
+    if (pthread_create(&threads[i], &attr, worker_thread_main, &pWorkers[i]))
+    {
+      sprintf(logStr, "Can't create worker thread %d", i);
+      log_msg(logStr, LOG_ERR, pParam);
+      exit(1);
+    }
+  }
+  
+  for (i = 0; i < pParam->threadNum; i++)
+  {
+    pthread_join(threads[i], 0);
+  }
+  
+  pthread_attr_destroy(&attr);
+}
+
+void destroy_workers(struct WorkerContext *pWorkers, struct Parameters *pParam)
+{
+  int i;
+  
+  for (i = 0; i < pParam->threadNum; i++)
+  {
+    regfree(&pWorkers[i].param.delim_regex);
+    if (pParam->pFilter)
+    {
+      regfree(&pWorkers[i].param.filter_regex);
+    }
+    if (pParam->pWordFilter)
+    {
+      regfree(&pWorkers[i].param.wfilter_regex);
+    }
+    if (pParam->pWordSearch)
+    {
+      regfree(&pWorkers[i].param.wsearch_regex);
+    }
+    
+    free_region(pWorkers[i].pRegion);
+  }
+  
+  free((void *) pWorkers);
+}
+
+/* Divide the data set into pParam->threadNum regions of roughly equal size.
+ The input files are considered as one concatenated byte stream, which is cut
+ into consecutive regions. Therefore the order of the lines is kept: all the
+ lines of region i come before the lines of region i + 1. */
+static struct InputChunk **split_input_into_regions(struct Parameters *pParam)
+{
+  struct InputChunk **ppRegions;
+  struct InputFile *pFilePtr;
+  struct stat fileStat;
+  long long totalSize, quota, filled;
+  long offset, take, size;
+  int region;
+  
+  ppRegions = (struct InputChunk **) malloc(sizeof(struct InputChunk *) *
+                        pParam->threadNum);
+  if (!ppRegions)
+  {
+    log_msg(MALLOC_ERR_6022, LOG_ERR, pParam);
+    exit(1);
+  }
+  
+  for (region = 0; region < pParam->threadNum; region++)
+  {
+    ppRegions[region] = 0;
+  }
+  
+  totalSize = 0;
+  for (pFilePtr = pParam->pInputFiles; pFilePtr; pFilePtr = pFilePtr->pNext)
+  {
+    if (!stat(pFilePtr->pName, &fileStat) && S_ISREG(fileStat.st_mode))
+    {
+      totalSize += fileStat.st_size;
+    }
+  }
+  
+  quota = totalSize / pParam->threadNum + 1;
+  filled = 0;
+  region = 0;
+  
+  for (pFilePtr = pParam->pInputFiles; pFilePtr; pFilePtr = pFilePtr->pNext)
+  {
+    if (stat(pFilePtr->pName, &fileStat) || !S_ISREG(fileStat.st_mode))
+    {
+      /* Unknown size. The whole file goes to the current region. If it
+       can't be opened at all, the worker reports it. */
+      add_chunk_to_region(&ppRegions[region], pFilePtr, 0, -1, pParam);
+      continue;
+    }
+    
+    size = (long) fileStat.st_size;
+    offset = 0;
+    
+    do
+    {
+      take = size - offset;
+      if (take > quota - filled)
+      {
+        take = (long) (quota - filled);
+      }
+      
+      add_chunk_to_region(&ppRegions[region], pFilePtr, offset, offset + take,
+             pParam);
+      
+      offset += take;
+      filled += take;
+      
+      if (filled >= quota && region < pParam->threadNum - 1)
+      {
+        region++;
+        filled = 0;
+      }
+    } while (offset < size);
+  }
+  
+  return ppRegions;
+}
+
+/* Copy the parameters for a worker thread. The regular expressions were
+ already validated by step_0_validate_parameters(), so they are compiled here
+ without checking. */
+static void clone_parameters(struct Parameters *pDst, 
+        struct Parameters *pSrc)
+{
+  memcpy(pDst, pSrc, sizeof(struct Parameters));
+  
+  /* Every worker allocates its elements from its own arenas. */
+  init_arena(&pDst->wordArena, ARENA_BLOCK_SIZE);
+  init_arena(&pDst->clusterArena, ARENA_BLOCK_SIZE);
+  init_arena(&pDst->candidateArena, ARENA_BLOCK_SIZE);
+  
+  if (pSrc->pDelim)
+  {
+    regcomp(&pDst->delim_regex, pSrc->pDelim, REG_EXTENDED);
+  }
+  else
+  {
+    regcomp(&pDst->delim_regex, DEF_WORD_DELM, REG_EXTENDED);
+  }
+  
+  if (pSrc->pFilter)
+  {
+    regcomp(&pDst->filter_regex, pSrc->pFilter, REG_EXTENDED);
+  }
+  
+  if (pSrc->pWordFilter)
+  {
+    regcomp(&pDst->wfilter_regex, pSrc->pWordFilter, REG_EXTENDED);
+  }
+  
+  if (pSrc->pWordSearch)
+  {
+    regcomp(&pDst->wsearch_regex, pSrc->pWordSearch, REG_EXTENDED);
+  }
+}
+
+static void *worker_thread_main(void *pArg)
+{
+  struct WorkerContext *pWorker = (struct WorkerContext *) pArg;
+  
+  pWorker->pWork(pWorker);
+  
+  return 0;
+}
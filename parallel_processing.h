@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2016 Zhuge Chen, Risto Vaarandi and Mauno Pihelgas
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/* 
+ * File:   parallel_processing.h
+ * 
+ * Content: Declarations of global functions in parallel_processing.c .
+ *
+ * Created on October 16, 2026, 9:12 AM
+ */
+
+#ifndef PARALLEL_PROCESSING_H
+#define PARALLEL_PROCESSING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct WorkerContext *create_workers(struct Parameters *pParam);
+void run_workers(struct WorkerContext *pWorkers, 
+        void (*pWork)(struct WorkerContext *), struct Parameters *pParam);
+void destroy_workers(struct WorkerContext *pWorkers, struct Parameters *pParam);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PARALLEL_PROCESSING_H */
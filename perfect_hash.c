@@ -0,0 +1,397 @@
+/*
+ * Copyright (C) 2016 Zhuge Chen, Risto Vaarandi and Mauno Pihelgas
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/* 
+ * File:   perfect_hash.c
+ * 
+ * Content: Functions related to the minimal perfect hash function of a frozen
+ * hash table.
+ *
+ * The keys are divided into buckets by their hash values. The buckets are
+ * processed from the biggest to the smallest, and for every bucket the pilots
+ * 0, 1, 2, ... are tried until one of them sends all of its keys to slots that
+ * are still free. The slot of a key is then found with one look at the pilot
+ * of its bucket, and every slot holds exactly one key. A key that is not in the
+ * table also gets a slot, so the stored hash value (the fingerprint) and the
+ * key itself are still compared by the caller.
+ *
+ * Most of the searched words are not frequent, so a Bloom filter is checked
+ * first. All the bits of a key are in one word of the filter, which costs one
+ * memory access, and the filter is much smaller than the slot array.
+ *
+ * Created on October 16, 2026, 11:50 PM
+ */
+
+#include "common_header.h"
+#include "perfect_hash.h"
+
+#include <string.h>    /* for memset() */
+
+#include "output.h"
+
+static tableindex_t mix_hash(tableindex_t x);
+static tableindex_t filter_bits(tableindex_t mixed);
+static char find_pilots(struct PerfectHash *pHash, struct HashSlot *pSlots,
+        tableindex_t n, tableindex_t *pMixed, tableindex_t *pKeys,
+        tableindex_t *pStart, char *pTaken, struct Parameters *pParam);
+static void build_filter(struct PerfectHash *pHash, struct HashSlot *pSlots,
+        tableindex_t n, struct Parameters *pParam);
+
+/* The slot of a key in a table of n slots (n < 2^32), given the mixed value of
+ its hash value and the pilot of its bucket. The top 32 bits of the mixed value
+ are changed by the pilot and scaled to [0, n) with a multiplication, which is
+ cheaper than a division. The bucket is given by the low bits of the mixed
+ value, so the keys of a bucket do not share the bits used here. */
+#define PILOT_SLOT(mixed, pilot, n) \
+  (((((mixed) ^ (tableindex_t) (pilot) * \
+  (tableindex_t) 0x9E3779B97F4A7C15ULL) >> 32) * (n)) >> 32)
+
+/* The word of a key in the Bloom filter, given filterMixed of filter_bits(). */
+#define FILTER_WORD(pHash, filterMixed) \
+  ((pHash)->pFilter[((filterMixed) >> 32) & (pHash)->filterMask])
+
+/* The finalizer of SplitMix64. A hash value is mixed once with the seed of the
+ perfect hash function. Its bucket is taken from the low bits of the result
+ and its slot from the high bits, so that a new seed gives new buckets and
+ slots. The filter uses a second round of mixing, see filter_bits(). */
+static tableindex_t mix_hash(tableindex_t x)
+{
+  x ^= x >> 30;
+  x *= (tableindex_t) 0xBF58476D1CE4E5B9ULL;
+  x ^= x >> 27;
+  x *= (tableindex_t) 0x94D049BB133111EBULL;
+  x ^= x >> 31;
+  
+  return x;
+}
+
+/* The FILTER_HASH_NUM bits of a key in its word of the Bloom filter. They are
+ taken from 6-bit pieces at the bottom of filterMixed, which is the mixed 
+ value of the key mixed once more, so that they do not depend on the bits of
+ the bucket. The word itself is chosen with the bits of filterMixed from 32
+ upwards, see FILTER_WORD. */
+static tableindex_t filter_bits(tableindex_t filterMixed)
+{
+  tableindex_t bits;
+  int i;
+  
+  bits = 0;
+  for (i = 0; i < FILTER_HASH_NUM; i++)
+  {
+    bits |= (tableindex_t) 1 << ((filterMixed >> (i * 6)) & 63);
+  }
+  
+  return bits;
+}
+
+/* Build a perfect hash function for the n elements of pSlots (all occupied),
+ whose hash values are the ones of a table with the given seed. Return a new
+ array of n slots, in which every element is in the slot given by
+ find_perfect_slot(). If the function can not be found, e.g. because two keys
+ have the same hash value, 0 is returned and pHash->pPilots is 0. */
+struct HashSlot *build_perfect_hash(struct PerfectHash *pHash, 
+        struct HashSlot *pSlots, tableindex_t n, tableindex_t seed,
+        struct Parameters *pParam)
+{
+  struct HashSlot *pNewSlots;
+  tableindex_t *pMixed, *pKeys, *pStart;
+  tableindex_t bucketNum, i, mixed;
+  char *pTaken;
+  char bFound;
+  int attempt;
+  
+  pHash->pPilots = 0;
+  pHash->pFilter = 0;
+  
+  if (!n || n > 0xFFFFFFFFUL)
+  {
+    return 0;
+  }
+  
+  bucketNum = 1;
+  while (bucketNum * PERFECT_HASH_BUCKET_SIZE < n)
+  {
+    bucketNum <<= 1;
+  }
+  pHash->bucketMask = bucketNum - 1;
+  
+  pHash->pPilots = (unsigned int *) malloc(sizeof(unsigned int) * bucketNum);
+  pMixed = (tableindex_t *) malloc(sizeof(tableindex_t) * n);
+  pKeys = (tableindex_t *) malloc(sizeof(tableindex_t) * n);
+  pStart = (tableindex_t *) malloc(sizeof(tableindex_t) * (bucketNum + 1));
+  pTaken = (char *) malloc(n);
+  if (!pHash->pPilots || !pMixed || !pKeys || !pStart || !pTaken)
+  {
+    log_msg(MALLOC_ERR_6035, LOG_ERR, pParam);
+    exit(1);
+  }
+  
+  bFound = 0;
+  for (attempt = 0; attempt < PERFECT_HASH_TRIES && !bFound; attempt++)
+  {
+    pHash->seed = mix_hash(seed + (tableindex_t) attempt);
+    bFound = find_pilots(pHash, pSlots, n, pMixed, pKeys, pStart, pTaken, 
+               pParam);
+  }
+  
+  free((void *) pMixed);
+  free((void *) pKeys);
+  free((void *) pStart);
+  free((void *) pTaken);
+  
+  if (!bFound)
+  {
+    free((void *) pHash->pPilots);
+    pHash->pPilots = 0;
+    return 0;
+  }
+  
+  pNewSlots = (struct HashSlot *) malloc(sizeof(struct HashSlot) * n);
+  if (!pNewSlots)
+  {
+    log_msg(MALLOC_ERR_6035, LOG_ERR, pParam);
+    exit(1);
+  }
+  
+  for (i = 0; i < n; i++)
+  {
+    mixed = mix_hash(pSlots[i].hash ^ pHash->seed);
+    pNewSlots[PILOT_SLOT(mixed, pHash->pPilots[mixed & pHash->bucketMask], 
+               n)] = pSlots[i];
+  }
+  
+  build_filter(pHash, pSlots, n, pParam);
+  
+  return pNewSlots;
+}
+
+/* One attempt with the current pHash->seed. The keys are sorted into their
+ buckets with a counting sort: pStart[b] is the first index of bucket b in
+ pKeys[]. pMixed[] keeps the mixed hash values of the keys, and pTaken[]
+ marks the slots that are in use. The buckets are then taken in the order of
+ their sizes, biggest first, since a big bucket is hard to place when most of
+ the slots are in use. Return 0 if a bucket had no pilot within
+ PERFECT_HASH_PILOT_LIMIT(n), or if two of its keys can not be separated. */
+static char find_pilots(struct PerfectHash *pHash, struct HashSlot *pSlots,
+        tableindex_t n, tableindex_t *pMixed, tableindex_t *pKeys,
+        tableindex_t *pStart, char *pTaken, struct Parameters *pParam)
+{
+  tableindex_t *pBuckets, *pSizeStart, *pSlotOf;
+  tableindex_t bucketNum, maxSize, size, limit, pilot, slot;
+  tableindex_t b, i, j, k;
+  
+  bucketNum = pHash->bucketMask + 1;
+  limit = PERFECT_HASH_PILOT_LIMIT(n);
+  
+  memset(pStart, 0, sizeof(tableindex_t) * (bucketNum + 1));
+  for (i = 0; i < n; i++)
+  {
+    pMixed[i] = mix_hash(pSlots[i].hash ^ pHash->seed);
+    pStart[(pMixed[i] & pHash->bucketMask) + 1]++;
+  }
+  
+  maxSize = 0;
+  for (b = 0; b < bucketNum; b++)
+  {
+    if (pStart[b + 1] > maxSize)
+    {
+      maxSize = pStart[b + 1];
+    }
+    pStart[b + 1] += pStart[b];
+  }
+  
+  /* pSlotOf[] is borrowed to count the keys placed into every bucket. */
+  pSlotOf = (tableindex_t *) calloc(bucketNum > maxSize ? bucketNum : maxSize,
+                     sizeof(tableindex_t));
+  pBuckets = (tableindex_t *) malloc(sizeof(tableindex_t) * bucketNum);
+  pSizeStart = (tableindex_t *) calloc(maxSize + 2, sizeof(tableindex_t));
+  if (!pSlotOf || !pBuckets || !pSizeStart)
+  {
+    log_msg(MALLOC_ERR_6035, LOG_ERR, pParam);
+    exit(1);
+  }
+  
+  for (i = 0; i < n; i++)
+  {
+    b = pMixed[i] & pHash->bucketMask;
+    pKeys[pStart[b] + pSlotOf[b]++] = i;
+  }
+  
+  /* Counting sort of the buckets by their sizes, in descending order. */
+  for (b = 0; b < bucketNum; b++)
+  {
+    pSizeStart[maxSize - (pStart[b + 1] - pStart[b]) + 1]++;
+  }
+  for (size = 0; size <= maxSize; size++)
+  {
+    pSizeStart[size + 1] += pSizeStart[size];
+  }
+  for (b = 0; b < bucketNum; b++)
+  {
+    pBuckets[pSizeStart[maxSize - (pStart[b + 1] - pStart[b])]++] = b;
+  }
+  
+  memset(pTaken, 0, n);
+  
+  for (k = 0; k < bucketNum; k++)
+  {
+    b = pBuckets[k];
+    size = pStart[b + 1] - pStart[b];
+    
+    if (!size)
+    {
+      /* The empty buckets are at the end. */
+      pHash->pPilots[b] = 0;
+      continue;
+    }
+    
+    /* Keys whose mixed values have the same top 32 bits would always get the
+     same slot. Another seed separates them, unless their hash values are the
+     same. */
+    for (i = 1; i < size; i++)
+    {
+      for (j = 0; j < i; j++)
+      {
+        if (pMixed[pKeys[pStart[b] + i]] >> 32 == 
+            pMixed[pKeys[pStart[b] + j]] >> 32)
+        {
+          break;
+        }
+      }
+      
+      if (j < i)
+      {
+        break;
+      }
+    }
+    
+    if (i < size)
+    {
+      break;
+    }
+    
+    for (pilot = 0; pilot < limit; pilot++)
+    {
+      for (i = 0; i < size; i++)
+      {
+        slot = PILOT_SLOT(pMixed[pKeys[pStart[b] + i]], pilot, n);
+        
+        if (pTaken[slot])
+        {
+          break;
+        }
+        
+        for (j = 0; j < i && pSlotOf[j] != slot; j++)
+          ;
+        
+        if (j < i)
+        {
+          break;
+        }
+        
+        pSlotOf[i] = slot;
+      }
+      
+      if (i == size)
+      {
+        break;
+      }
+    }
+    
+    if (pilot == limit)
+    {
+      break;
+    }
+    
+    for (i = 0; i < size; i++)
+    {
+      pTaken[pSlotOf[i]] = 1;
+    }
+    pHash->pPilots[b] = (unsigned int) pilot;
+  }
+  
+  free((void *) pSlotOf);
+  free((void *) pBuckets);
+  free((void *) pSizeStart);
+  
+  return k == bucketNum;
+}
+
+/* The filter has a power of two words, at least FILTER_BITS_PER_KEY bits for
+ every key. */
+static void build_filter(struct PerfectHash *pHash, struct HashSlot *pSlots,
+        tableindex_t n, struct Parameters *pParam)
+{
+  tableindex_t filterSize, i, filterMixed;
+  
+  filterSize = 1;
+  while (filterSize * sizeof(tableindex_t) * 8 < n * FILTER_BITS_PER_KEY)
+  {
+    filterSize <<= 1;
+  }
+  pHash->filterMask = filterSize - 1;
+  
+  pHash->pFilter = (tableindex_t *) calloc(filterSize, sizeof(tableindex_t));
+  if (!pHash->pFilter)
+  {
+    log_msg(MALLOC_ERR_6035, LOG_ERR, pParam);
+    exit(1);
+  }
+  
+  for (i = 0; i < n; i++)
+  {
+    filterMixed = mix_hash(mix_hash(pSlots[i].hash ^ pHash->seed));
+    FILTER_WORD(pHash, filterMixed) |= filter_bits(filterMixed);
+  }
+}
+
+/* Return the slot of the key with the given hash value in a table of n slots.
+ The key may still be another one with the same slot, so the caller compares
+ the slot with the key. If the Bloom filter tells that the key is not in the
+ table, n is returned. Nothing is written, so any number of threads can call
+ this function at the same time. */
+tableindex_t find_perfect_slot(struct PerfectHash *pHash, tableindex_t hash,
+        tableindex_t n)
+{
+  tableindex_t mixed, filterMixed, bits;
+  
+  mixed = mix_hash(hash ^ pHash->seed);
+  filterMixed = mix_hash(mixed);
+  bits = filter_bits(filterMixed);
+  
+  if ((FILTER_WORD(pHash, filterMixed) & bits) != bits)
+  {
+    return n;
+  }
+  
+  return PILOT_SLOT(mixed, pHash->pPilots[mixed & pHash->bucketMask], n);
+}
+
+void free_perfect_hash(struct PerfectHash *pHash)
+{
+  if (pHash->pPilots)
+  {
+    free((void *) pHash->pPilots);
+    pHash->pPilots = 0;
+  }
+  
+  if (pHash->pFilter)
+  {
+    free((void *) pHash->pFilter);
+    pHash->pFilter = 0;
+  }
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2016 Zhuge Chen, Risto Vaarandi and Mauno Pihelgas
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/* 
+ * File:   perfect_hash.h
+ * 
+ * Content: Declarations of global functions in perfect_hash.c .
+ *
+ * Created on October 16, 2026, 11:50 PM
+ */
+
+#ifndef PERFECT_HASH_H
+#define PERFECT_HASH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct HashSlot *build_perfect_hash(struct PerfectHash *pHash, 
+        struct HashSlot *pSlots, tableindex_t n, tableindex_t seed,
+        struct Parameters *pParam);
+tableindex_t find_perfect_slot(struct PerfectHash *pHash, tableindex_t hash,
+        tableindex_t n);
+void free_perfect_hash(struct PerfectHash *pHash);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PERFECT_HASH_H */
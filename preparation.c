@@ -34,12 +34,15 @@
 #include "output.h"
 #include "free_resource.h"
 #include "utility.h"
+#include "arena.h"
 
 static void glob_filenames(char *pPattern, struct Parameters *pParam);
 static void build_input_file_chain(char *pFilename, struct Parameters *pParam);
 static void build_template_chain(char *opt, struct Parameters *pParam);
 static int change_syslog_facility_number(struct Parameters *pParam);
 static int validate_parameters_template(struct Parameters *pParam);
+static void detect_simple_separator(char *pDelim, struct Parameters *pParam);
+static int find_bracket_expression_end(char *pStr);
 
 /* Initialization of parameters */
 int step_0_init_input_parameters(struct Parameters *pParam)
@@ -54,7 +57,8 @@ int step_0_init_input_parameters(struct Parameters *pParam)
   pParam->wordTableSize = DEF_WORD_TABLE_SIZE;
   pParam->bSyslogFlag = 0;
   pParam->bDetailedTokenFlag = 0;
-  
+  pParam->bWordDepPassFlag = 0;
+
   pParam->pSyslogFacility = (char *) malloc(strlen(defSyslogFacility) + 1);
   if (!pParam->pSyslogFacility)
   {
@@ -75,29 +79,54 @@ int step_0_init_input_parameters(struct Parameters *pParam)
   pParam->pOutlier = 0;
   pParam->debug = 0;
   pParam->outputMode = 0;
+  pParam->outputFormat = OUTPUT_FORMAT_TEXT;
+  pParam->threadNum = DEF_THREAD_NUM;
+  pParam->wordSampleRate = 0;
+  pParam->sketchDepth = DEF_SKETCH_DEPTH;
+  pParam->topNum = 0;
+pParam->pTokenCache = 0;
+  pParam->bTokenCacheReady = 0;
+  pParam->tokenCachePartNum = 0;
+  pParam->ppCacheParts = 0;
+  pParam->ppCachePartMaps = 0;
+  pParam->pVocabToFrequent = 0;
+  pParam->ppFrequentWords = 0;
+  pParam->pCacheData = 0;
+  pParam->cacheSize = 0;
+  pParam->pCacheCheckpoints = 0;
+  pParam->cacheCheckpointNum = 0;
+  
+  init_arena(&pParam->wordArena, ARENA_BLOCK_SIZE);
+  init_arena(&pParam->clusterArena, ARENA_BLOCK_SIZE);
+  init_arena(&pParam->candidateArena, ARENA_BLOCK_SIZE);
+  init_arena(&pParam->joinArena, ARENA_BLOCK_SIZE);
   
   pParam->syslogThreshold = DEF_SYSLOG_THRESHOLD;
   pParam->syslogFacilityNum = LOG_LOCAL2;
   pParam->wordTableSeed = 0;
-  pParam->ppWordTable = 0;
-  pParam->pWordSketch = 0;
+  pParam->wordTable.pSlots = 0;
+  pParam->wordTable.perfectHash.pPilots = 0;
+  pParam->wordTable.perfectHash.pFilter = 0;
+  pParam->wordSketch.pCounters = 0;
   pParam->wordSketchSeed = 0;
   pParam->linecount = 0;
   pParam->dataPassTimes = 0;
   pParam->totalLineNum = 0;
   *pParam->totalLineNumDigit = 0;
-  pParam->timeStorage = 0;
   pParam->freWordNum = 0;
   pParam->clusterNum = 0;
   pParam->clusterCandiNum = 0;
-  pParam->pClusterSketch = 0;
+  pParam->clusterSketch.pCounters = 0;
   pParam->clusterSketchSeed = 0;
-  pParam->clusterTableSize = 0;
-  pParam->ppClusterTable = 0;
+  pParam->clusterTable.pSlots = 0;
+  pParam->clusterTable.perfectHash.pPilots = 0;
+  pParam->clusterTable.perfectHash.pFilter = 0;
   pParam->clusterTableSeed = 0;
   pParam->biggestConstants = 0;
-  pParam->wordDepMatrix = 0;
-  pParam->wordDepMatrixBreadth = 0;
+  pParam->pCandidateGroups = 0;
+  pParam->wordDepTable.pSlots = 0;
+  pParam->pWordDepIndex = 0;
+  pParam->wordDepWordNum = 0;
   pParam->trieNodeNum = 0;
   
   /* struct Cluster *clusterFamily[MAXWORDS + 1]; */
@@ -112,13 +141,9 @@ int step_0_init_input_parameters(struct Parameters *pParam)
   /* The initialzition of regex_t filter_regex is integrated to function
    validate_parameters(). */
   
-  pParam->wildcardHash = 0;
-  pParam->prefixSketchSize = 0;
-  pParam->prefixSketchSeed = 0;
-  pParam->prefixWildcardMin = 0;
-  pParam->prefixWildcardMax = 0;
-  pParam->pPrefixRoot = 0;
-  pParam->pPrefixRet = 0;
+  pParam->pTrieNodes = 0;
+  pParam->clusterIndex.pOffsets = 0;
+  pParam->clusterIndex.pPostings = 0;
   
   /* If "token" is in frequent words, another random string that is not in
    frequent words will replace "token". */
@@ -175,16 +200,23 @@ int step_0_parse_options(int argc, char **argv, struct Parameters *pParam)
     {"lfilter",   required_argument, 0,   'f'},
     {"input",     required_argument, 0,  1001},
     {"outliers",  required_argument, 0,   'o'},
+    {"outputformat", required_argument, 0,  1019},
     {"outputmode",  optional_argument, 0,  1011},
     {"rsupport",  required_argument, 0,  1005},
     {"separator",   required_argument, 0,   'd'},
+    {"sketchdepth", required_argument, 0,  1016},
     {"support",   required_argument, 0,   's'},
     {"syslog",    optional_argument, 0,  1002},
     {"template",  required_argument, 0,   't'},
+    {"threads",   required_argument, 0,  1013},
+    {"tokencache",  required_argument, 0,  1015},
+    {"top",     required_argument, 0,  1018},
     {"version",   no_argument,     0,  1006},
+    {"wdeppass",  no_argument,     0,  1017},
     {"weightf",   required_argument, 0,  1004},
     {"wfilter",   required_argument, 0,  1008},
     {"wreplace",  required_argument, 0,  1010},
+    {"wsample",   required_argument, 0,  1014},
     {"wsearch",   required_argument, 0,  1009},
     {"wsize",     required_argument, 0,   'v'},
     {"wtablesize",  required_argument, 0,   'w'},
@@ -341,6 +373,48 @@ int step_0_parse_options(int argc, char **argv, struct Parameters *pParam)
       case 1012:
         pParam->bDetailedTokenFlag = 1;
         break;
+      case 1013:
+        pParam->threadNum = atoi(optarg);
+        break;
+      case 1014:
+        pParam->wordSampleRate = atof(optarg);
+        break;
+      case 1015:
+        pParam->pTokenCache = (char *) malloc(strlen(optarg) + 1);
+        if (!pParam->pTokenCache)
+        {
+          log_msg(MALLOC_ERR_6006, LOG_ERR, pParam);
+          exit(1);
+        }
+        strcpy(pParam->pTokenCache, optarg);
+        break;
+      case 1016:
+        pParam->sketchDepth = atoi(optarg);
+        break;
+      case 1017:
+        pParam->bWordDepPassFlag = 1;
+        break;
+      case 1018:
+        pParam->topNum = labs(atol(optarg));
+        break;
+      case 1019:
+        if (!strcmp(optarg, "text"))
+        {
+          pParam->outputFormat = OUTPUT_FORMAT_TEXT;
+        }
+        else if (!strcmp(optarg, "ndjson"))
+        {
+          pParam->outputFormat = OUTPUT_FORMAT_NDJSON;
+        }
+        else if (!strcmp(optarg, "binary"))
+        {
+          pParam->outputFormat = OUTPUT_FORMAT_BINARY;
+        }
+        else
+        {
+          pParam->outputFormat = -1;
+        }
+        break;
       case '?':
         /* getopt_long already printed an error message. */
         break;
@@ -368,6 +442,7 @@ int step_0_parse_options(int argc, char **argv, struct Parameters *pParam)
 int step_0_validate_parameters(struct Parameters *pParam)
 {
   char *defSyslogFacility = DEF_SYSLOG_FACILITY;
+  char logStr[MAXLOGMSGLEN];
   
   if (pParam->support <= 0 && pParam->pctSupport <= 0)
   {
@@ -420,6 +495,9 @@ int step_0_validate_parameters(struct Parameters *pParam)
     regcomp(&pParam->delim_regex, DEF_WORD_DELM, REG_EXTENDED);
   }
   
+  detect_simple_separator(pParam->pDelim ? pParam->pDelim : DEF_WORD_DELM,
+              pParam);
+  
   if (pParam->byteOffset < 0)
   {
     log_msg("'-b' or '--byteoffset' option requires a positive number as "
@@ -510,6 +588,56 @@ int step_0_validate_parameters(struct Parameters *pParam)
     return 0;
   }
   
+  if (pParam->outputFormat < 0)
+  {
+    log_msg("'--outputformat' option requires a valid format: text, ndjson "
+        "or binary", LOG_ERR, pParam);
+    return 0;
+  }
+  
+  if (pParam->threadNum < 1 || pParam->threadNum > MAXTHREADS)
+  {
+    sprintf(logStr, "'--threads' option requires a valid number: "
+        "1...%d", MAXTHREADS);
+    log_msg(logStr, LOG_ERR, pParam);
+    return 0;
+  }
+  
+  if (pParam->wordSampleRate < 0 || pParam->wordSampleRate > 1)
+  {
+    log_msg("'--wsample' option requires a real number from the range "
+        "0..1 as parameter", LOG_ERR, pParam);
+    return 0;
+  }
+  
+  if (pParam->wordSampleRate && pParam->pTokenCache)
+  {
+    log_msg("'--tokencache' option can not be used together with '--wsample' "
+        "option", LOG_ERR, pParam);
+    return 0;
+  }
+  
+  if (pParam->topNum && pParam->outputMode)
+  {
+    log_msg("'--top' option can not be used together with '--outputmode' "
+        "option", LOG_ERR, pParam);
+    return 0;
+  }
+  
+  if (pParam->sketchDepth < 1 || pParam->sketchDepth > MAXSKETCHDEPTH)
+  {
+    sprintf(logStr, "'--sketchdepth' option requires a valid number: "
+        "1...%d", MAXSKETCHDEPTH);
+    log_msg(logStr, LOG_ERR, pParam);
+    return 0;
+  }
+  
+  /* In the '--wsample' mode, the word sketch is built in the sampling pass. */
+  if (pParam->wordSampleRate && !pParam->wordSketchSize)
+  {
+    pParam->wordSketchSize = DEF_SAMPLE_SKETCH_SIZE;
+  }
+  
   if (pParam->clusterSketchSize && pParam->bAggrsupFlag)
   {
     log_msg("'--csize' option can not be used together with '--aggrsup' "
@@ -526,7 +654,6 @@ void step_0_generate_seeds(struct Parameters *pParam)
   pParam->wordSketchSeed = rand();
   pParam->clusterSketchSeed =rand();
   pParam->clusterTableSeed = rand();
-  pParam->prefixSketchSeed =rand();
 }
 
 int step_0_cal_total_pass_over_data_set_times(struct Parameters *pParam)
@@ -536,9 +663,12 @@ int step_0_cal_total_pass_over_data_set_times(struct Parameters *pParam)
   /* Build vocabulary, find cluster candidates. */
   times = 2;
   
+  /* In the '--wsample' mode, the sampling pass also builds the word sketch.
+   A rare fix-up pass is not counted. */
   if (pParam->wordSketchSize) { times++; }
   if (pParam->clusterSketchSize) { times++; }
   if (pParam->pOutlier) { times++; }
+  if (pParam->wordWeightThreshold && pParam->bWordDepPassFlag) { times++; }
   
   return times;
 }
@@ -784,4 +914,134 @@ static int validate_parameters_template(struct Parameters *pParam)
     }
   }
   return 1;
-}
\ No newline at end of file
+}
+
+/* Check if the separator regex pDelim is a simple one: a single byte, an
+ escaped special character or a bracket expression, optionally followed by '+'.
+ If so, the words of a line can be split by scanning bytes, see function
+ find_separator() in line_processing.c, and regexec() is not needed. 
+ The bytes of the separator are not parsed from the bracket expression, but
+ found by matching every byte value against the already compiled delim_regex,
+ so that the fast path always agrees with the regex. */
+static void detect_simple_separator(char *pDelim, struct Parameters *pParam)
+{
+  regmatch_t match[1];
+  char byte[2];
+  int i, len;
+  
+  /* The byte is terminated, since some regexec() implementations look at the
+   string beyond REG_STARTEND. */
+  byte[1] = 0;
+  
+  pParam->bSimpleDelim = 0;
+  pParam->bDelimRepeat = 0;
+  pParam->delimByteNum = 0;
+  
+  if (*pDelim == '[')
+  {
+    len = find_bracket_expression_end(pDelim);
+    if (!len)
+    {
+      return;
+    }
+  }
+  else if (*pDelim == '\\')
+  {
+    if (!pDelim[1] || !strchr(".[]()*+?{}|^$\\", pDelim[1]))
+    {
+      return;
+    }
+    len = 2;
+  }
+  else if (*pDelim && !strchr(".[]()*+?{}|^$\\", *pDelim))
+  {
+    len = 1;
+  }
+  else
+  {
+    return;
+  }
+  
+  if (pDelim[len] == '+')
+  {
+    pParam->bDelimRepeat = 1;
+    len++;
+  }
+  
+  if (pDelim[len])
+  {
+    return;
+  }
+  
+  for (i = 0; i < 256; i++)
+  {
+    byte[0] = (char) i;
+    match[0].rm_so = 0;
+    match[0].rm_eo = 1;
+    
+    if (!regexec(&pParam->delim_regex, byte, 1, match, REG_STARTEND) &&
+      match[0].rm_so == 0 && match[0].rm_eo == 1)
+    {
+      pParam->delimSet[i] = 1;
+      pParam->delimBytes[pParam->delimByteNum++] = (unsigned char) i;
+    }
+    else
+    {
+      pParam->delimSet[i] = 0;
+    }
+  }
+  
+  if (pParam->delimByteNum)
+  {
+    pParam->bSimpleDelim = 1;
+  }
+}
+
+/* pStr begins with '['. Returns the length of the bracket expression, or 0 if
+ it is not terminated. */
+static int find_bracket_expression_end(char *pStr)
+{
+  char *ptr, *pEnd;
+  
+  ptr = pStr + 1;
+  
+  if (*ptr == '^')
+  {
+    ptr++;
+  }
+  
+  /* ']' right after '[' or '[^' is a normal character. */
+  if (*ptr == ']')
+  {
+    ptr++;
+  }
+  
+  while (*ptr && *ptr != ']')
+  {
+    /* Skip [:class:], [.coll.] and [=equiv=]. */
+    if (*ptr == '[' && (ptr[1] == ':' || ptr[1] == '.' || ptr[1] == '='))
+    {
+      pEnd = ptr + 2;
+      while (*pEnd && !(*pEnd == ptr[1] && pEnd[1] == ']'))
+      {
+        pEnd++;
+      }
+      if (!*pEnd)
+      {
+        return 0;
+      }
+      ptr = pEnd + 2;
+    }
+    else
+    {
+      ptr++;
+    }
+  }
+  
+  if (!*ptr)
+  {
+    return 0;
+  }
+  
+  return (int) (ptr - pStr) + 1;
+}
@@ -0,0 +1,313 @@
+/*
+ * Copyright (C) 2016 Zhuge Chen, Risto Vaarandi and Mauno Pihelgas
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/* 
+ * File:   sketch.c
+ * 
+ * Content: Functions related to the Count-Min sketches of '--wsize' and
+ * '--csize' options.
+ *
+ * A sketch has depth rows of width counters. An item is counted in one slot of
+ * every row, and its count is estimated by the smallest of these counters,
+ * which is never below the real count. With conservative update, an insertion
+ * only raises the counters that are equal to the current estimate, because
+ * the others already count more than the item has, which keeps the estimates
+ * of the infrequent items low. A sketch of depth 1 is the single-row sketch of
+ * the original program.
+ *
+ * A sketch is only asked whether an item reaches the support threshold, so the
+ * counters stop at maxCount instead of wrapping around, and are as narrow as
+ * the threshold allows (1, 2 or 4 bytes). Only a sketch from which counts are
+ * removed needs the full width of support_t, since a count can not be taken
+ * back from a counter that has stopped.
+ *
+ * Created on October 16, 2026, 7:40 PM
+ */
+
+#include "common_header.h"
+#include "sketch.h"
+
+#include <string.h>    /* for memset() */
+
+#include "utility.h"
+#include "output.h"
+
+static support_t get_counter(struct Sketch *pSketch, tableindex_t slot);
+static void set_counter(struct Sketch *pSketch, tableindex_t slot, 
+        support_t value);
+static tableindex_t count_row_oversupport(struct Sketch *pSketch, int r, 
+        support_t threshold);
+
+/* The slot of an item with the given hash value in row r, as an index into
+ pCounters. */
+#define SKETCH_SLOT(pSketch, hash, r) \
+  ((tableindex_t) (r) * (pSketch)->width + \
+  hash2index((hash), (pSketch)->width, (pSketch)->rowSeeds[r]))
+
+/* Allocate a sketch of depth rows of width counters, and set the counters to
+ zero. The seeds of the rows after the first one are derived from seed with a
+ 64-bit linear congruential generator. The counters are the narrowest ones
+ that can hold threshold, the largest count the sketch is asked about; if it is
+ 0 (not known yet), 4-byte counters are used. A sketch without conservative
+ update gets support_t counters, see sketch_remove(). */
+void init_sketch(struct Sketch *pSketch, tableindex_t width, int depth,
+        tableindex_t seed, char bConservative, support_t threshold, 
+        struct Parameters *pParam)
+{
+  int r;
+  
+  pSketch->width = width;
+  pSketch->depth = depth;
+  pSketch->bConservative = bConservative;
+  
+  pSketch->rowSeeds[0] = seed;
+  for (r = 1; r < depth; r++)
+  {
+    pSketch->rowSeeds[r] = pSketch->rowSeeds[r - 1] * 
+                 (tableindex_t) 6364136223846793005ULL +
+                 (tableindex_t) 1442695040888963407ULL;
+  }
+  
+  if (!bConservative || threshold > 0xFFFFFFFFUL)
+  {
+    pSketch->counterSize = sizeof(support_t);
+    pSketch->maxCount = ~(support_t) 0;
+  }
+  else if (threshold && threshold <= 0xFFUL)
+  {
+    pSketch->counterSize = 1;
+    pSketch->maxCount = 0xFFUL;
+  }
+  else if (threshold && threshold <= 0xFFFFUL)
+  {
+    pSketch->counterSize = 2;
+    pSketch->maxCount = 0xFFFFUL;
+  }
+  else
+  {
+    pSketch->counterSize = 4;
+    pSketch->maxCount = 0xFFFFFFFFUL;
+  }
+  
+  pSketch->pCounters = malloc((size_t) pSketch->counterSize * width * depth);
+  if (!pSketch->pCounters)
+  {
+    log_msg(MALLOC_ERR_6030, LOG_ERR, pParam);
+    exit(1);
+  }
+  
+  clear_sketch(pSketch);
+}
+
+void clear_sketch(struct Sketch *pSketch)
+{
+  memset(pSketch->pCounters, 0, 
+       (size_t) pSketch->counterSize * pSketch->width * pSketch->depth);
+}
+
+static support_t get_counter(struct Sketch *pSketch, tableindex_t slot)
+{
+  switch (pSketch->counterSize)
+  {
+    case 1:
+      return ((unsigned char *) pSketch->pCounters)[slot];
+    case 2:
+      return ((unsigned short *) pSketch->pCounters)[slot];
+    case 4:
+      return ((unsigned int *) pSketch->pCounters)[slot];
+    default:
+      return ((support_t *) pSketch->pCounters)[slot];
+  }
+}
+
+static void set_counter(struct Sketch *pSketch, tableindex_t slot, 
+        support_t value)
+{
+  switch (pSketch->counterSize)
+  {
+    case 1:
+      ((unsigned char *) pSketch->pCounters)[slot] = (unsigned char) value;
+      break;
+    case 2:
+      ((unsigned short *) pSketch->pCounters)[slot] = (unsigned short) value;
+      break;
+    case 4:
+      ((unsigned int *) pSketch->pCounters)[slot] = (unsigned int) value;
+      break;
+    default:
+      ((support_t *) pSketch->pCounters)[slot] = value;
+      break;
+  }
+}
+
+/* Count one occurrence of the item with the given hash value. A counter that
+ has reached maxCount stays there. */
+void sketch_add(struct Sketch *pSketch, tableindex_t hash)
+{
+  tableindex_t slots[MAXSKETCHDEPTH];
+  support_t counts[MAXSKETCHDEPTH];
+  support_t min;
+  int r;
+  
+  min = pSketch->maxCount;
+  
+  for (r = 0; r < pSketch->depth; r++)
+  {
+    slots[r] = SKETCH_SLOT(pSketch, hash, r);
+    counts[r] = get_counter(pSketch, slots[r]);
+    if (counts[r] < min)
+    {
+      min = counts[r];
+    }
+  }
+  
+  for (r = 0; r < pSketch->depth; r++)
+  {
+    if (counts[r] == pSketch->maxCount)
+    {
+      continue;
+    }
+    
+    if (!pSketch->bConservative || counts[r] == min)
+    {
+      set_counter(pSketch, slots[r], counts[r] + 1);
+    }
+  }
+}
+
+/* Take back one occurrence of the item with the given hash value, which was
+ counted with sketch_add() before. This is only possible without conservative
+ update, since otherwise it is not known which counters were raised for the
+ item. */
+void sketch_remove(struct Sketch *pSketch, tableindex_t hash)
+{
+  tableindex_t slot;
+  int r;
+  
+  for (r = 0; r < pSketch->depth; r++)
+  {
+    slot = SKETCH_SLOT(pSketch, hash, r);
+    set_counter(pSketch, slot, get_counter(pSketch, slot) - 1);
+  }
+}
+
+/* Return the estimated count of the item with the given hash value, which is
+ at most maxCount. */
+support_t sketch_estimate(struct Sketch *pSketch, tableindex_t hash)
+{
+  support_t min, count;
+  int r;
+  
+  min = get_counter(pSketch, SKETCH_SLOT(pSketch, hash, 0));
+  
+  for (r = 1; r < pSketch->depth; r++)
+  {
+    count = get_counter(pSketch, SKETCH_SLOT(pSketch, hash, r));
+    if (count < min)
+    {
+      min = count;
+    }
+  }
+  
+  return min;
+}
+
+/* Count the counters of row r that reach the threshold. The row is scanned
+ with the width of its counters. */
+static tableindex_t count_row_oversupport(struct Sketch *pSketch, int r, 
+        support_t threshold)
+{
+  tableindex_t j, begin, end, oversupport;
+  
+  begin = (tableindex_t) r * pSketch->width;
+  end = begin + pSketch->width;
+  oversupport = 0;
+  
+  switch (pSketch->counterSize)
+  {
+    case 1:
+      for (j = begin; j < end; j++)
+      {
+        oversupport += ((unsigned char *) pSketch->pCounters)[j] >= threshold;
+      }
+      break;
+    case 2:
+      for (j = begin; j < end; j++)
+      {
+        oversupport += ((unsigned short *) pSketch->pCounters)[j] >= threshold;
+      }
+      break;
+    case 4:
+      for (j = begin; j < end; j++)
+      {
+        oversupport += ((unsigned int *) pSketch->pCounters)[j] >= threshold;
+      }
+      break;
+    default:
+      for (j = begin; j < end; j++)
+      {
+        oversupport += ((support_t *) pSketch->pCounters)[j] >= threshold;
+      }
+      break;
+  }
+  
+  return oversupport;
+}
+
+/* Count the counters that reach the threshold in every row of the sketch,
+ and return the smallest of these numbers. No item can be estimated to reach
+ the threshold if it is 0. If pFalsePositive is not 0, it is set to the
+ estimated false positive rate of the sketch, i.e. the probability that an
+ item below the threshold hits a counter that reaches it in every row. */
+tableindex_t sketch_oversupport(struct Sketch *pSketch, support_t threshold,
+        double *pFalsePositive)
+{
+  tableindex_t oversupport, min;
+  double rate;
+  int r;
+  
+  min = pSketch->width;
+  rate = 1;
+  
+  for (r = 0; r < pSketch->depth; r++)
+  {
+    oversupport = count_row_oversupport(pSketch, r, threshold);
+    
+    if (oversupport < min)
+    {
+      min = oversupport;
+    }
+    
+    rate *= (double) oversupport / pSketch->width;
+  }
+  
+  if (pFalsePositive)
+  {
+    *pFalsePositive = rate;
+  }
+  
+  return min;
+}
+
+void free_sketch(struct Sketch *pSketch)
+{
+  if (pSketch->pCounters)
+  {
+    free(pSketch->pCounters);
+    pSketch->pCounters = 0;
+  }
+}
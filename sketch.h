@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2016 Zhuge Chen, Risto Vaarandi and Mauno Pihelgas
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/* 
+ * File:   sketch.h
+ * 
+ * Content: Declarations of global functions in sketch.c .
+ *
+ * Created on October 16, 2026, 7:40 PM
+ */
+
+#ifndef SKETCH_H
+#define SKETCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void init_sketch(struct Sketch *pSketch, tableindex_t width, int depth,
+        tableindex_t seed, char bConservative, support_t threshold, 
+        struct Parameters *pParam);
+void clear_sketch(struct Sketch *pSketch);
+void sketch_add(struct Sketch *pSketch, tableindex_t hash);
+void sketch_remove(struct Sketch *pSketch, tableindex_t hash);
+support_t sketch_estimate(struct Sketch *pSketch, tableindex_t hash);
+tableindex_t sketch_oversupport(struct Sketch *pSketch, support_t threshold,
+        double *pFalsePositive);
+void free_sketch(struct Sketch *pSketch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SKETCH_H */
@@ -0,0 +1,433 @@
+/*
+ * Copyright (C) 2016 Zhuge Chen, Risto Vaarandi and Mauno Pihelgas
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/* 
+ * File:   sorting.c
+ * 
+ * Content: Functions that sort frequent words and clusters for printing.
+ *
+ * The elements are sorted by their support, in descending order. Elements of
+ * equal support are ordered by their content (see compare_words() and
+ * compare_clusters()), so that the order does not depend on where the
+ * elements happened to be stored in the hash tables, e.g. on the number of
+ * worker threads.
+ *
+ * sort_elements() is a merge sort. With '--threads' option, a large array is
+ * cut into one part per thread, the parts are sorted in parallel, and the
+ * sorted runs are merged in pairs, also in parallel. sort_top_elements() only
+ * sorts the k first elements of the order, which are found with a heap.
+ *
+ * Created on October 16, 2026, 9:25 PM
+ */
+
+#include "common_header.h"
+#include "sorting.h"
+
+#include <pthread.h>   /* for pthread_create() and pthread_join() */
+#include <string.h>    /* for memcmp() and memcpy() */
+
+#include "output.h"
+
+static int compare_keys(struct Elem *pElem1, struct Elem *pElem2);
+static void insertion_sort(struct Elem **ppArray, wordnumber_t size,
+        int (*pCompare)(struct Elem *, struct Elem *));
+static void merge_runs(struct Elem **ppArray, wordnumber_t mid, 
+        wordnumber_t size, struct Elem **ppTmp,
+        int (*pCompare)(struct Elem *, struct Elem *));
+static void merge_sort(struct Elem **ppArray, wordnumber_t size, 
+        struct Elem **ppTmp, int (*pCompare)(struct Elem *, struct Elem *));
+static void *sort_task_main(void *pArg);
+static void run_sort_tasks(struct SortTask *pTasks, int taskNum, 
+        struct Parameters *pParam);
+static void sort_in_parallel(struct Elem **ppArray, wordnumber_t size,
+        struct Elem **ppTmp, int (*pCompare)(struct Elem *, struct Elem *),
+        struct Parameters *pParam);
+static void sift_down(struct Elem **ppHeap, wordnumber_t i, wordnumber_t size,
+        int (*pCompare)(struct Elem *, struct Elem *));
+
+/* Alphabetical order of the keys of two words. The keys are compared with
+ their stored lengths, so a key with an embedded 0 is compared in full. Of two
+ keys with the same beginning, the shorter one comes first. */
+static int compare_keys(struct Elem *pElem1, struct Elem *pElem2)
+{
+  int len, result;
+  
+  len = pElem1->keyLen < pElem2->keyLen ? pElem1->keyLen : pElem2->keyLen;
+  
+  result = memcmp(pElem1->pKey, pElem2->pKey, len);
+  if (result)
+  {
+    return result;
+  }
+  
+  return pElem1->keyLen - pElem2->keyLen;
+}
+
+/* Order of two frequent words: the one with the higher support comes first,
+ and words of equal support are in alphabetical order. Returns a negative
+ number if pElem1 comes first, a positive one if pElem2 does. */
+int compare_words(struct Elem *pElem1, struct Elem *pElem2)
+{
+  if (pElem1->count != pElem2->count)
+  {
+    return pElem1->count > pElem2->count ? -1 : 1;
+  }
+  
+  return compare_keys(pElem1, pElem2);
+}
+
+/* Order of two clusters (or cluster candidates): the one with the higher
+ support comes first. Clusters of equal support are ordered by their number of
+ constants, then by their constants, in alphabetical order, and at last by
+ their wildcard ranges, from the one before the 1st constant to the one in the
+ tail. No two clusters are equal, so the order is total. The clusters of
+ pClusterWithTokenFamily[] are compared in the same way, by the constants and
+ wildcards of the cluster they were created from. */
+int compare_clusters(struct Elem *pElem1, struct Elem *pElem2)
+{
+  struct Cluster *pCluster1, *pCluster2;
+  int *pWild1, *pWild2;
+  int i, result;
+  
+  if (pElem1->count != pElem2->count)
+  {
+    return pElem1->count > pElem2->count ? -1 : 1;
+  }
+  
+  pCluster1 = pElem1->pCluster;
+  pCluster2 = pElem2->pCluster;
+  
+  if (pCluster1->constants != pCluster2->constants)
+  {
+    return pCluster1->constants < pCluster2->constants ? -1 : 1;
+  }
+  
+  for (i = 1; i <= pCluster1->constants; i++)
+  {
+    result = compare_keys(pCluster1->ppWord[i], pCluster2->ppWord[i]);
+    if (result)
+    {
+      return result;
+    }
+  }
+  
+  /* fullWildcard[2] ... are the ranges before the constants, and
+   fullWildcard[0] and fullWildcard[1] the range in the tail. */
+  pWild1 = pCluster1->fullWildcard;
+  pWild2 = pCluster2->fullWildcard;
+  for (i = 2; i < 2 * (pCluster1->constants + 1); i++)
+  {
+    if (pWild1[i] != pWild2[i])
+    {
+      return pWild1[i] < pWild2[i] ? -1 : 1;
+    }
+  }
+  
+  for (i = 0; i < 2; i++)
+  {
+    if (pWild1[i] != pWild2[i])
+    {
+      return pWild1[i] < pWild2[i] ? -1 : 1;
+    }
+  }
+  
+  return 0;
+}
+
+static void insertion_sort(struct Elem **ppArray, wordnumber_t size,
+        int (*pCompare)(struct Elem *, struct Elem *))
+{
+  wordnumber_t i, j;
+  struct Elem *tmp;
+  
+  for (i = 1; i < size; i++)
+  {
+    tmp = ppArray[i];
+    
+    for (j = i; j > 0 && pCompare(ppArray[j - 1], tmp) > 0; j--)
+    {
+      ppArray[j] = ppArray[j - 1];
+    }
+    
+    ppArray[j] = tmp;
+  }
+}
+
+/* Merge the sorted runs ppArray[0 ... mid - 1] and ppArray[mid ... size - 1]
+ through ppTmp, which has room for size elements. Of two equal elements, the
+ one of the first run comes first, so the sort is stable. */
+static void merge_runs(struct Elem **ppArray, wordnumber_t mid, 
+        wordnumber_t size, struct Elem **ppTmp,
+        int (*pCompare)(struct Elem *, struct Elem *))
+{
+  wordnumber_t i, j, k;
+  
+  if (!mid || mid == size || pCompare(ppArray[mid - 1], ppArray[mid]) <= 0)
+  {
+    return;
+  }
+  
+  i = 0;
+  j = mid;
+  k = 0;
+  
+  while (i < mid && j < size)
+  {
+    if (pCompare(ppArray[j], ppArray[i]) < 0)
+    {
+      ppTmp[k++] = ppArray[j++];
+    }
+    else
+    {
+      ppTmp[k++] = ppArray[i++];
+    }
+  }
+  
+  while (i < mid)
+  {
+    ppTmp[k++] = ppArray[i++];
+  }
+  
+  /* The rest of the second run is already in its place. */
+  memcpy(ppArray, ppTmp, k * sizeof(struct Elem *));
+}
+
+static void merge_sort(struct Elem **ppArray, wordnumber_t size, 
+        struct Elem **ppTmp, int (*pCompare)(struct Elem *, struct Elem *))
+{
+  wordnumber_t half;
+  
+  if (size <= INSERTION_SORT_SIZE)
+  {
+    insertion_sort(ppArray, size, pCompare);
+    return;
+  }
+  
+  half = size / 2;
+  merge_sort(ppArray, half, ppTmp, pCompare);
+  merge_sort(ppArray + half, size - half, ppTmp + half, pCompare);
+  merge_runs(ppArray, half, size, ppTmp, pCompare);
+}
+
+/* A sort task either sorts its part of the array (mid == 0), or merges the
+ two sorted runs it consists of. */
+static void *sort_task_main(void *pArg)
+{
+  struct SortTask *pTask;
+  
+  pTask = (struct SortTask *) pArg;
+  
+  if (pTask->mid)
+  {
+    merge_runs(pTask->ppArray, pTask->mid, pTask->size, pTask->ppTmp,
+           pTask->pCompare);
+  }
+  else
+  {
+    merge_sort(pTask->ppArray, pTask->size, pTask->ppTmp, pTask->pCompare);
+  }
+  
+  return 0;
+}
+
+/* Run every task in its own thread, and wait until all of them are done. */
+static void run_sort_tasks(struct SortTask *pTasks, int taskNum, 
+        struct Parameters *pParam)
+{
+  pthread_t threads[MAXTHREADS];
+  char logStr[MAXLOGMSGLEN];
+  int i;
+  
+  for (i = 0; i < taskNum; i++)
+  {
+    if (pthread_create(&threads[i], 0, sort_task_main, &pTasks[i]))
+    {
+      sprintf(logStr, "Can't create sorting thread %d", i);
+      log_msg(logStr, LOG_ERR, pParam);
+      exit(1);
+    }
+  }
+  
+  for (i = 0; i < taskNum; i++)
+  {
+    pthread_join(threads[i], 0);
+  }
+}
+
+/* Cut the array into pParam->threadNum parts and sort them in parallel. Then
+ merge neighbouring runs in pairs, until one run is left. The bounds of the
+ runs are kept in bounds[], run i is ppArray[bounds[i] ... bounds[i + 1] - 1].
+ */
+static void sort_in_parallel(struct Elem **ppArray, wordnumber_t size,
+        struct Elem **ppTmp, int (*pCompare)(struct Elem *, struct Elem *),
+        struct Parameters *pParam)
+{
+  struct SortTask tasks[MAXTHREADS];
+  wordnumber_t bounds[MAXTHREADS + 1];
+  int i, runNum, taskNum;
+  
+  runNum = pParam->threadNum;
+  
+  for (i = 0; i <= runNum; i++)
+  {
+    bounds[i] = size / runNum * i + (size % runNum) * i / runNum;
+  }
+  
+  for (i = 0; i < runNum; i++)
+  {
+    tasks[i].ppArray = ppArray + bounds[i];
+    tasks[i].ppTmp = ppTmp + bounds[i];
+    tasks[i].size = bounds[i + 1] - bounds[i];
+    tasks[i].mid = 0;
+    tasks[i].pCompare = pCompare;
+  }
+  
+  run_sort_tasks(tasks, runNum, pParam);
+  
+  while (runNum > 1)
+  {
+    taskNum = runNum / 2;
+    
+    for (i = 0; i < taskNum; i++)
+    {
+      tasks[i].ppArray = ppArray + bounds[2 * i];
+      tasks[i].ppTmp = ppTmp + bounds[2 * i];
+      tasks[i].size = bounds[2 * i + 2] - bounds[2 * i];
+      tasks[i].mid = bounds[2 * i + 1] - bounds[2 * i];
+      tasks[i].pCompare = pCompare;
+    }
+    
+    run_sort_tasks(tasks, taskNum, pParam);
+    
+    /* An odd run at the end is left for the next round. */
+    for (i = 0; i <= taskNum; i++)
+    {
+      bounds[i] = bounds[2 * i < runNum ? 2 * i : runNum];
+    }
+    bounds[(runNum + 1) / 2] = size;
+    runNum = (runNum + 1) / 2;
+  }
+}
+
+/* Sort the array in the order given by pCompare, i.e. with compare_words() or
+ compare_clusters(). The sort is stable. Arrays of at least
+ PARALLEL_SORT_SIZE elements are sorted with pParam->threadNum threads. */
+void sort_elements(struct Elem **ppArray, wordnumber_t size,
+        int (*pCompare)(struct Elem *, struct Elem *), 
+        struct Parameters *pParam)
+{
+  struct Elem **ppTmp;
+  
+  if (size <= INSERTION_SORT_SIZE)
+  {
+    insertion_sort(ppArray, size, pCompare);
+    return;
+  }
+  
+  ppTmp = (struct Elem **) malloc(sizeof(struct Elem *) * size);
+  if (!ppTmp)
+  {
+    log_msg(MALLOC_ERR_6033, LOG_ERR, pParam);
+    exit(1);
+  }
+  
+  if (pParam->threadNum > 1 && size >= PARALLEL_SORT_SIZE)
+  {
+    sort_in_parallel(ppArray, size, ppTmp, pCompare, pParam);
+  }
+  else
+  {
+    merge_sort(ppArray, size, ppTmp, pCompare);
+  }
+  
+  free((void *) ppTmp);
+}
+
+/* Move element i of the heap ppHeap[0 ... size - 1] down to its place. The
+ root of the heap is the element that comes last in the order of pCompare. */
+static void sift_down(struct Elem **ppHeap, wordnumber_t i, wordnumber_t size,
+        int (*pCompare)(struct Elem *, struct Elem *))
+{
+  wordnumber_t child;
+  struct Elem *tmp;
+  
+  tmp = ppHeap[i];
+  
+  while ((child = 2 * i + 1) < size)
+  {
+    if (child + 1 < size && pCompare(ppHeap[child + 1], ppHeap[child]) > 0)
+    {
+      child++;
+    }
+    
+    if (pCompare(ppHeap[child], tmp) <= 0)
+    {
+      break;
+    }
+    
+    ppHeap[i] = ppHeap[child];
+    i = child;
+  }
+  
+  ppHeap[i] = tmp;
+}
+
+/* Move the k elements that come first in the order of pCompare to ppArray[0
+ ... k - 1], sorted, and return the number of these elements (less than k if
+ the array is smaller). The rest of the array is left unsorted. The k elements
+ are kept in a heap while the array is scanned, so this takes O(size * log k)
+ time. If k is 0, the whole array is sorted with sort_elements(). */
+wordnumber_t sort_top_elements(struct Elem **ppArray, wordnumber_t size,
+        wordnumber_t k, int (*pCompare)(struct Elem *, struct Elem *),
+        struct Parameters *pParam)
+{
+  wordnumber_t i;
+  struct Elem *tmp;
+  
+  if (!k || k >= size)
+  {
+    sort_elements(ppArray, size, pCompare, pParam);
+    return size;
+  }
+  
+  for (i = k / 2; i > 0; i--)
+  {
+    sift_down(ppArray, i - 1, k, pCompare);
+  }
+  
+  for (i = k; i < size; i++)
+  {
+    if (pCompare(ppArray[i], ppArray[0]) < 0)
+    {
+      tmp = ppArray[0];
+      ppArray[0] = ppArray[i];
+      ppArray[i] = tmp;
+      sift_down(ppArray, 0, k, pCompare);
+    }
+  }
+  
+  /* Heap sort of the k elements: the root is moved behind the heap. */
+  for (i = k - 1; i > 0; i--)
+  {
+    tmp = ppArray[0];
+    ppArray[0] = ppArray[i];
+    ppArray[i] = tmp;
+    sift_down(ppArray, 0, i, pCompare);
+  }
+  
+  return k;
+}
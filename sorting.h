@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2016 Zhuge Chen, Risto Vaarandi and Mauno Pihelgas
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/* 
+ * File:   sorting.h
+ * 
+ * Content: Declarations of global functions in sorting.c .
+ *
+ * Created on October 16, 2026, 9:25 PM
+ */
+
+#ifndef SORTING_H
+#define SORTING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  
+int compare_words(struct Elem *pElem1, struct Elem *pElem2);
+int compare_clusters(struct Elem *pElem1, struct Elem *pElem2);
+void sort_elements(struct Elem **ppArray, wordnumber_t size,
+        int (*pCompare)(struct Elem *, struct Elem *), 
+        struct Parameters *pParam);
+wordnumber_t sort_top_elements(struct Elem **ppArray, wordnumber_t size,
+        wordnumber_t k, int (*pCompare)(struct Elem *, struct Elem *),
+        struct Parameters *pParam);
+  
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SORTING_H */
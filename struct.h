@@ -29,15 +29,16 @@
 #ifdef __cplusplus
 extern "C" {
 #endif
-
+  
 #include "macro.h"
 #include <regex.h>
+#include <stdio.h>
 #include <time.h>
-
+  
 /* ==== Struct definitions ==== */
-
+  
 struct Cluster;    //declaration
-
+  
 /* This struct stores input file(s)'s path(s).
  
  lineNumber is the count of lines of this file. It is used for debug purpose,
@@ -47,11 +48,115 @@ struct InputFile {
   linenumber_t lineNumber;
   struct InputFile *pNext;
 };
-
+  
+/* This struct describes a byte range [start, end) of an input file. A chain of
+ InputChunk-s is a region of the data set, which is processed by one worker
+ thread when '--threads' option is used.
+ 
+ A line belongs to the chunk in which its first byte lies. Therefore a chunk
+ that starts in the middle of a line skips that line, and a chunk that ends in
+ the middle of a line finishes it. end is -1 if the size of the file is not
+ known in advance, e.g. when it can not be stat()-ed. In this case the whole
+ file is one chunk. */
+struct InputChunk {
+  struct InputFile *pFile;
+  long start;
+  long end;
+  struct InputChunk *pNext;
+};
+  
+/* This struct stores the reading position in a region (a chain of
+ InputChunk-s). pChunk is the chunk being read. pData is the content of its
+ input file, which is mapped into memory with mmap() (bMapped is set). If the
+ file can not be mapped, pData is a buffer of INPUT_BUFFER_SIZE bytes, which
+ holds the bytes of the file from offset base on, and is refilled from fd 
+ while the file is read; fd is -1 once the end of the file is reached. size is
+ the size of pData, and pos is the offset of the next line in it. bOpened
+ tells whether the file of pChunk is opened already, and bAtLineStart tells
+ whether pos is the beginning of a new line, rather than the continuation of a
+ line that was longer than MAXLINELEN. */
+struct RegionReader {
+  struct InputChunk *pChunk;
+  char *pData;
+  long base;
+  long size;
+  long pos;
+  int fd;
+  char bMapped;
+  char bOpened;
+  char bAtLineStart;
+};
+  
+/* This struct describes one word of a log line: the word is the len bytes at
+ offset in the tokenized text of the line (see struct LineTokens). An empty
+ word has a length of 0. hash is the str2hash() value of the word with 
+ pParam->wordTableSeed. It is computed once by find_word_spans(), and is used
+ for both the word sketch and the word table. */
+struct WordSpan {
+  int offset;
+  int len;
+  tableindex_t hash;
+};
+  
+/* This struct stores the words of one log line, found by find_word_spans().
+ 
+ pText is the text that the spans in words[] point into. It is the line
+ itself, or pBuffer if the line was converted with '--template' option.
+ pBuffer is allocated on demand and reused for the following lines, and
+ bufferSize is its size. It is freed by free_line_tokens(). */
+struct LineTokens {
+  char *pText;
+  int wordcount;
+  struct WordSpan words[MAXWORDS];
+  char *pBuffer;
+  int bufferSize;
+};
+  
+/* A block of memory of an arena (see arena.c). The block is mapped with mmap(),
+ and its first bytes hold this header. used is the number of bytes handed out,
+ including the header. */
+struct ArenaBlock {
+  struct ArenaBlock *pNext;
+  size_t size;
+  size_t used;
+};
+  
+/* A bump-pointer arena. Objects are allocated from the first block of
+ pBlocks, and are never freed one by one. All of them are released together by
+ free_arena(). blockSize is the size of a new block, unless a larger object
+ needs a larger one. */
+struct Arena {
+  struct ArenaBlock *pBlocks;
+  size_t blockSize;
+};
+  
+/* This struct stores the reading position in the token cache (see
+ token_cache.c). The records in [pos, end) of pData are read. */
+struct TokenCacheReader {
+  unsigned char *pData;
+  long pos;
+  long end;
+};
+  
+/* This struct stores the words of one log line, as read from the token cache.
+ ppWords[i] is the frequent word at the position i of the line, or 0 if the
+ word there is not frequent. bReplaced[i] is set if ppWords[i] is not the
+ original word, but the word made from it by '--wsearch' and '--wreplace'
+ options. */
+struct CachedLine {
+  int wordcount;
+  struct Elem *ppWords[MAXWORDS];
+  char bReplaced[MAXWORDS];
+};
+  
 /* This struct stores elements that are placed into hash tables. One element can
  be a word or a cluster candidate.
  
- pKey is the identifier(description).
+ pKey is the identifier(description). The elements of the cluster table are
+ identified by the IDs of their frequent words instead of a string, so their
+ pKey holds an array of wordnumber_t, see add_cluster_elem(). keyLen is the
+ length of pKey: of a word without the terminating 0, which is not the first
+ 0 if the word contains 0 bytes, and of a cluster key in bytes.
  
  count increments every time when element's identifier occurs.
  
@@ -63,16 +168,98 @@ struct InputFile {
  candidate. Between Elem and Cluster, there is a bidirectional link pointing to
  each other.
  
- pNext points to the next element that shares the same hash slot, if there is
- any. */
+ hash is the full hash value of pKey in its table, see str2hash() and
+ clusterkey2hash(). It is kept so that the key is never hashed again, e.g. when
+ the element is merged into another table, or when a frequent word is put into
+ the prefix sketch of '--aggrsup' option. */
 struct Elem {
   char *pKey;
   support_t count;
   wordnumber_t number;
   struct Cluster *pCluster;
-  struct Elem *pNext;
+  tableindex_t hash;
+  int keyLen;
 };
-
+  
+/* One slot of struct HashTable. hash is the full (not reduced) hash value of
+ the key of pElem. It is compared before the key itself, and it is used to
+ find the home slot of pElem again when the table grows. An empty slot has
+ pElem == 0. */
+struct HashSlot {
+  tableindex_t hash;
+  struct Elem *pElem;
+};
+  
+/* A minimal perfect hash function of a frozen table, with a Bloom filter in
+ front of it (see perfect_hash.c). The keys are divided into bucketMask + 1
+ buckets, and the pilot of a bucket is the number that sends all of its keys
+ to different slots. pFilter has filterMask + 1 words, and a key sets some bits
+ in one of them. seed is mixed into the hash values of the keys; it is changed
+ when no pilots are found. pPilots is 0 if there is no perfect hash function.
+ */
+struct PerfectHash {
+  unsigned int *pPilots;
+  tableindex_t bucketMask;
+  tableindex_t *pFilter;
+  tableindex_t filterMask;
+  tableindex_t seed;
+};
+  
+/* An open addressing hash table with linear probing and Robin Hood insertion
+ (see hash_table_processing.c). size is the number of slots, always a power of
+ two. The home slot of a hash value is given by its top bits after a
+ multiplication by the 64-bit golden ratio constant, shift is the number of the
+ discarded bits. elemNum is the number of occupied slots. seed is the initial
+ value of the hash function. bFrozen is set by freeze_hash_table(), after which
+ the table is only searched. If the table was frozen with a perfect hash
+ function, every slot is occupied and size is the number of elements. */
+struct HashTable {
+  struct HashSlot *pSlots;
+  tableindex_t size;
+  tableindex_t elemNum;
+  tableindex_t seed;
+  int shift;
+  char bFrozen;
+  struct PerfectHash perfectHash;
+};
+  
+/* A slot of the word dependency table: the number of lines in which a pair of
+ frequent words occurs together. key holds the numbers of both words (see
+ hash_table_processing.c), 0 means an empty slot. */
+struct WordDepSlot {
+  tableindex_t key;
+  support_t count;
+};
+  
+/* The word dependency table of '--wweight' option, an open addressing hash
+ table with linear probing. Only the pairs that really occur together are
+ stored. size is the number of slots, always a power of two, and shift is the
+ number of the discarded bits of the home slot, like in struct HashTable. */
+struct WordDepTable {
+  struct WordDepSlot *pSlots;
+  tableindex_t size;
+  tableindex_t elemNum;
+  int shift;
+};
+  
+/* A Count-Min sketch of depth rows with width counters each (see sketch.c).
+ The counters are counterSize bytes wide (1, 2, 4 or sizeof(support_t)), and
+ stop at maxCount. Row r of pCounters begins at counter r * width, and its
+ slots are found with the seed rowSeeds[r]. rowSeeds[0] is the seed given to
+ init_sketch(), so a sketch of depth 1 is the plain single-row sketch. If
+ bConservative is set, an insertion only raises the counters that hold the
+ current minimum (conservative update), otherwise every row is raised, and
+ counts can also be removed. */
+struct Sketch {
+  void *pCounters;
+  tableindex_t width;
+  support_t maxCount;
+  tableindex_t rowSeeds[MAXSKETCHDEPTH];
+  int depth;
+  int counterSize;
+  char bConservative;
+};
+  
 /* This struct stores information of templates, which is set with option
  '--template'. */
 struct TemplElem {
@@ -80,7 +267,7 @@ struct TemplElem {
   int data;
   struct TemplElem *pNext;
 };
-
+  
 /* Word frequency statistics. */
 struct WordFreqStat {
   wordnumber_t ones;
@@ -89,7 +276,7 @@ struct WordFreqStat {
   wordnumber_t tens;
   wordnumber_t twenties;
 };
-
+  
 /* This struct stores detailed information about cluster candidates(potential
  clusters). It has a bidirectional link with {struct Elem}.
  
@@ -113,9 +300,9 @@ struct WordFreqStat {
  ppWord is an array that stores each constant's element, which is stored in word
  hash table.
  
- If Aggregate_Supports heuristics is used('--aggrsup' option), pLastNode is the
- address of the cluster candidate's last node in prefix tree. According to this
- address, this cluster candidate's parent and other relatives can be back
+ If Aggregate_Supports heuristics is used('--aggrsup' option), lastNode is the
+ index of the cluster candidate's last node in prefix tree. According to this
+ index, this cluster candidate's parent and other relatives can be back
  tracked. Prefix tree(aka trie) is build for efficiently looking up for cluster
  candidates that have a common prefix, thus efficiently checking if one cluster
  candidate's support value can be aggregated to another.
@@ -141,11 +328,25 @@ struct Cluster {
   int *fullWildcard;
   struct Elem *pElem;
   struct Elem **ppWord;
-  struct TrieNode *pLastNode;
+  unsigned int lastNode;
   char bIsJoined;
   struct Cluster *pNext;
 };
-
+  
+/* The cluster candidates with the same number of constants, by columns (see
+ candidate_store.c). Row j is the candidate ppClusters[j]. 
+ CANDIDATE_WORDS(pGroup, j) are the elements of its constants (frequent
+ words), and CANDIDATE_WILDCARDS(pGroup, j) are its wildcard ranges, in the
+ layout of ppWord and fullWildcard of {struct Cluster}. The rows are the
+ storage of the candidate: its ppWord and fullWildcard point to them. */
+struct CandidateGroup {
+  int constants;
+  wordnumber_t num;
+  struct Cluster **ppClusters;
+  struct Elem **ppWords;
+  int *pWildcards;
+};
+  
 /*This struct is dedicated to Join_Clusters heuristics.
  
  More details are in the description of {struct ClusterWithToken}. */
@@ -153,7 +354,7 @@ struct Token {
   struct Elem *pWord;
   struct Token *pNext;
 };
-
+  
 /*This struct is dedicated to Join_Clusters heuristics.
  
  If a cluster has token, this cluster's bIsJoined will be marked, and this
@@ -187,7 +388,7 @@ struct ClusterWithToken {
   int *fullWildcard;
   struct Elem *pElem;
   struct Elem **ppWord;
-  struct TrieNode  *pLastNode;
+  unsigned int lastNode;
   char bIsJoined;
   struct ClusterWithToken *pNext;
   
@@ -196,51 +397,84 @@ struct ClusterWithToken {
    transfered to each other.*/
   struct Token **ppToken;
 };
-
+  
+/* The inverted index of the cluster candidates, see cluster_index.c. The
+ candidates that have the frequent word with number n as a constant are the
+ IDs pPostings[pOffsets[n] ... pOffsets[n + 1] - 1], in ascending order. The
+ candidates of pCandidateGroups[i] have the IDs from firstId[i] on, up to
+ firstId[i + 1] - 1. postingNum is the size of pPostings[]. */
+struct ClusterIndex {
+  wordnumber_t *pOffsets;
+  wordnumber_t *pPostings;
+  wordnumber_t postingNum;
+  wordnumber_t firstId[MAXWORDS + 2];
+};
+  
 /* This struct is dedicated to Aggregate_Supports heuristics.
  
  Every node is a constant or wildcard(*{min,max}) in cluster candidates.
  
- Every node has only one pParent, pNext and pChlid.
+ All the nodes are in one array, pParam->pTrieNodes[], with the root at index
+ 0, and they refer to each other by their 32-bit indices in the array. The
+ children of a node are childNum neighbours from firstChild on, and parent is
+ the index of the parent (the root is its own parent). subtreeSize is the
+ number of the nodes below the node.
  
  pIsEnd indicates a cluster candidates ends in this node, and stores the address
  of {struct Cluster}. Otherwise, it shall be null(0).
  
  When node is a constant(frequent word), pWord stores the address of
- {struct Elem}.
+ {struct Elem}. Every frequent word has exactly one element, so two constants
+ are the same word if their pWord-s are equal.
  
- When node is a wildcard, we store its minimum and maximum value in wildcardMin
- and wildcardMax.
+ When node is a wildcard, pWord is null(0), and we store its minimum and maximum
+ value in wildcardMin and wildcardMax. The maximum of a wildcard is never 0,
+ which tells the wildcards from the constants.
  
- hashValue is for efficiently inserting and looking up. Only if their 
- hashValue-s are equal, we will then use strcmp() or wildcardMin/Max compare to
- see if the node to be inserted is already exist, because strcmp() is an 
- expensive process regarding computing speed.
- 
- When node is a constant, hashValue is calculated by str2hash() function, with a
- hash module size (frequent word number) * 3.
- 
- When node is a wildcard, its hashValue is (frequent word number) * 3. Thus, all
- wildcards, regardless of their minimun and maximum, have the same hashValue.
- 
- Nodes in the same horizontal level and with a common parent, are arranged
- from left to right with a descending hashValue. Therefore, when inserting new
- node in prefix tree, we check if it already exist by comparing hashValue, with
- an order from big to small. In other words, wildcards are always in the front
- part of comparison, which takes advantage of the statistics feature of cluster 
- candidates.
+ The children of a node are sorted by the order of compare_trie_items() in
+ aggregate_supports_heuristic.c: the wildcards come first, then the constants
+ by their word numbers.
  */
 struct TrieNode {
-  struct TrieNode *pParent;
-  struct TrieNode *pNext;
-  struct TrieNode *pChild;
+  struct Elem *pWord;
   struct Cluster *pIsEnd;
+  unsigned int parent;
+  unsigned int firstChild;
+  unsigned int childNum;
+  unsigned int subtreeSize;
+  int wildcardMin;
+  int wildcardMax;
+};
+  
+/* One node of the path of a cluster candidate through the prefix tree, a
+ constant (pWord) or a wildcard (pWord is 0, wildcardMin and wildcardMax). */
+struct TrieItem {
   struct Elem *pWord;
   int wildcardMin;
   int wildcardMax;
-  wordnumber_t hashValue;
 };
-
+  
+/* The path of a cluster candidate through the prefix tree: its itemNum nodes
+ below the root. The paths are sorted to build the tree, see 
+ build_prefix_trie(). */
+struct TriePath {
+  struct TrieItem *pItems;
+  int itemNum;
+  struct Cluster *pCluster;
+};
+  
+  
+/* A buffered writer of a file descriptor, see output_writer.c. pBuffer holds
+ used bytes of output that were not handed to write() yet. recordNum counts the
+ records (e.g. clusters) that were written, it gives the ID of the next one. */
+struct OutputWriter {
+  int fd;
+  char *pBuffer;
+  size_t size;
+  size_t used;
+  wordnumber_t recordNum;
+};
+  
 /* This struct stores parameters. It can be considered as a storage for global
  variables. Sorry that so many parameters were put into this struct. For the 
  sake of manageability of future updates, this issue would be properly fixed in 
@@ -249,18 +483,23 @@ struct Parameters {
   /* >>> Below are parameters that can be changed by command line options. */
   char bAggrsupFlag;
   char bDetailedTokenFlag;
-  char *pDelim;
+  char bWordDepPassFlag;
+char *pDelim;
   char *pFilter;
   char *pOutlier;
   char *pSyslogFacility;
+  char *pTokenCache;
   char *pWordFilter;
   char *pWordReplace;
   char *pWordSearch;
   double pctSupport;
+  double wordSampleRate;
   double wordWeightThreshold;
   int byteOffset;
   int debug;
+  int outputFormat;
   int outputMode;
+  int threadNum;
   int wordWeightFunction;
   struct InputFile *pInputFiles;
   struct TemplElem *pTemplate;
@@ -269,6 +508,11 @@ struct Parameters {
   tableindex_t wordSketchSize;
   tableindex_t wordTableSize;
   unsigned int initSeed;
+  wordnumber_t topNum;
+  
+  /* Number of rows of the word sketch and of the cluster sketch, the number
+   of counters in a row is given by wordSketchSize and clusterSketchSize. */
+  int sketchDepth;
   
   /* >>> Below are parameters that are not visible to user. */
   
@@ -292,19 +536,35 @@ struct Parameters {
   regex_t delim_regex;
   regex_t filter_regex;
   
+  /* If the separator is a simple one (a single byte or a bracket expression,
+   optionally followed by '+'), bSimpleDelim is set, and the words are split
+   by scanning the bytes of the line instead of calling regexec(). 
+   delimSet[] marks the bytes matched by the separator, and delimBytes[] lists
+   them (delimByteNum of them). bDelimRepeat is set if the separator ends with
+   '+', i.e. a run of separator bytes is one separator. */
+  char bSimpleDelim;
+  char bDelimRepeat;
+  int delimByteNum;
+  unsigned char delimBytes[256];
+  unsigned char delimSet[256];
+  
   /* pClusterFamily[] stores {struct Cluster} according to their constants. */
   struct Cluster *pClusterFamily[MAXWORDS + 1];
   
-  /* ppClusterTable stores the pointer of every cluster candidate elem. So
-   does ppWordTable. */
-  struct Elem **ppClusterTable;
-  struct Elem **ppWordTable;
+  /* The same candidates by columns, built after Step2.B. It has 
+   biggestConstants + 1 groups, pCandidateGroups[i] holds the candidates of
+   pClusterFamily[i] in the same order. */
+  struct CandidateGroup *pCandidateGroups;
+  
+  /* clusterTable stores the pointer of every cluster candidate elem. So does
+   wordTable. */
+  struct HashTable clusterTable;
+  struct HashTable wordTable;
   
-  support_t *pClusterSketch;
-  support_t *pWordSketch;
+  struct Sketch clusterSketch;
+  struct Sketch wordSketch;
   tableindex_t clusterSketchSeed;
   tableindex_t clusterTableSeed;
-  tableindex_t clusterTableSize;
   tableindex_t wordSketchSeed;
   tableindex_t wordTableSeed;
   
@@ -317,23 +577,13 @@ struct Parameters {
   
   /* >>>>>> Used in Aggregate_Supports heuristics. */
   
-  /* prefixWildcardMax/Min are used for temporary storage, when comparing
-   wildcard nodes to see if it already exist. */
-  int prefixWildcardMax;
-  int prefixWildcardMin;
-  
-  /* pPrefixRet is used for temporary storage. */
-  struct TrieNode *pPrefixRet;
-  
-  /* pPrefixRoot is the root of the prefix tree. */
-  struct TrieNode *pPrefixRoot;
-  
-  tableindex_t prefixSketchSeed;
-  
-  /* prefixSketchSize will be set to (frequent word number) * 3. */
-  wordnumber_t prefixSketchSize;
+  /* pTrieNodes[] are the trieNodeNum nodes of the prefix tree, the root is
+   pTrieNodes[0]. */
+  struct TrieNode *pTrieNodes;
   
-  wordnumber_t wildcardHash;
+  /* The inverted index from the frequent words to the cluster candidates,
+   built from the column store before the prefix tree. */
+  struct ClusterIndex clusterIndex;
   
   /* >>>>>> Used in Join_Clusters heuristics. */
   
@@ -365,21 +615,35 @@ struct Parameters {
   tableindex_t joinedClusterInputNum;
   tableindex_t joinedClusterOutputNum;
   
-  /* Word Dependency Matrix Breadth will be (number of frequent words) + 1. */
-  tableindex_t wordDepMatrixBreadth;
-  
   /* Short for wordNumberStorage, used for temporarily storing the constants'
    numbers, as their identifier. The numbers will be used to update word
-   dependency matrix. */
+   dependency table. */
   wordnumber_t wordNumStr[MAXWORDS + 1];
   
-  /* This matrix is a square matrix. We need one pass over the data set to get
-   this matrix. The matrix will be updated each time after each reading of a
-   single log line. To optimize performance, this pass over the data set is
-   integrated with find_cluster_candidates() (doing two different jobs at
-   the same pass over the data set). */
-  wordnumber_t *wordDepMatrix;
-  
+  /* For every pair of frequent words, the number of lines in which they occur
+   together; for a word with itself, the number of lines in which it occurs.
+   We need one pass over the data set to get this table. The table will be
+   updated each time after each reading of a single log line. To optimize
+   performance, this pass over the data set is integrated with
+   find_cluster_candidates() (doing two different jobs at the same pass over
+   the data set). */
+  struct WordDepTable wordDepTable;
+  
+  /* With '--wdeppass' option, the word dependencies are only counted for the
+   constants of the clusters, in a pass of their own. pWordDepIndex[] maps the
+   number of a frequent word to its index in wordDepTable, which goes from 1
+   to wordDepWordNum, or to 0 if the word is not a constant of any cluster.
+   Without the option, pWordDepIndex is 0 and the frequent word numbers are
+   used as they are. */
+  wordnumber_t *pWordDepIndex;
+  wordnumber_t wordDepWordNum;
+  
+  /* >>>>>> Used in printing the clusters. */
+  
+  /* The clusters are written to the standard output through outputWriter, in
+   the format of '--outputformat' option. */
+  struct OutputWriter outputWriter;
+
   /* >>>>>> Used in '--debug' option. */
   
   /* Temporarily storage cluster candidates' description before printing them
@@ -398,7 +662,6 @@ struct Parameters {
   support_t totalLineNum;
   char totalLineNumDigit[MAXDIGITBIT];  //digit format with comma, e.g. 123,456
   
-  time_t timeStorage;
   
   /* >>>>>> Used in '--wfilter/--wsearch/--wreplace'options. */
   
@@ -416,9 +679,141 @@ struct Parameters {
    added in the future that are sensitive to this issue. */
   char tmpStr[MAXWORDLEN];
   
+  /* >>>>>> Used in '--tokencache' option. */
+  
+  /* bTokenCacheReady is set by step_1_build_token_cache(), when the token
+   cache holds the frequent word IDs of all lines. From then on, the passes
+   over the data set read the cache instead of tokenizing the lines. */
+  char bTokenCacheReady;
+  
+  /* The vocabulary pass writes the raw cache in tokenCachePartNum parts
+   (ppCacheParts[]), one per worker thread. The raw cache holds vocabulary
+   numbers, which are not known to be frequent or not yet. ppCachePartMaps[i]
+   maps the local numbers of the private word table of worker i to the numbers
+   of the merged word table. It is 0 if the numbers of the parts are global
+   already. */
+  int tokenCachePartNum;
+  FILE **ppCacheParts;
+  wordnumber_t **ppCachePartMaps;
+  
+  /* pVocabToFrequent[] maps the vocabulary numbers to the frequent word IDs
+   (0 if the word is infrequent). It is filled by step_1_find_frequent_words()
+   and freed after the cache is built. */
+  wordnumber_t *pVocabToFrequent;
+  
+  /* ppFrequentWords[id] is the frequent word with the ID id. */
+  struct Elem **ppFrequentWords;
+  
+  /* The final cache, mapped into memory. */
+  unsigned char *pCacheData;
+  long cacheSize;
+  
+  /* Offsets of every TOKENCACHE_CHECKPOINT-th record of the final cache. They
+   are used to split the cache between worker threads. */
+  long *pCacheCheckpoints;
+  long cacheCheckpointNum;
+  
+  /* >>>>>> Arenas, one per phase of the program (see arena.c). */
+  
+  /* The elements of the word table and their keys. */
+  struct Arena wordArena;
+  
+  /* The elements of the cluster table, their keys, and the cluster
+   instances. */
+  struct Arena clusterArena;
+  
+  /* The ppWord and fullWildcard arrays of the cluster instances, while the
+   candidates are found. They are released when the arrays are moved into the
+   column store (see candidate_store.c). */
+  struct Arena candidateArena;
+  
+  /* The cluster instances with tokens of '--wweight' option, and their
+   tokens. */
+  struct Arena joinArena;
+  
 };
-
-
+  
+  
+/* This struct stores the context of one worker thread, when '--threads'
+ option is used.
+ 
+ param is a private copy of the global parameters. The regular expressions in
+ it are compiled again for every thread, because regexec() serializes the
+ callers that share one regex_t. The tables in it (e.g. wordTable) are
+ replaced with thread-local ones by the worker function, and merged into the
+ global ones by the main thread after all the workers are done.
+ 
+ pRegion is the chain of input file chunks that this worker processes.
+ 
+ pWork is the function that the worker thread runs.
+ 
+ linecount and elemNum are the results of the worker: the number of lines it
+ has read, and the number of distinct elements it has put into its local
+ table.
+ 
+ If the token cache is ready, the worker reads the records [cacheStart,
+ cacheEnd) of the cache, instead of the lines of pRegion.
+ 
+ pOutput is the temporary file into which the worker writes the outliers of its
+ region, see find_outliers_in_parallel(). */
+struct WorkerContext {
+  int id;
+  struct Parameters param;
+  struct Parameters *pGlobalParam;
+  struct InputChunk *pRegion;
+  void (*pWork)(struct WorkerContext *);
+  support_t linecount;
+  wordnumber_t elemNum;
+  long cacheStart;
+  long cacheEnd;
+  FILE *pOutput;
+};
+  
+/* A part of the array that is sorted by one thread in sort_elements(). If mid
+ is not 0, the part consists of two sorted runs, ppArray[0 ... mid - 1] and
+ ppArray[mid ... size - 1], which are merged instead. ppTmp is the scratch
+ space of the part, with room for size elements. */
+struct SortTask {
+  struct Elem **ppArray;
+  struct Elem **ppTmp;
+  wordnumber_t size;
+  wordnumber_t mid;
+  int (*pCompare)(struct Elem *, struct Elem *);
+};
+  
+/* An answer of find_more_specific_cached(): sum is the total count of the
+ candidates that end below trie node node and match the suffix of pCluster
+ from its constant constant on (0 is the tail only). hash is the hash value of
+ the suffix, see hash_suffix(). The entry is empty if pCluster is 0. */
+struct AggregateMemoEntry {
+  struct Cluster *pCluster;
+  tableindex_t hash;
+  support_t sum;
+  unsigned int node;
+  int constant;
+};
+  
+/* The cache of find_more_specific_cached(), AGGREGATE_MEMO_SIZE entries of
+ which every query has one slot. A new answer replaces the one in its slot.
+ lookups and hits are counted for the log. */
+struct AggregateMemo {
+  struct AggregateMemoEntry *pEntries;
+  wordnumber_t lookups;
+  wordnumber_t hits;
+};
+  
+/* The work of a thread of '--aggrsup' option, see 
+ aggregate_candidates_in_parallel(). The candidates ppCandidates[0 ... 
+ candidateNum - 1] are shared by all the threads, and *pCursor is the first
+ one that no thread has taken yet. Every thread has its own cache. */
+struct AggregateTask {
+  struct Cluster **ppCandidates;
+  wordnumber_t candidateNum;
+  wordnumber_t *pCursor;
+  struct AggregateMemo memo;
+  struct Parameters *pParam;
+};
+  
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,41 @@
+#!/bin/sh
+#
+# Regression test for the '--threads' option: the clusters that are joined
+# with '--wweight' must be the same, with their tokens in the same order, as
+# without threads.
+#
+# Usage: threads_wweight.sh <path of logclusterc>
+
+BIN=${1:-dist/Release/GNU-Linux/logclusterc}
+TMP=${TMPDIR:-/tmp}/logclusterc_test.$$
+
+trap 'rm -f "$TMP".in "$TMP".1 "$TMP".4' 0
+
+awk 'BEGIN {
+  split("root user admin guest backup", who, " ");
+  for (i = 0; i < 20000; i++)
+  {
+    printf("Session opened for %s from host%d\n", who[(i * 7) % 5 + 1],
+           (i * 31) % 6);
+  }
+}' > "$TMP".in
+
+"$BIN" --input="$TMP".in --support=100 --wweight=0.5 --threads=1 \
+  > "$TMP".1 2>/dev/null || exit 1
+"$BIN" --input="$TMP".in --support=100 --wweight=0.5 --threads=4 \
+  > "$TMP".4 2>/dev/null || exit 1
+
+if ! grep -q '(' "$TMP".1
+then
+  echo "threads_wweight: no joined clusters in the output"
+  exit 1
+fi
+
+if ! cmp -s "$TMP".1 "$TMP".4
+then
+  echo "threads_wweight: --threads=1 and --threads=4 give different clusters"
+  diff "$TMP".1 "$TMP".4
+  exit 1
+fi
+
+echo "threads_wweight: OK"
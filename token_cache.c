@@ -0,0 +1,440 @@
+/*
+ * Copyright (C) 2016 Zhuge Chen, Risto Vaarandi and Mauno Pihelgas
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/* 
+ * File:   token_cache.c
+ * 
+ * Content: Functions related to the token cache of '--tokencache' option.
+ *
+ * The token cache stores every line of the data set (in the order of
+ * read_region_line()) as a record of varints: the number of words of the line,
+ * followed by one value per word.
+ *
+ * The vocabulary pass writes the raw cache, in which a word is stored with its
+ * vocabulary number (0 if the word was not put into the vocabulary). With
+ * '--wfilter' option, every word is stored with two numbers: the one of the
+ * original word, and the one of the word made by '--wsearch' and '--wreplace'
+ * options (0 if the word is not filtered).
+ *
+ * After the frequent words are found, step_1_build_token_cache() rewrites the
+ * cache, so that a word is stored as (ID << 1 | bReplaced), where ID is the
+ * frequent word ID, and bReplaced tells if it is the ID of the replaced word.
+ * An infrequent word is stored as 0.
+ *
+ * Created on October 16, 2026, 4:10 PM
+ */
+
+/* For fileno() and posix_madvise(). */
+#define _POSIX_C_SOURCE 200112L
+
+#include "common_header.h"
+#include "token_cache.h"
+
+#include <string.h>    /* for strcpy(), strlen(), etc. */
+#include <unistd.h>    /* for unlink() */
+#include <sys/mman.h>  /* for mmap() and munmap() */
+
+#include "output.h"
+
+static FILE *create_cache_file(char *pName, struct Parameters *pParam);
+static unsigned char *map_cache_file(FILE *pFile, long *pSize,
+        struct Parameters *pParam);
+static int put_varint(unsigned char *pBuffer, unsigned long value);
+static int get_varint(struct TokenCacheReader *pReader, unsigned long *pValue);
+static void add_cache_checkpoint(long offset, struct Parameters *pParam);
+
+/* Create the partNum parts of the raw cache, one for every worker thread of
+ the vocabulary pass. The parts are named <cache_file>.<part>. */
+void open_token_cache_parts(int partNum, struct Parameters *pParam)
+{
+  char *pName;
+  int i;
+  
+  pParam->ppCacheParts = (FILE **) malloc(sizeof(FILE *) * partNum);
+  pName = (char *) malloc(strlen(pParam->pTokenCache) + MAXDIGITBIT + 2);
+  if (!pParam->ppCacheParts || !pName)
+  {
+    log_msg(MALLOC_ERR_6027, LOG_ERR, pParam);
+    exit(1);
+  }
+  
+  for (i = 0; i < partNum; i++)
+  {
+    sprintf(pName, "%s.%d", pParam->pTokenCache, i);
+    pParam->ppCacheParts[i] = create_cache_file(pName, pParam);
+  }
+  
+  pParam->tokenCachePartNum = partNum;
+  
+  free((void *) pName);
+}
+
+/* Append the record of one line to a part of the raw cache. pNumbers holds
+ one vocabulary number per word, or two with '--wfilter' option. */
+void write_token_cache_record(FILE *pFile, wordnumber_t *pNumbers,
+        int wordcount, struct Parameters *pParam)
+{
+  unsigned char buffer[(2 * MAXWORDS + 1) * 10];
+  int i, len, valueNum;
+  
+  valueNum = pParam->pWordFilter ? 2 * wordcount : wordcount;
+  
+  len = put_varint(buffer, (unsigned long) wordcount);
+  for (i = 0; i < valueNum; i++)
+  {
+    len += put_varint(buffer + len, (unsigned long) pNumbers[i]);
+  }
+  
+  fwrite(buffer, 1, len, pFile);
+}
+
+/* Rewrite the raw cache parts into the final cache, with frequent word IDs
+ instead of vocabulary numbers. pParam->pVocabToFrequent must be filled by
+ step_1_find_frequent_words() before. Afterwards the final cache is mapped
+ into memory, and the raw parts are closed. */
+void step_1_build_token_cache(struct Parameters *pParam)
+{
+  struct TokenCacheReader reader;
+  struct Elem *ptr;
+  FILE *pCacheFile;
+  unsigned char buffer[(MAXWORDS + 1) * 10];
+  unsigned char *pPart;
+  unsigned long value, wordcount, number, replaced;
+  wordnumber_t *pMap;
+  tableindex_t j;
+  long partSize, offset, recordNum;
+  int i, len, k;
+  
+  log_msg("Building token cache...", LOG_NOTICE, pParam);
+  
+  pParam->ppFrequentWords = (struct Elem **) malloc(sizeof(struct Elem *) *
+                            (pParam->freWordNum + 1));
+  if (!pParam->ppFrequentWords)
+  {
+    log_msg(MALLOC_ERR_6027, LOG_ERR, pParam);
+    exit(1);
+  }
+  
+  pParam->ppFrequentWords[0] = 0;
+  for (j = 0; j < pParam->wordTable.size; j++)
+  {
+    ptr = pParam->wordTable.pSlots[j].pElem;
+    if (ptr)
+    {
+      pParam->ppFrequentWords[ptr->number] = ptr;
+    }
+  }
+  
+  pCacheFile = create_cache_file(pParam->pTokenCache, pParam);
+  offset = 0;
+  recordNum = 0;
+  
+  for (i = 0; i < pParam->tokenCachePartNum; i++)
+  {
+    pPart = map_cache_file(pParam->ppCacheParts[i], &partSize, pParam);
+    pMap = pParam->ppCachePartMaps ? pParam->ppCachePartMaps[i] : 0;
+  
+    reader.pData = pPart;
+    reader.pos = 0;
+    reader.end = partSize;
+  
+    while (reader.pos < reader.end)
+    {
+      if (recordNum % TOKENCACHE_CHECKPOINT == 0)
+      {
+        add_cache_checkpoint(offset, pParam);
+      }
+  
+      get_varint(&reader, &wordcount);
+      len = put_varint(buffer, wordcount);
+  
+      for (k = 0; k < (int) wordcount; k++)
+      {
+        get_varint(&reader, &number);
+        if (pMap)
+        {
+          number = pMap[number];
+        }
+        value = (unsigned long) pParam->pVocabToFrequent[number] << 1;
+  
+        if (pParam->pWordFilter)
+        {
+          get_varint(&reader, &replaced);
+          if (pMap)
+          {
+            replaced = pMap[replaced];
+          }
+          if (!value && pParam->pVocabToFrequent[replaced])
+          {
+            value = (unsigned long) pParam->pVocabToFrequent[replaced] << 1 | 1;
+          }
+        }
+  
+        len += put_varint(buffer + len, value);
+      }
+  
+      fwrite(buffer, 1, len, pCacheFile);
+      offset += len;
+      recordNum++;
+    }
+  
+    if (pPart)
+    {
+      munmap(pPart, partSize);
+    }
+    fclose(pParam->ppCacheParts[i]);
+  
+    if (pMap)
+    {
+      free((void *) pMap);
+    }
+  }
+  
+  free((void *) pParam->ppCacheParts);
+  pParam->ppCacheParts = 0;
+  pParam->tokenCachePartNum = 0;
+  
+  if (pParam->ppCachePartMaps)
+  {
+    free((void *) pParam->ppCachePartMaps);
+    pParam->ppCachePartMaps = 0;
+  }
+  
+  free((void *) pParam->pVocabToFrequent);
+  pParam->pVocabToFrequent = 0;
+  
+  pParam->pCacheData = map_cache_file(pCacheFile, &pParam->cacheSize, pParam);
+  fclose(pCacheFile);
+  
+  pParam->bTokenCacheReady = 1;
+}
+
+/* Prepare reading the records [start, end) of the final cache. start and end
+ must be the offsets of records, e.g. 0, pParam->cacheSize or checkpoints. */
+void open_token_cache_reader(struct TokenCacheReader *pReader, long start,
+        long end, struct Parameters *pParam)
+{
+  pReader->pData = pParam->pCacheData;
+  pReader->pos = start;
+  pReader->end = end;
+}
+
+/* Read the record of the next line from the final cache. Returns 0 when all
+ the records of the reader are read. */
+int read_token_cache_line(struct TokenCacheReader *pReader,
+        struct CachedLine *pLine, struct Parameters *pParam)
+{
+  unsigned long value, wordcount;
+  int i;
+  
+  if (pReader->pos >= pReader->end)
+  {
+    return 0;
+  }
+  
+  get_varint(pReader, &wordcount);
+  pLine->wordcount = (int) wordcount;
+  
+  for (i = 0; i < pLine->wordcount; i++)
+  {
+    get_varint(pReader, &value);
+    pLine->ppWords[i] = pParam->ppFrequentWords[value >> 1];
+    pLine->bReplaced[i] = (char) (value & 1);
+  }
+  
+  return 1;
+}
+
+/* Divide the final cache into pParam->threadNum ranges of roughly equal size,
+ cut at the checkpoints. The range of worker i is [cacheStart, cacheEnd). */
+void split_token_cache(struct WorkerContext *pWorkers,
+        struct Parameters *pParam)
+{
+  long target, k;
+  int i;
+  
+  k = 0;
+  pWorkers[0].cacheStart = 0;
+  
+  for (i = 1; i < pParam->threadNum; i++)
+  {
+    target = (long) ((double) pParam->cacheSize * i / pParam->threadNum);
+  
+    while (k < pParam->cacheCheckpointNum &&
+         pParam->pCacheCheckpoints[k] < target)
+    {
+      k++;
+    }
+  
+    pWorkers[i].cacheStart = k < pParam->cacheCheckpointNum ?
+                 pParam->pCacheCheckpoints[k] : pParam->cacheSize;
+    pWorkers[i - 1].cacheEnd = pWorkers[i].cacheStart;
+  }
+  
+  pWorkers[pParam->threadNum - 1].cacheEnd = pParam->cacheSize;
+}
+
+/* Release the token cache. The cache files were already removed when they
+ were created, so only the memory is freed here. If the program stops before
+ step_1_build_token_cache(), the raw parts are still open. */
+void close_token_cache(struct Parameters *pParam)
+{
+  int i;
+  
+  if (pParam->pCacheData)
+  {
+    munmap(pParam->pCacheData, pParam->cacheSize);
+    pParam->pCacheData = 0;
+  }
+  
+  for (i = 0; i < pParam->tokenCachePartNum; i++)
+  {
+    fclose(pParam->ppCacheParts[i]);
+    if (pParam->ppCachePartMaps)
+    {
+      free((void *) pParam->ppCachePartMaps[i]);
+    }
+  }
+  
+  free((void *) pParam->ppCacheParts);
+  free((void *) pParam->ppCachePartMaps);
+  free((void *) pParam->pVocabToFrequent);
+  free((void *) pParam->ppFrequentWords);
+  free((void *) pParam->pCacheCheckpoints);
+  
+  pParam->ppCacheParts = 0;
+  pParam->ppCachePartMaps = 0;
+  pParam->pVocabToFrequent = 0;
+  pParam->ppFrequentWords = 0;
+  pParam->pCacheCheckpoints = 0;
+  pParam->tokenCachePartNum = 0;
+  pParam->bTokenCacheReady = 0;
+}
+
+/* Create a cache file for writing and reading. The file is removed from the
+ directory at once, so that it does not stay behind, even if the program is
+ killed. It exists until it is closed. */
+static FILE *create_cache_file(char *pName, struct Parameters *pParam)
+{
+  FILE *pFile;
+  char logStr[MAXLOGMSGLEN];
+  
+  if (!(pFile = fopen(pName, "w+b")))
+  {
+    sprintf(logStr, "Can't create token cache file %s", pName);
+    log_msg(logStr, LOG_ERR, pParam);
+    exit(1);
+  }
+  
+  unlink(pName);
+  
+  return pFile;
+}
+
+/* Map the content of a cache file into memory. Returns 0 if it is empty. */
+static unsigned char *map_cache_file(FILE *pFile, long *pSize,
+        struct Parameters *pParam)
+{
+  unsigned char *pData;
+  
+  fflush(pFile);
+  fseek(pFile, 0, SEEK_END);
+  *pSize = ftell(pFile);
+  
+  if (*pSize <= 0)
+  {
+    *pSize = 0;
+    return 0;
+  }
+  
+  pData = (unsigned char *) mmap(0, *pSize, PROT_READ, MAP_PRIVATE,
+                   fileno(pFile), 0);
+  if (pData == MAP_FAILED)
+  {
+    log_msg("Can't map token cache file into memory", LOG_ERR, pParam);
+    exit(1);
+  }
+  
+  posix_madvise(pData, *pSize, POSIX_MADV_SEQUENTIAL);
+  
+  return pData;
+}
+
+/* Write value as a varint: 7 bits per byte, the lowest bits first, the high
+ bit of a byte is set if more bytes follow. Returns the number of bytes. */
+static int put_varint(unsigned char *pBuffer, unsigned long value)
+{
+  int len;
+  
+  len = 0;
+  
+  while (value >= 0x80)
+  {
+    pBuffer[len++] = (unsigned char) (value | 0x80);
+    value >>= 7;
+  }
+  pBuffer[len++] = (unsigned char) value;
+  
+  return len;
+}
+
+static int get_varint(struct TokenCacheReader *pReader, unsigned long *pValue)
+{
+  unsigned long value;
+  unsigned char byte;
+  int shift;
+  
+  value = 0;
+  shift = 0;
+  
+  do
+  {
+    if (pReader->pos >= pReader->end)
+    {
+      *pValue = 0;
+      return 0;
+    }
+  
+    byte = pReader->pData[pReader->pos++];
+    value |= (unsigned long) (byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  
+  *pValue = value;
+  
+  return 1;
+}
+
+static void add_cache_checkpoint(long offset, struct Parameters *pParam)
+{
+  long *pNew;
+  
+  /* The array grows in blocks of TOKENCACHE_CHECKPOINT entries. */
+  if (pParam->cacheCheckpointNum % TOKENCACHE_CHECKPOINT == 0)
+  {
+    pNew = (long *) realloc(pParam->pCacheCheckpoints, sizeof(long) *
+                (pParam->cacheCheckpointNum + TOKENCACHE_CHECKPOINT));
+    if (!pNew)
+    {
+      log_msg(MALLOC_ERR_6027, LOG_ERR, pParam);
+      exit(1);
+    }
+    pParam->pCacheCheckpoints = pNew;
+  }
+  
+  pParam->pCacheCheckpoints[pParam->cacheCheckpointNum++] = offset;
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2016 Zhuge Chen, Risto Vaarandi and Mauno Pihelgas
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/* 
+ * File:   token_cache.h
+ * 
+ * Content: Declarations of global functions in token_cache.c .
+ *
+ * Created on October 16, 2026, 4:10 PM
+ */
+
+#ifndef TOKEN_CACHE_H
+#define TOKEN_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void open_token_cache_parts(int partNum, struct Parameters *pParam);
+void write_token_cache_record(FILE *pFile, wordnumber_t *pNumbers, 
+        int wordcount, struct Parameters *pParam);
+void step_1_build_token_cache(struct Parameters *pParam);
+void open_token_cache_reader(struct TokenCacheReader *pReader, long start,
+        long end, struct Parameters *pParam);
+int read_token_cache_line(struct TokenCacheReader *pReader, 
+        struct CachedLine *pLine, struct Parameters *pParam);
+void split_token_cache(struct WorkerContext *pWorkers, 
+        struct Parameters *pParam);
+void close_token_cache(struct Parameters *pParam);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TOKEN_CACHE_H */
@@ -27,6 +27,7 @@
 #include "utility.h"
 
 #include <ctype.h>     /* for tolower() */
+#include <string.h>    /* for memcpy() */
 
 
 
@@ -69,39 +70,80 @@ size_t str_format_int_grouped(char dst[MAXDIGITBIT], unsigned long num)
   return (size_t)(p_dst - dst);
 }
 
-/* Fast string hashing algorithm by M.V.Ramakrishna and Justin Zobel. */
-tableindex_t str2hash(char *string, tableindex_t modulo, tableindex_t h)
+/* 64-bit string hash, computed once for every word of a line (see
+ find_word_spans()) and reused for the word sketch, the word table and the
+ prefix sketch. The string is given with its length, and does not need to be
+ terminated with 0. The string is read 8 bytes at a time and every block is
+ mixed in with the multiply-xorshift steps of MurmurHash64A by Austin Appleby.
+ */
+tableindex_t str2hash(char *string, int len, tableindex_t seed)
 {
+  const tableindex_t m = (tableindex_t) 0xC6A4A7935BD1E995ULL;
+  const unsigned char *pTail;
+  tableindex_t h, k;
   int i;
-  for (i = 0; string[i] != 0; ++i)
+  
+  h = seed ^ ((tableindex_t) len * m);
+  
+  for (i = 0; i + 8 <= len; i += 8)
+  {
+    memcpy(&k, string + i, 8);
+    k *= m;
+    k ^= k >> 47;
+    k *= m;
+    h ^= k;
+    h *= m;
+  }
+  
+  pTail = (const unsigned char *) string + i;
+  
+  /* The last 1..7 bytes are mixed in as one little-endian block. */
+  if (len & 7)
   {
-    h = h ^ ((h << 5) + (h >> 2) + string[i]);
+    for (i = 0; i < (len & 7); i++)
+    {
+      h ^= (tableindex_t) pTail[i] << (8 * i);
+    }
+    h *= m;
   }
-  return h % modulo;
+  
+  h ^= h >> 47;
+  h *= m;
+  h ^= h >> 47;
+  
+  return h;
 }
 
-/* Sort according to support value. */
-void sort_elements(struct Elem **ppArray, wordnumber_t size,
-           struct Parameters *pParam)
+/* Hash a cluster key, which is an array of frequent word IDs with the number of
+ IDs in pKey[0], see add_cluster_elem(). Every ID is mixed in with a
+ multiplication by the 64-bit golden ratio constant. */
+tableindex_t clusterkey2hash(wordnumber_t *pKey, tableindex_t h)
 {
-  int i, j, imax;
-  struct Elem *tmp;
+  wordnumber_t i;
+  for (i = 0; i <= pKey[0]; ++i)
+  {
+    h = (h ^ pKey[i]) * (tableindex_t) 0x9E3779B97F4A7C15ULL;
+    h ^= h >> 29;
+  }
+  return h;
+}
+
+/* Derive a slot in [0, size) of a sketch from a 64-bit hash value. The seed
+ of the sketch is mixed in with a multiplication by the golden ratio constant,
+ so that the sketches that are indexed with the same hash values do not share
+ their collisions. The slot is taken from the top 32 bits of the product with
+ a multiply-shift instead of a division. */
+tableindex_t hash2index(tableindex_t hash, tableindex_t size, 
+        tableindex_t seed)
+{
+  hash = (hash ^ seed) * (tableindex_t) 0x9E3779B97F4A7C15ULL;
   
-  for (j = 0; j < size - 1; j++)
+  if (size > 0xFFFFFFFFUL)
   {
-    imax = j;
-    
-    for (i = j + 1; i < size; i++)
-    {
-      if (ppArray[i]->count > ppArray[imax]->count)
-      {
-        imax = i;
-      }
-    }
-    tmp = ppArray[j];
-    ppArray[j] = ppArray[imax];
-    ppArray[imax] = tmp;
+    return hash % size;
   }
+  
+  return ((hash >> 32) * size) >> 32;
 }
 
 /* Ates Goral's solution for generating random string. Used for token
@@ -36,9 +36,10 @@ extern "C" {
   
 void string_lowercase(char *p);
 size_t str_format_int_grouped(char dst[MAXDIGITBIT], unsigned long num);
-tableindex_t str2hash(char *string, tableindex_t modulo, tableindex_t h);
-void sort_elements(struct Elem **ppArray, wordnumber_t size,
-           struct Parameters *pParam);
+tableindex_t str2hash(char *string, int len, tableindex_t seed);
+tableindex_t clusterkey2hash(wordnumber_t *pKey, tableindex_t h);
+tableindex_t hash2index(tableindex_t hash, tableindex_t size, 
+        tableindex_t seed);
 void gen_random_string(char *s, const int len);
 
 #ifdef __cplusplus
@@ -42,23 +42,48 @@ static void replace_string_for_word_search(long long start, long long end,
  sequentially problems. */
 int is_word_filtered(char *pStr, struct Parameters *pParam)
 {
-  if (!regexec(&pParam->wfilter_regex, pStr, 0, 0, 0) &&
-    !regexec(&pParam->wsearch_regex, pStr, 0, 0, 0))
+  return is_word_filtered_with_len(pStr, (int) strlen(pStr), pParam);
+}
+
+/* Works like is_word_filtered(), but the word is given with its length (e.g. a
+ word span of a log line), and does not need to be terminated with 0. */
+int is_word_filtered_with_len(char *pStr, int len, struct Parameters *pParam)
+{
+  regmatch_t match[1];
+  
+  match[0].rm_so = 0;
+  match[0].rm_eo = len;
+  if (regexec(&pParam->wfilter_regex, pStr, 1, match, REG_STARTEND))
   {
-    return 1;
+    return 0;
   }
-  else
+  
+  match[0].rm_so = 0;
+  match[0].rm_eo = len;
+  if (regexec(&pParam->wsearch_regex, pStr, 1, match, REG_STARTEND))
   {
     return 0;
   }
+  
+  return 1;
 }
 
 char *word_search_replace(char *pOriginStr, struct Parameters *pParam)
+{
+  return word_search_replace_with_len(pOriginStr, (int) strlen(pOriginStr),
+                    pParam);
+}
+
+/* Works like word_search_replace(), but the word is given with its length, and
+ does not need to be terminated with 0. */
+char *word_search_replace_with_len(char *pOriginStr, int len, 
+        struct Parameters *pParam)
 {
   regmatch_t match[MAXPARANEXPR];
   int cnt;
   
-  strcpy(pParam->tmpStr, pOriginStr);
+  memcpy(pParam->tmpStr, pOriginStr, len);
+  pParam->tmpStr[len] = 0;
   cnt = 0;
   
   while (1)
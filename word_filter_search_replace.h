@@ -32,6 +32,9 @@ extern "C" {
 
 int is_word_filtered(char *pStr, struct Parameters *pParam);
 char *word_search_replace(char *pOriginStr, struct Parameters *pParam);
+int is_word_filtered_with_len(char *pStr, int len, struct Parameters *pParam);
+char *word_search_replace_with_len(char *pOriginStr, int len, 
+        struct Parameters *pParam);
 
 #ifdef __cplusplus
 }